@@ -0,0 +1,103 @@
+package apply
+
+import (
+	"encoding/binary"
+	"fmt"
+	"math"
+	"time"
+)
+
+const (
+	fnvOffset = 14695981039346656037
+	fnvPrime  = 1099511628211
+)
+
+// HashKey hashes the encoded primary key of a row of owner.table, the Key
+// of an Insert, Update or Delete received WithRowKeys, with FNV-1a. An
+// update that changes the key also contributes the hash of its NewKey, so
+// it conflicts with changes of the row under either key.
+//
+// A nil key, for a table without a primary key or a row image missing a
+// key column, hashes owner.table alone: such changes conflict with each
+// other, table-wide, but not with the keyed changes of the table, so a
+// table should be hashed either by key or by table throughout.
+func HashKey(owner, table string, key []byte) uint64 {
+	h := hashString(fnvOffset, owner)
+	h = hashString(h, table)
+	if key == nil {
+		return h
+	}
+	return hashBytes(hashByte(h, 7), key)
+}
+
+// HashRow hashes the values of a row of owner.table with FNV-1a, for
+// streams received without row keys. Two changes conflict when they hash
+// a row image in common, so an update contributes the hashes of both its
+// old and new images; with complete images (supplemental logging of all
+// columns) consecutive changes of a row always share one. Hashing only
+// the key columns makes it cheaper and keeps partial images working.
+func HashRow(owner, table string, values []interface{}) uint64 {
+	h := hashString(fnvOffset, owner)
+	h = hashString(h, table)
+	var b [8]byte
+	for _, v := range values {
+		switch x := v.(type) {
+		case nil:
+			h = hashByte(h, 0)
+		case string:
+			h = hashString(hashByte(h, 1), x)
+		case []byte:
+			h = hashBytes(hashByte(h, 2), x)
+		case int64:
+			binary.LittleEndian.PutUint64(b[:], uint64(x))
+			h = hashBytes(hashByte(h, 3), b[:])
+		case int:
+			binary.LittleEndian.PutUint64(b[:], uint64(x))
+			h = hashBytes(hashByte(h, 3), b[:])
+		case uint64:
+			binary.LittleEndian.PutUint64(b[:], x)
+			h = hashBytes(hashByte(h, 3), b[:])
+		case float64:
+			binary.LittleEndian.PutUint64(b[:], math.Float64bits(x))
+			h = hashBytes(hashByte(h, 4), b[:])
+		case float32:
+			binary.LittleEndian.PutUint64(b[:], math.Float64bits(float64(x)))
+			h = hashBytes(hashByte(h, 4), b[:])
+		case time.Time:
+			binary.LittleEndian.PutUint64(b[:], uint64(x.UnixNano()))
+			h = hashBytes(hashByte(h, 5), b[:])
+		default:
+			h = hashString(hashByte(h, 6), fmt.Sprint(x))
+		}
+	}
+	return h
+}
+
+func hashByte(h uint64, c byte) uint64 {
+	return (h ^ uint64(c)) * fnvPrime
+}
+
+// hashString and hashBytes hash the length first, so that consecutive
+// values cannot run into each other.
+func hashString(h uint64, s string) uint64 {
+	h = hashLen(h, len(s))
+	for i := 0; i < len(s); i++ {
+		h = (h ^ uint64(s[i])) * fnvPrime
+	}
+	return h
+}
+
+func hashBytes(h uint64, b []byte) uint64 {
+	h = hashLen(h, len(b))
+	for _, c := range b {
+		h = (h ^ uint64(c)) * fnvPrime
+	}
+	return h
+}
+
+func hashLen(h uint64, n int) uint64 {
+	for ; n >= 0x80; n >>= 7 {
+		h = hashByte(h, byte(n)|0x80)
+	}
+	return hashByte(h, byte(n))
+}
@@ -0,0 +1,240 @@
+// Package apply runs the transactions of a change stream on several
+// workers at once without reordering transactions that touch the same
+// rows.
+//
+// Transactions are submitted in commit order with the hashes of the rows
+// they change (see HashKey). A transaction starts once every earlier
+// transaction sharing a key with it has been applied; transactions with
+// disjoint keys run concurrently. The scheduler tracks the commit-order
+// low watermark, the SCN up to which every transaction has been applied,
+// which is the position that is safe to acknowledge upstream.
+package apply
+
+import (
+	"errors"
+	"sync"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// ErrClosed is returned by Submit after Close.
+var ErrClosed = errors.New("apply: scheduler closed")
+
+// Txn is one transaction of the stream.
+type Txn struct {
+	// SCN is the commit SCN.
+	SCN scn.SCN
+	// Keys are the hashes of the rows the transaction changes. A
+	// transaction without keys conflicts with nothing.
+	Keys []uint64
+	// Barrier makes the transaction run alone, after everything submitted
+	// before it and before everything submitted after it, e.g. for DDL.
+	Barrier bool
+	// Changes is the payload handed to the apply function.
+	Changes []interface{}
+}
+
+// Func applies txn on worker, a number from 0 to workers-1 that lets the
+// function keep a connection per worker. An error stops the scheduler.
+type Func func(worker int, txn *Txn) error
+
+// Option configures a Scheduler.
+type Option func(*Scheduler)
+
+// WithWindow sets how many transactions may be submitted but not yet
+// applied before Submit blocks. The default is 64 per worker.
+func WithWindow(n int) Option {
+	return func(s *Scheduler) {
+		s.window = n
+	}
+}
+
+type node struct {
+	txn        *Txn
+	waiting    int
+	dependents []*node
+	done       bool
+}
+
+// Scheduler dispatches transactions to workers. Submit must be called
+// from a single goroutine, in commit order.
+type Scheduler struct {
+	fn      Func
+	window  int
+	mu      sync.Mutex
+	cond    *sync.Cond
+	last    map[uint64]*node
+	barrier *node
+	pending []*node
+	ready   []*node
+	running int
+	lwm     scn.SCN
+	err     error
+	closed  bool
+	wg      sync.WaitGroup
+}
+
+// New starts a scheduler with the given number of workers.
+func New(workers int, fn Func, opts ...Option) *Scheduler {
+	if workers < 1 {
+		workers = 1
+	}
+	s := &Scheduler{
+		fn:     fn,
+		window: 64 * workers,
+		last:   map[uint64]*node{},
+	}
+	for _, opt := range opts {
+		opt(s)
+	}
+	if s.window < 1 {
+		s.window = 1
+	}
+	s.cond = sync.NewCond(&s.mu)
+	s.wg.Add(workers)
+	for i := 0; i < workers; i++ {
+		go s.work(i)
+	}
+	return s
+}
+
+// Submit queues txn behind the transactions it conflicts with. It blocks
+// while the window is full and returns the error of a failed apply.
+func (s *Scheduler) Submit(txn *Txn) error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for len(s.pending) >= s.window && s.err == nil && !s.closed {
+		s.cond.Wait()
+	}
+	if s.err != nil {
+		return s.err
+	}
+	if s.closed {
+		return ErrClosed
+	}
+	n := &node{txn: txn}
+	if txn.Barrier {
+		for _, p := range s.pending {
+			s.depend(n, p)
+		}
+		s.barrier = n
+	} else {
+		if s.barrier != nil {
+			s.depend(n, s.barrier)
+		}
+		for _, k := range txn.Keys {
+			if p := s.last[k]; p != nil {
+				s.depend(n, p)
+			}
+			s.last[k] = n
+		}
+	}
+	s.pending = append(s.pending, n)
+	if n.waiting == 0 {
+		s.ready = append(s.ready, n)
+		s.cond.Broadcast()
+	}
+	return nil
+}
+
+// depend makes n wait for p, once.
+func (s *Scheduler) depend(n, p *node) {
+	if p.done || p == n {
+		return
+	}
+	if l := len(p.dependents); l > 0 && p.dependents[l-1] == n {
+		return
+	}
+	p.dependents = append(p.dependents, n)
+	n.waiting++
+}
+
+func (s *Scheduler) work(worker int) {
+	defer s.wg.Done()
+	s.mu.Lock()
+	for {
+		for len(s.ready) == 0 && s.err == nil && !(s.closed && len(s.pending) == 0) {
+			s.cond.Wait()
+		}
+		if len(s.ready) == 0 || s.err != nil {
+			s.mu.Unlock()
+			return
+		}
+		n := s.ready[0]
+		s.ready[0] = nil
+		s.ready = s.ready[1:]
+		s.running++
+		s.mu.Unlock()
+
+		err := s.fn(worker, n.txn)
+
+		s.mu.Lock()
+		s.running--
+		if err != nil {
+			if s.err == nil {
+				s.err = err
+			}
+			s.cond.Broadcast()
+			continue
+		}
+		s.finish(n)
+		s.cond.Broadcast()
+	}
+}
+
+// finish releases the dependents of n and advances the low watermark
+// over the applied prefix of the commit order.
+func (s *Scheduler) finish(n *node) {
+	n.done = true
+	for _, d := range n.dependents {
+		if d.waiting--; d.waiting == 0 {
+			s.ready = append(s.ready, d)
+		}
+	}
+	n.dependents = nil
+	for _, k := range n.txn.Keys {
+		if s.last[k] == n {
+			delete(s.last, k)
+		}
+	}
+	if s.barrier == n {
+		s.barrier = nil
+	}
+	i := 0
+	for ; i < len(s.pending) && s.pending[i].done; i++ {
+		s.lwm = s.pending[i].txn.SCN
+		s.pending[i] = nil
+	}
+	s.pending = s.pending[i:]
+}
+
+// LWM returns the commit SCN of the last transaction of the longest
+// applied prefix of the stream: everything committed at or before it has
+// been applied.
+func (s *Scheduler) LWM() scn.SCN {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.lwm
+}
+
+// Wait blocks until every submitted transaction has been applied, or one
+// of them failed.
+func (s *Scheduler) Wait() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	for len(s.pending) > 0 && s.err == nil {
+		s.cond.Wait()
+	}
+	return s.err
+}
+
+// Close waits for the submitted transactions and stops the workers.
+func (s *Scheduler) Close() error {
+	err := s.Wait()
+	s.mu.Lock()
+	s.closed = true
+	s.cond.Broadcast()
+	s.mu.Unlock()
+	s.wg.Wait()
+	return err
+}
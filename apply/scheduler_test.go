@@ -0,0 +1,184 @@
+package apply
+
+import (
+	"errors"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+func TestConflictsKeepOrder(t *testing.T) {
+	var mu sync.Mutex
+	applied := map[uint64][]scn.SCN{}
+	s := New(8, func(worker int, txn *Txn) error {
+		time.Sleep(time.Duration(txn.SCN%3) * time.Millisecond)
+		mu.Lock()
+		for _, k := range txn.Keys {
+			applied[k] = append(applied[k], txn.SCN)
+		}
+		mu.Unlock()
+		return nil
+	})
+	for i := 1; i <= 500; i++ {
+		txn := &Txn{SCN: scn.SCN(i), Keys: []uint64{uint64(i % 7), uint64(100 + i%11)}}
+		if err := s.Submit(txn); err != nil {
+			t.Fatal(err)
+		}
+	}
+	if err := s.Close(); err != nil {
+		t.Fatal(err)
+	}
+	for k, scns := range applied {
+		for i := 1; i < len(scns); i++ {
+			if scns[i] <= scns[i-1] {
+				t.Fatalf("key %d applied out of order: %v", k, scns)
+			}
+		}
+	}
+	if lwm := s.LWM(); lwm != 500 {
+		t.Fatalf("LWM %d, want 500", lwm)
+	}
+}
+
+func TestIndependentRunConcurrently(t *testing.T) {
+	var running, peak int32
+	release := make(chan struct{})
+	s := New(4, func(worker int, txn *Txn) error {
+		n := atomic.AddInt32(&running, 1)
+		for {
+			p := atomic.LoadInt32(&peak)
+			if n <= p || atomic.CompareAndSwapInt32(&peak, p, n) {
+				break
+			}
+		}
+		<-release
+		atomic.AddInt32(&running, -1)
+		return nil
+	})
+	for i := 1; i <= 4; i++ {
+		s.Submit(&Txn{SCN: scn.SCN(i), Keys: []uint64{uint64(i)}})
+	}
+	deadline := time.Now().Add(5 * time.Second)
+	for atomic.LoadInt32(&peak) < 4 && time.Now().Before(deadline) {
+		time.Sleep(time.Millisecond)
+	}
+	close(release)
+	if err := s.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if peak != 4 {
+		t.Fatalf("%d transactions ran at once, want 4", peak)
+	}
+}
+
+func TestLWMWaitsForEarlierTransactions(t *testing.T) {
+	block := make(chan struct{})
+	s := New(2, func(worker int, txn *Txn) error {
+		if txn.SCN == 1 {
+			<-block
+		}
+		return nil
+	})
+	s.Submit(&Txn{SCN: 1, Keys: []uint64{1}})
+	s.Submit(&Txn{SCN: 2, Keys: []uint64{2}})
+	time.Sleep(10 * time.Millisecond)
+	if lwm := s.LWM(); lwm != 0 {
+		t.Fatalf("LWM %d before the first transaction was applied", lwm)
+	}
+	close(block)
+	s.Wait()
+	if lwm := s.LWM(); lwm != 2 {
+		t.Fatalf("LWM %d, want 2", lwm)
+	}
+	s.Close()
+}
+
+func TestBarrier(t *testing.T) {
+	var mu sync.Mutex
+	var order []scn.SCN
+	s := New(4, func(worker int, txn *Txn) error {
+		if txn.SCN < 3 {
+			time.Sleep(5 * time.Millisecond)
+		}
+		mu.Lock()
+		order = append(order, txn.SCN)
+		mu.Unlock()
+		return nil
+	})
+	s.Submit(&Txn{SCN: 1, Keys: []uint64{1}})
+	s.Submit(&Txn{SCN: 2, Keys: []uint64{2}})
+	s.Submit(&Txn{SCN: 3, Barrier: true})
+	s.Submit(&Txn{SCN: 4, Keys: []uint64{4}})
+	if err := s.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if order[2] != 3 || order[3] != 4 {
+		t.Fatalf("barrier not respected: %v", order)
+	}
+}
+
+func TestErrorStops(t *testing.T) {
+	fail := errors.New("apply failed")
+	s := New(2, func(worker int, txn *Txn) error {
+		if txn.SCN == 3 {
+			return fail
+		}
+		return nil
+	}, WithWindow(4))
+	var err error
+	for i := 1; i <= 100 && err == nil; i++ {
+		err = s.Submit(&Txn{SCN: scn.SCN(i), Keys: []uint64{1}})
+	}
+	if !errors.Is(err, fail) {
+		t.Fatalf("Submit returned %v", err)
+	}
+	if err := s.Close(); !errors.Is(err, fail) {
+		t.Fatalf("Close returned %v", err)
+	}
+	if lwm := s.LWM(); lwm != 2 {
+		t.Fatalf("LWM %d, want 2", lwm)
+	}
+}
+
+func TestHashRow(t *testing.T) {
+	a := HashRow("HR", "EMP", []interface{}{int64(1), "x", nil})
+	if b := HashRow("HR", "EMP", []interface{}{int64(1), "x", nil}); a != b {
+		t.Fatal("equal rows hash differently")
+	}
+	for _, row := range [][]interface{}{
+		{int64(2), "x", nil},
+		{int64(1), "x", ""},
+		{int64(1), "", "x"},
+	} {
+		if HashRow("HR", "EMP", row) == a {
+			t.Errorf("%v hashes like the original row", row)
+		}
+	}
+	if HashRow("HR", "DEPT", []interface{}{int64(1), "x", nil}) == a {
+		t.Error("table not part of the hash")
+	}
+}
+
+func TestHashKey(t *testing.T) {
+	key := []byte{0x02, 0xc1, 0x02}
+	a := HashKey("HR", "EMP", key)
+	if HashKey("HR", "EMP", append([]byte{}, key...)) != a {
+		t.Fatal("equal keys hash differently")
+	}
+	if HashKey("HR", "EMP", []byte{0x02, 0xc1, 0x03}) == a {
+		t.Error("key not part of the hash")
+	}
+	if HashKey("HR", "DEPT", key) == a {
+		t.Error("table not part of the hash")
+	}
+	table := HashKey("HR", "EMP", nil)
+	if table == a || HashKey("HR", "EMP", []byte{}) == table {
+		t.Error("a missing key hashes like a key")
+	}
+	if HashKey("HR", "EMPX", nil) == table || HashKey("HRE", "MP", nil) == table {
+		t.Error("tables without keys share a hash")
+	}
+}
@@ -0,0 +1,178 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/avro"
+	"github.com/yjhatfdu/goxstream/oraBinary"
+	"github.com/yjhatfdu/goxstream/oraTime"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// avroValue is a raw column value as staged by get_lcr_row_data. It is
+// only valid until the LCR is freed.
+type avroValue struct {
+	p     unsafe.Pointer
+	l     C.ub2
+	dtype C.ub2
+	csid  int
+}
+
+// avroWriter encodes row messages to Avro from the raw column values (see
+// WithAvro and encodeRow). Unlike JSON the event cannot be written while
+// the columns are iterated, as a column first seen in the new image
+// changes the schema of the old one, so the values of both images are
+// collected first. A nil *avroWriter does nothing.
+type avroWriter struct {
+	tables map[tableKey]*avro.Table
+	table  *avro.Table
+	op     avro.Op
+	scn    scn.SCN
+	images [2][]avroValue // by schema position, dtype 0 if absent
+	has    [2]bool
+	buf    []byte
+	text   []byte
+}
+
+func newAvroWriter() *avroWriter {
+	return &avroWriter{
+		tables: map[tableKey]*avro.Table{},
+		buf:    make([]byte, 0, eventSlab),
+	}
+}
+
+// begin starts the event of a row change of owner.table.
+func (w *avroWriter) begin(op avro.Op, s scn.SCN, owner, table string) {
+	if w == nil {
+		return
+	}
+	t := tableKey{owner, table}
+	if w.table = w.tables[t]; w.table == nil {
+		w.table = avro.NewTable(owner, table)
+		w.tables[t] = w.table
+	}
+	w.op, w.scn = op, s
+	for i := range w.images {
+		w.images[i] = w.images[i][:0]
+		w.has[i] = false
+	}
+}
+
+// column records a column of the old (0) or new (1) image. Columns of
+// types Avro events do not carry are left out, as value2interface does.
+func (w *avroWriter) column(image int, name []byte, v avroValue) {
+	typ, ok := avroType(v.dtype)
+	if !ok {
+		return
+	}
+	i := w.table.Column(name, typ)
+	img := w.images[image]
+	for len(img) <= i {
+		img = append(img, avroValue{})
+	}
+	img[i] = v
+	w.images[image] = img
+}
+
+// avroEvent encodes the event begun last with the table's latest schema.
+func (x *XStreamConn) avroEvent() ([]byte, *avro.Schema, error) {
+	w := x.avro
+	if w == nil {
+		return nil, nil, nil
+	}
+	s := w.table.Schema()
+	w.buf = slab(w.buf)
+	start := len(w.buf)
+	b := s.AppendHeader(w.buf, w.op, uint64(w.scn))
+	for image, values := range w.images {
+		b = avro.AppendImage(b, w.has[image])
+		if !w.has[image] {
+			continue
+		}
+		for i, c := range s.Columns {
+			var err error
+			if i >= len(values) || values[i].dtype == 0 {
+				b = avro.AppendNull(b)
+			} else if b, err = x.appendAvroValue(b, values[i], c.Type); err != nil {
+				w.buf = b[:start]
+				return nil, nil, err
+			}
+		}
+	}
+	w.buf = b
+	return b[start:len(b):len(b)], s, nil
+}
+
+// avroType maps an LCR column type to the Avro type of its column.
+func avroType(dtype C.ub2) (avro.Type, bool) {
+	switch dtype {
+	case C.SQLT_CHR, C.SQLT_AFC, C.SQLT_RDD, C.SQLT_INTERVAL_YM, C.SQLT_INTERVAL_DS:
+		return avro.String, true
+	case C.SQLT_VNU:
+		return avro.Number, true
+	case C.SQLT_ODT, C.SQLT_TIMESTAMP:
+		return avro.LocalTimestampMicros, true
+	case C.SQLT_TIMESTAMP_TZ, C.SQLT_TIMESTAMP_LTZ:
+		return avro.TimestampMicros, true
+	case C.SQLT_BIN:
+		return avro.Bytes, true
+	case C.SQLT_BFLOAT, C.SQLT_IBFLOAT:
+		return avro.Float, true
+	case C.SQLT_BDOUBLE, C.SQLT_IBDOUBLE:
+		return avro.Double, true
+	}
+	return 0, false
+}
+
+// appendAvroValue encodes a raw column value, NULL if the column's type
+// has changed since.
+func (x *XStreamConn) appendAvroValue(b []byte, v avroValue, typ avro.Type) ([]byte, error) {
+	if t, _ := avroType(v.dtype); v.l == 0 || v.p == nil || t != typ {
+		return avro.AppendNull(b), nil
+	}
+	raw := byteView(v.p, v.l)
+	switch v.dtype {
+	case C.SQLT_CHR, C.SQLT_AFC:
+		text, err := x.utf8Text(raw, v.csid, &x.avro.text)
+		return avro.AppendString(b, text), err
+	case C.SQLT_VNU:
+		return avro.AppendNumber(b, raw)
+	case C.SQLT_ODT:
+		d := (*C.OCIDate)(v.p)
+		t := d.OCIDateTime
+		return avro.AppendMicros(b, oraTime.DateMicros(int(d.OCIDateYYYY), int(d.OCIDateMM), int(d.OCIDateDD),
+			int(t.OCITimeHH), int(t.OCITimeMI), int(t.OCITimeSS))), nil
+	case C.SQLT_TIMESTAMP, C.SQLT_TIMESTAMP_TZ, C.SQLT_TIMESTAMP_LTZ:
+		us, err := oraTime.TimestampMicros(raw)
+		return avro.AppendMicros(b, us), err
+	case C.SQLT_INTERVAL_YM:
+		i, err := oraTime.DecodeIntervalYM(raw)
+		return avro.AppendText(b, i.String()), err
+	case C.SQLT_INTERVAL_DS:
+		i, err := oraTime.DecodeIntervalDS(raw)
+		return avro.AppendText(b, i.String()), err
+	case C.SQLT_BIN:
+		return avro.AppendBytes(b, raw), nil
+	case C.SQLT_BFLOAT:
+		return avro.AppendFloat(b, *(*float32)(v.p)), nil
+	case C.SQLT_BDOUBLE:
+		return avro.AppendDouble(b, *(*float64)(v.p)), nil
+	case C.SQLT_IBFLOAT:
+		f, err := oraBinary.Float32(raw)
+		return avro.AppendFloat(b, f), err
+	case C.SQLT_IBDOUBLE:
+		f, err := oraBinary.Float64(raw)
+		return avro.AppendDouble(b, f), err
+	case C.SQLT_RDD:
+		if r, err := oraBinary.ParseRowid(raw); err == nil {
+			x.avro.text = r.AppendText(x.avro.text[:0])
+			return avro.AppendString(b, x.avro.text), nil
+		}
+		return avro.AppendString(b, raw), nil
+	}
+	return avro.AppendNull(b), nil
+}
@@ -0,0 +1,125 @@
+package avro
+
+import (
+	"bytes"
+	"encoding/json"
+	"reflect"
+	"testing"
+)
+
+func TestFingerprint(t *testing.T) {
+	// from the Avro specification's schema normalization test data
+	for _, c := range []struct {
+		schema string
+		want   int64
+	}{
+		{`"null"`, 7195948357588979594},
+		{`"int"`, 8247732601305521295},
+		{`"long"`, -3434872931120570953},
+		{`"string"`, -8142146995180207161},
+	} {
+		if got := Fingerprint([]byte(c.schema)); got != uint64(c.want) {
+			t.Errorf("Fingerprint(%s) = %d, want %d", c.schema, int64(got), c.want)
+		}
+	}
+}
+
+func TestTableSchema(t *testing.T) {
+	tbl := NewTable("HR", "EMP$HIST")
+	empty := tbl.Schema()
+	if i := tbl.Column([]byte("ID"), Number); i != 0 {
+		t.Fatalf("ID at %d", i)
+	}
+	if i := tbl.Column([]byte("FIRST NAME"), String); i != 1 {
+		t.Fatalf("FIRST NAME at %d", i)
+	}
+	s := tbl.Schema()
+	if tbl.Column([]byte("ID"), Number) != 0 || tbl.Schema() != s {
+		t.Fatal("known column changed the schema")
+	}
+	if s.Fingerprint == empty.Fingerprint || len(empty.Columns) != 0 {
+		t.Fatal("adding columns did not give a new schema")
+	}
+	if s.Columns[1].Field != "FIRST_NAME" || s.Name != "HR.EMP_HIST" {
+		t.Fatalf("names not sanitised: %s %s", s.Name, s.Columns[1].Field)
+	}
+	tbl.Column([]byte("ID"), String)
+	if tbl.Schema().Columns[0].Type != String || s.Columns[0].Type != Number {
+		t.Fatal("type change not applied to a new schema only")
+	}
+	tbl.Column([]byte("HIRED"), LocalTimestampMicros)
+	for _, js := range []string{tbl.Schema().JSON, tbl.Schema().Canonical} {
+		if !json.Valid([]byte(js)) {
+			t.Fatalf("invalid schema %s", js)
+		}
+	}
+	if !bytes.Contains([]byte(tbl.Schema().JSON), []byte("local-timestamp-micros")) ||
+		bytes.Contains([]byte(tbl.Schema().Canonical), []byte("logicalType")) {
+		t.Fatal("logical types not only in the full schema")
+	}
+}
+
+func TestFieldCollisions(t *testing.T) {
+	tbl := NewTable("HR", "EMP")
+	for _, name := range []string{"A_B", "A$B", "A#B", "A_B_2", "A B"} {
+		tbl.Column([]byte(name), String)
+	}
+	var got []string
+	for _, c := range tbl.Schema().Columns {
+		got = append(got, c.Field)
+	}
+	if want := []string{"A_B", "A_B_2", "A_B_3", "A_B_2_2", "A_B_4"}; !reflect.DeepEqual(got, want) {
+		t.Fatalf("fields %v, want %v", got, want)
+	}
+	// a type change keeps the field name
+	tbl.Column([]byte("A$B"), Bytes)
+	if c := tbl.Schema().Columns[1]; c.Field != "A_B_2" || c.Type != Bytes {
+		t.Fatalf("A$B changed to %+v", c)
+	}
+	if !json.Valid([]byte(tbl.Schema().JSON)) {
+		t.Fatalf("invalid schema %s", tbl.Schema().JSON)
+	}
+}
+
+func TestEncode(t *testing.T) {
+	s := NewTable("HR", "EMP").Schema()
+	b := s.AppendHeader(nil, Update, 100)
+	if b[0] != 0xc3 || b[1] != 0x01 || len(b) != 10+1+2 {
+		t.Fatalf("header % x", b)
+	}
+	if b[10] != 0x02 || b[11] != 0xc8 || b[12] != 0x01 {
+		t.Fatalf("op and scn % x", b[10:])
+	}
+	for _, c := range []struct {
+		got  []byte
+		want []byte
+	}{
+		{AppendNull(nil), []byte{0}},
+		{AppendString(nil, []byte("ab")), []byte{2, 4, 'a', 'b'}},
+		{AppendLong(nil, -1), []byte{1}},
+		{AppendLong(nil, 64), []byte{0x80, 0x01}},
+		{AppendFloat(nil, 1), []byte{2, 0, 0, 0x80, 0x3f}},
+		{AppendMicros(nil, -2), []byte{2, 3}},
+		{AppendImage(nil, true), []byte{2}},
+	} {
+		if !bytes.Equal(c.got, c.want) {
+			t.Errorf("got % x, want % x", c.got, c.want)
+		}
+	}
+	// 123.45 as text, 100 as a long
+	if b, err := AppendNumber([]byte{9}, []byte{4, 0xc2, 0x02, 0x18, 0x2e}); err != nil ||
+		!bytes.Equal(b, append([]byte{9, 4, 12}, "123.45"...)) {
+		t.Errorf("AppendNumber(123.45) = % x, %v", b, err)
+	}
+	if b, err := AppendNumber(nil, []byte{2, 0xc2, 0x02}); err != nil || !bytes.Equal(b, []byte{2, 0xc8, 0x01}) {
+		t.Errorf("AppendNumber(100) = % x, %v", b, err)
+	}
+	// 1e-129: "0." and 129 more characters
+	b, err := AppendNumber(nil, []byte{2, 0x80, 0x0b})
+	if err != nil || b[0] != 4 || b[1] != 0x86 || b[2] != 0x02 || len(b) != 3+131 {
+		t.Errorf("AppendNumber(1e-129) = % x, %v", b, err)
+	}
+	if b, err := AppendNumber([]byte{9}, []byte{1, 0x00}); err == nil || !bytes.Equal(b, []byte{9}) {
+		t.Errorf("AppendNumber(-inf) = % x, %v", b, err)
+	}
+}
@@ -0,0 +1,103 @@
+package avro
+
+import (
+	"encoding/binary"
+	"math"
+
+	"github.com/yjhatfdu/goxstream/oraNumber"
+)
+
+// AppendHeader starts an event in Avro single object encoding: the marker
+// and the schema fingerprint, followed by the op and scn fields.
+func (s *Schema) AppendHeader(b []byte, op Op, scn uint64) []byte {
+	b = append(b, 0xc3, 0x01)
+	var fp [8]byte
+	binary.LittleEndian.PutUint64(fp[:], s.Fingerprint)
+	b = append(b, fp[:]...)
+	b = AppendLong(b, int64(op))
+	return AppendLong(b, int64(scn))
+}
+
+// AppendImage starts the before or after field: the branch of its union,
+// to be followed by a value for every column of the schema if present.
+func AppendImage(b []byte, present bool) []byte {
+	if present {
+		return append(b, 0x02)
+	}
+	return append(b, 0x00)
+}
+
+// The Append functions below write a column value with its union branch;
+// AppendNull writes an absent or NULL column.
+
+// AppendNull appends a NULL column.
+func AppendNull(b []byte) []byte {
+	return append(b, 0x00)
+}
+
+// AppendString appends a String column; s must be UTF-8.
+func AppendString(b, s []byte) []byte {
+	return append(AppendLong(append(b, 0x02), int64(len(s))), s...)
+}
+
+// AppendText is AppendString for a string, such as an interval's text.
+func AppendText(b []byte, s string) []byte {
+	return append(AppendLong(append(b, 0x02), int64(len(s))), s...)
+}
+
+// AppendBytes appends a Bytes column.
+func AppendBytes(b, v []byte) []byte {
+	return append(AppendLong(append(b, 0x02), int64(len(v))), v...)
+}
+
+// AppendNumber appends a Number column from its OCINumber image: a long
+// if it is an integer that fits, else its decimal text.
+func AppendNumber(b, num []byte) ([]byte, error) {
+	if v, ok := oraNumber.Int64(num); ok {
+		return AppendLong(append(b, 0x02), v), nil
+	}
+	n := len(b)
+	// the text is written after room for its length, at most 2 varint
+	// bytes, and moved back if the length takes only one
+	b = append(b, 0x04, 0, 0)
+	b, err := oraNumber.AppendDecimal(b, num)
+	if err != nil {
+		return b[:n], err
+	}
+	var l [2]byte
+	k := len(AppendLong(l[:0], int64(len(b)-n-3)))
+	copy(b[n+1:], l[:k])
+	if k == 1 {
+		b = append(b[:n+2], b[n+3:]...)
+	}
+	return b, nil
+}
+
+// AppendFloat appends a Float column.
+func AppendFloat(b []byte, v float32) []byte {
+	var f [4]byte
+	binary.LittleEndian.PutUint32(f[:], math.Float32bits(v))
+	return append(append(b, 0x02), f[:]...)
+}
+
+// AppendDouble appends a Double column.
+func AppendDouble(b []byte, v float64) []byte {
+	var f [8]byte
+	binary.LittleEndian.PutUint64(f[:], math.Float64bits(v))
+	return append(append(b, 0x02), f[:]...)
+}
+
+// AppendMicros appends a LocalTimestampMicros or TimestampMicros column.
+func AppendMicros(b []byte, v int64) []byte {
+	return AppendLong(append(b, 0x02), v)
+}
+
+// AppendLong appends a long as a zig-zag varint.
+func AppendLong(b []byte, v int64) []byte {
+	u := uint64(v<<1) ^ uint64(v>>63)
+	for u >= 0x80 {
+		b = append(b, byte(u)|0x80)
+		u >>= 7
+	}
+	return append(b, byte(u))
+}
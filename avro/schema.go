@@ -0,0 +1,231 @@
+// Package avro encodes change events in Avro binary form straight from the
+// raw column images of an LCR, with a schema per table derived from the
+// column types seen in the stream.
+//
+// The schema of owner.table is a record with the operation, the SCN and
+// the old and new row images:
+//
+//	{"type":"record","name":"OWNER.TABLE","fields":[
+//	 {"name":"op","type":{"type":"enum","name":"OWNER.TABLE.Op","symbols":["INSERT","UPDATE","DELETE"]}},
+//	 {"name":"scn","type":"long"},
+//	 {"name":"before","type":["null",{"type":"record","name":"OWNER.TABLE.Row","fields":[...]}],"default":null},
+//	 {"name":"after","type":["null","OWNER.TABLE.Row"],"default":null}]}
+//
+// Every column is nullable, since LCRs carry no NOT NULL information and
+// row images may leave columns out. The LCR does not carry the precision
+// and scale of NUMBER columns either, so a NUMBER is a union of long, for
+// integers that fit, and string, holding the exact decimal text of other
+// values. Columns are added to the schema when they are first seen and
+// change type when their LCR type does; each change gives a new Schema
+// with a new fingerprint, and data is always encoded with the latest one.
+package avro
+
+import (
+	"strconv"
+	"strings"
+)
+
+// Type is the Avro type of a column.
+type Type int
+
+const (
+	String Type = iota + 1
+	Bytes
+	Number
+	Float
+	Double
+	// LocalTimestampMicros holds DATE and TIMESTAMP values, which have no
+	// zone, TimestampMicros the instants of TIMESTAMP WITH (LOCAL) TIME
+	// ZONE values.
+	LocalTimestampMicros
+	TimestampMicros
+)
+
+// Op is the operation of an event, encoded as the enum symbol index.
+type Op int
+
+const (
+	Insert Op = iota
+	Update
+	Delete
+)
+
+// Column is a column of a row image.
+type Column struct {
+	// Name is the column name, Field the Avro field name: the column name
+	// with characters Avro does not allow in names replaced by '_', and a
+	// suffix _2, _3... if that gives the field name of an earlier column,
+	// as A$B does after A_B.
+	Name  string
+	Field string
+	Type  Type
+}
+
+// Schema is an immutable version of a table's schema.
+type Schema struct {
+	Name    string
+	Columns []Column
+	// JSON is the schema, Canonical its Parsing Canonical Form and
+	// Fingerprint the CRC-64-AVRO fingerprint of the latter.
+	JSON        string
+	Canonical   string
+	Fingerprint uint64
+}
+
+// Table tracks the schema of a table.
+type Table struct {
+	name   string
+	schema *Schema
+	index  map[string]int
+	fields map[string]bool
+}
+
+// NewTable returns the tracker of owner.table, with an empty row record.
+func NewTable(owner, table string) *Table {
+	t := &Table{
+		name:   avroName(owner) + "." + avroName(table),
+		index:  map[string]int{},
+		fields: map[string]bool{},
+	}
+	t.schema = newSchema(t.name, nil)
+	return t
+}
+
+// Schema returns the current schema.
+func (t *Table) Schema() *Schema {
+	return t.schema
+}
+
+// Column returns the position of column name of type typ in the row
+// record, adding it or changing its type first if needed.
+func (t *Table) Column(name []byte, typ Type) int {
+	i, ok := t.index[string(name)]
+	if ok && t.schema.Columns[i].Type == typ {
+		return i
+	}
+	columns := append([]Column(nil), t.schema.Columns...)
+	if ok {
+		columns[i].Type = typ
+	} else {
+		i = len(columns)
+		t.index[string(name)] = i
+		columns = append(columns, Column{Name: string(name), Field: t.field(string(name)), Type: typ})
+	}
+	t.schema = newSchema(t.name, columns)
+	return i
+}
+
+// field returns a field name for a new column, unique in the row record.
+func (t *Table) field(name string) string {
+	f := avroName(name)
+	for n := 2; t.fields[f]; n++ {
+		f = avroName(name) + "_" + strconv.Itoa(n)
+	}
+	t.fields[f] = true
+	return f
+}
+
+func newSchema(name string, columns []Column) *Schema {
+	s := &Schema{Name: name, Columns: columns}
+	s.JSON = s.build(false)
+	s.Canonical = s.build(true)
+	s.Fingerprint = Fingerprint([]byte(s.Canonical))
+	return s
+}
+
+// build writes the schema, or its Parsing Canonical Form, which drops the
+// logical types and defaults. Names are always written as full names.
+func (s *Schema) build(canonical bool) string {
+	var b strings.Builder
+	b.WriteString(`{"name":"` + s.Name + `","type":"record","fields":[`)
+	b.WriteString(`{"name":"op","type":{"name":"` + s.Name + `.Op","type":"enum","symbols":["INSERT","UPDATE","DELETE"]}},`)
+	b.WriteString(`{"name":"scn","type":"long"},`)
+	b.WriteString(`{"name":"before","type":["null",{"name":"` + s.Name + `.Row","type":"record","fields":[`)
+	for i, c := range s.Columns {
+		if i > 0 {
+			b.WriteByte(',')
+		}
+		b.WriteString(`{"name":"` + c.Field + `","type":["null",`)
+		b.WriteString(typeJSON(c.Type, canonical))
+		b.WriteByte(']')
+		if !canonical {
+			b.WriteString(`,"default":null`)
+		}
+		b.WriteByte('}')
+	}
+	b.WriteString(`]}]`)
+	if !canonical {
+		b.WriteString(`,"default":null`)
+	}
+	b.WriteString(`},{"name":"after","type":["null","` + s.Name + `.Row"]`)
+	if !canonical {
+		b.WriteString(`,"default":null`)
+	}
+	b.WriteString(`}]}`)
+	return b.String()
+}
+
+// typeJSON returns the union branches of a column type after "null".
+func typeJSON(t Type, canonical bool) string {
+	switch t {
+	case String:
+		return `"string"`
+	case Bytes:
+		return `"bytes"`
+	case Number:
+		return `"long","string"`
+	case Float:
+		return `"float"`
+	case Double:
+		return `"double"`
+	case LocalTimestampMicros:
+		if canonical {
+			return `"long"`
+		}
+		return `{"type":"long","logicalType":"local-timestamp-micros"}`
+	case TimestampMicros:
+		if canonical {
+			return `"long"`
+		}
+		return `{"type":"long","logicalType":"timestamp-micros"}`
+	}
+	panic("avro: unknown column type")
+}
+
+// avroName replaces the characters of an Oracle name that Avro names may
+// not contain ($, # and anything in a quoted identifier) by '_'.
+func avroName(s string) string {
+	b := []byte(s)
+	for i, c := range b {
+		if !(c == '_' || c >= 'A' && c <= 'Z' || c >= 'a' && c <= 'z' || i > 0 && c >= '0' && c <= '9') {
+			b[i] = '_'
+		}
+	}
+	if len(b) == 0 {
+		return "_"
+	}
+	return string(b)
+}
+
+const fingerprintEmpty = 0xc15d213aa4d7a795
+
+var fingerprintTable [256]uint64
+
+func init() {
+	for i := range fingerprintTable {
+		fp := uint64(i)
+		for j := 0; j < 8; j++ {
+			fp = fp>>1 ^ fingerprintEmpty&-(fp&1)
+		}
+		fingerprintTable[i] = fp
+	}
+}
+
+// Fingerprint returns the CRC-64-AVRO (Rabin) fingerprint of b.
+func Fingerprint(b []byte) uint64 {
+	fp := uint64(fingerprintEmpty)
+	for _, c := range b {
+		fp = fp>>8 ^ fingerprintTable[byte(fp)^c]
+	}
+	return fp
+}
@@ -0,0 +1,112 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"context"
+	"fmt"
+	"sync"
+)
+
+// GetRecordContext is GetRecord bounded by ctx. OCI only allows a call to
+// be broken from another thread in an OCI_THREADED environment, so for a
+// connection opened WithRuntime, ctx being done while the connection waits
+// for the outbound server interrupts the wait with OCIBreak and ctx.Err()
+// is returned; the connection stays attached and can be read again. Other
+// connections check ctx between receive calls only, which return at least
+// once per batch with a heartbeat.
+func (x *XStreamConn) GetRecordContext(ctx context.Context) (Message, error) {
+	if err := ctx.Err(); err != nil {
+		return nil, err
+	}
+	if ctx.Done() == nil || x.thread == nil {
+		return x.GetRecord()
+	}
+	done := make(chan struct{})
+	go func() {
+		select {
+		case <-ctx.Done():
+			x.brk.interrupt(x.ocip)
+		case <-done:
+		}
+	}()
+	msg, err := x.GetRecord()
+	close(done)
+	if err != nil && ctx.Err() != nil {
+		if r := x.brk.resetErr(); r != nil {
+			return nil, fmt.Errorf("%w (%v)", ctx.Err(), r)
+		}
+		return nil, ctx.Err()
+	}
+	return msg, err
+}
+
+// breaker confines the break of GetRecordContext to the receive call. A
+// break landing on a later call, e.g. OCILCRFree, would fail it unnoticed,
+// so the call that was broken resets the protocol right after it returns.
+type breaker struct {
+	mu        sync.Mutex
+	receiving bool
+	broken    bool
+	failed    error // of the last reset
+}
+
+// enter starts a receive call.
+func (b *breaker) enter() {
+	b.mu.Lock()
+	b.receiving, b.broken, b.failed = true, false, nil
+	b.mu.Unlock()
+}
+
+// leave ends the receive call and reports whether it was broken.
+func (b *breaker) leave() bool {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	b.receiving = false
+	return b.broken
+}
+
+// interrupt breaks the receive call in progress, if any.
+func (b *breaker) interrupt(ocip *C.struct_oci) {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	if b.receiving && !b.broken {
+		C.break_call(ocip)
+		b.broken = true
+	}
+}
+
+func (b *breaker) resetErr() error {
+	b.mu.Lock()
+	defer b.mu.Unlock()
+	return b.failed
+}
+
+// receive receives the next LCR, resetting the protocol if the call was
+// broken, whether or not the break arrived in time to interrupt it.
+func (x *XStreamConn) receive() (C.sword, error) {
+	x.brk.enter()
+	status := C.receive_lcr(x.ocip)
+	if !x.brk.leave() {
+		return status, nil
+	}
+	if C.reset_call(x.ocip) != C.OCI_SUCCESS {
+		err := ociError("OCIReset", x.ocip.errp)
+		x.brk.mu.Lock()
+		x.brk.failed = err
+		x.brk.mu.Unlock()
+		return status, err
+	}
+	return status, nil
+}
+
+// freeLcr frees the LCR last received and clears the pointer to it, which
+// relay_lcrs also frees when it is set.
+func (x *XStreamConn) freeLcr() {
+	if x.ocip.lcrp != nil {
+		C.OCILCRFree(x.ocip.svcp, x.ocip.errp, x.ocip.lcrp, C.OCI_DEFAULT)
+		x.ocip.lcrp = nil
+	}
+}
@@ -0,0 +1,113 @@
+package charset
+
+import (
+	"unicode/utf16"
+	"unicode/utf8"
+
+	"golang.org/x/text/encoding/simplifiedchinese"
+	"golang.org/x/text/transform"
+)
+
+// Oracle character set ids of the built-in decoders.
+const (
+	Default       = 0
+	US7ASCII      = 1
+	WE8ISO8859P1  = 31
+	EE8ISO8859P2  = 32
+	CL8ISO8859P5  = 35
+	EL8ISO8859P7  = 37
+	WE8ISO8859P9  = 39
+	WE8ISO8859P15 = 46
+	EE8MSWIN1250  = 170
+	CL8MSWIN1251  = 171
+	EL8MSWIN1253  = 174
+	TR8MSWIN1254  = 177
+	WE8MSWIN1252  = 178
+	ZHS16GBK      = 852
+	UTF8          = 871
+	AL32UTF8      = 873
+	AL16UTF16     = 2000
+)
+
+func init() {
+	Register(Default, passthrough{})
+	Register(US7ASCII, ascii{})
+	for csid, table := range map[int]*[128]rune{
+		WE8ISO8859P1:  &we8iso8859p1,
+		EE8ISO8859P2:  &ee8iso8859p2,
+		CL8ISO8859P5:  &cl8iso8859p5,
+		EL8ISO8859P7:  &el8iso8859p7,
+		WE8ISO8859P9:  &we8iso8859p9,
+		WE8ISO8859P15: &we8iso8859p15,
+		EE8MSWIN1250:  &ee8mswin1250,
+		CL8MSWIN1251:  &cl8mswin1251,
+		EL8MSWIN1253:  &el8mswin1253,
+		TR8MSWIN1254:  &tr8mswin1254,
+		WE8MSWIN1252:  &we8mswin1252,
+	} {
+		Register(csid, newSingleByte(table))
+	}
+	Register(ZHS16GBK, &transformer{t: simplifiedchinese.GBK.NewDecoder().Transformer})
+	Register(UTF8, utf8Decoder{})
+	Register(AL32UTF8, utf8Decoder{})
+	Register(AL16UTF16, DecoderFunc(decodeUTF16LE))
+}
+
+// passthrough copies bytes unchanged.
+type passthrough struct{}
+
+func (passthrough) asciiCompatible() {}
+
+func (passthrough) Decode(dst, src []byte) ([]byte, error) {
+	return append(dst, src...), nil
+}
+
+// transformer wraps a stateless x/text transformer, such as the GBK
+// decoder, behind an ASCII fast path. Runs of ASCII are copied directly and
+// only the remainder is passed to the transformer.
+type transformer struct {
+	t transform.Transformer
+}
+
+func (*transformer) asciiCompatible() {}
+
+func (d *transformer) Decode(dst, src []byte) ([]byte, error) {
+	n := ASCIIPrefix(src)
+	dst = grow(dst, len(src)+len(src)/2)
+	dst = append(dst, src[:n]...)
+	src = src[n:]
+	for len(src) > 0 {
+		dst = grow(dst, len(src)+len(src)/2)
+		nDst, nSrc, err := d.t.Transform(dst[len(dst):cap(dst)], src, true)
+		dst = dst[:len(dst)+nDst]
+		src = src[nSrc:]
+		if err == transform.ErrShortDst {
+			dst = grow(dst, 2*len(src)+utf8.UTFMax)
+			continue
+		}
+		if err != nil {
+			return dst, err
+		}
+	}
+	return dst, nil
+}
+
+// decodeUTF16LE decodes AL16UTF16 as delivered by OCI, in little endian
+// byte order.
+func decodeUTF16LE(dst, src []byte) ([]byte, error) {
+	dst = grow(dst, len(src))
+	var buf [utf8.UTFMax]byte
+	for i := 0; i+1 < len(src); i += 2 {
+		r := rune(uint16(src[i]) | uint16(src[i+1])<<8)
+		if utf16.IsSurrogate(r) && i+3 < len(src) {
+			r2 := rune(uint16(src[i+2]) | uint16(src[i+3])<<8)
+			if dec := utf16.DecodeRune(r, r2); dec != utf8.RuneError {
+				r = dec
+				i += 2
+			}
+		}
+		n := utf8.EncodeRune(buf[:], r)
+		dst = append(dst, buf[:n]...)
+	}
+	return dst, nil
+}
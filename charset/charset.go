@@ -0,0 +1,102 @@
+// Package charset converts column text from Oracle character sets to UTF-8.
+//
+// Decoders are registered per Oracle character set id (csid) and append
+// their output to a caller supplied buffer, so a connection can decode every
+// value through one reusable scratch slice. All built-in decoders are
+// stateless and safe for concurrent use.
+package charset
+
+import (
+	"encoding/binary"
+	"fmt"
+	"sync"
+	"sync/atomic"
+)
+
+// Decoder converts src to UTF-8 and appends the result to dst.
+type Decoder interface {
+	Decode(dst, src []byte) ([]byte, error)
+}
+
+// DecoderFunc adapts a function to the Decoder interface.
+type DecoderFunc func(dst, src []byte) ([]byte, error)
+
+func (f DecoderFunc) Decode(dst, src []byte) ([]byte, error) {
+	return f(dst, src)
+}
+
+// asciiCompatible is implemented by decoders whose character set encodes
+// 0x00-0x7F as ASCII, which lets String skip the decoder for pure ASCII.
+type asciiCompatible interface {
+	asciiCompatible()
+}
+
+var (
+	mu       sync.Mutex
+	registry atomic.Value // map[int]Decoder, copied on write
+)
+
+// Register installs d as the decoder for csid, replacing any previous one.
+func Register(csid int, d Decoder) {
+	mu.Lock()
+	defer mu.Unlock()
+	old, _ := registry.Load().(map[int]Decoder)
+	m := make(map[int]Decoder, len(old)+1)
+	for k, v := range old {
+		m[k] = v
+	}
+	m[csid] = d
+	registry.Store(m)
+}
+
+// Lookup returns the decoder registered for csid.
+func Lookup(csid int) (Decoder, error) {
+	m, _ := registry.Load().(map[int]Decoder)
+	if d, ok := m[csid]; ok {
+		return d, nil
+	}
+	return nil, fmt.Errorf("charset: csid %d not registered", csid)
+}
+
+// String decodes src into a string, using scratch as the intermediate
+// buffer. It returns scratch, possibly grown, for reuse by the caller.
+func String(d Decoder, src, scratch []byte) (string, []byte, error) {
+	if v, ok := d.(validator); ok {
+		if v.Valid(src) {
+			return string(src), scratch, nil
+		}
+	} else if _, ok := d.(asciiCompatible); ok && ASCIIPrefix(src) == len(src) {
+		return string(src), scratch, nil
+	}
+	out, err := d.Decode(scratch[:0], src)
+	if err != nil {
+		return "", out, err
+	}
+	return string(out), out, nil
+}
+
+const highBits = 0x8080808080808080
+
+// ASCIIPrefix returns the length of the leading run of ASCII bytes in b,
+// testing eight bytes at a time.
+func ASCIIPrefix(b []byte) int {
+	i := 0
+	for ; i+8 <= len(b); i += 8 {
+		if binary.LittleEndian.Uint64(b[i:])&highBits != 0 {
+			break
+		}
+	}
+	for ; i < len(b) && b[i] < 0x80; i++ {
+	}
+	return i
+}
+
+// grow makes room for n more bytes in dst.
+func grow(dst []byte, n int) []byte {
+	if cap(dst)-len(dst) >= n {
+		return dst
+	}
+	nb := make([]byte, len(dst), 2*cap(dst)+n)
+	copy(nb, dst)
+	return nb
+}
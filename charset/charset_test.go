@@ -0,0 +1,129 @@
+package charset
+
+import (
+	"strings"
+	"testing"
+	"unicode/utf8"
+)
+
+func TestASCIIPrefix(t *testing.T) {
+	for _, c := range []struct {
+		in   string
+		want int
+	}{
+		{"", 0},
+		{"abc", 3},
+		{"0123456789abcdef", 16},
+		{"0123456789\xe9bcdef", 10},
+		{"\x80", 0},
+	} {
+		if got := ASCIIPrefix([]byte(c.in)); got != c.want {
+			t.Errorf("ASCIIPrefix(%q) = %d, want %d", c.in, got, c.want)
+		}
+	}
+}
+
+func TestSingleByte(t *testing.T) {
+	cases := []struct {
+		csid int
+		in   string
+		want string
+	}{
+		{WE8MSWIN1252, "caf\xe9 \x80 long ascii run here", "café € long ascii run here"},
+		{WE8ISO8859P1, "\xc4\xd6\xdc", "ÄÖÜ"},
+		{WE8ISO8859P15, "\xa4", "€"},
+		{CL8MSWIN1251, "\xcf\xf0\xe8\xe2\xe5\xf2", "Привет"},
+		{US7ASCII, "a\xffb", "a�b"},
+	}
+	for _, c := range cases {
+		d, err := Lookup(c.csid)
+		if err != nil {
+			t.Fatal(err)
+		}
+		got, err := d.Decode([]byte("prefix:"), []byte(c.in))
+		if err != nil || string(got) != "prefix:"+c.want {
+			t.Errorf("csid %d: got %q, %v", c.csid, got, err)
+		}
+	}
+}
+
+func TestString(t *testing.T) {
+	d, _ := Lookup(WE8MSWIN1252)
+	ascii := strings.Repeat("plain ascii ", 10)
+	s, scratch, err := String(d, []byte(ascii), nil)
+	if err != nil || s != ascii || scratch != nil {
+		t.Fatalf("ascii fast path: %q %v", s, err)
+	}
+	s, scratch, err = String(d, []byte("na\xefve"), make([]byte, 0, 64))
+	if err != nil || s != "naïve" || cap(scratch) != 64 {
+		t.Fatalf("got %q cap %d %v", s, cap(scratch), err)
+	}
+}
+
+func TestUTF16(t *testing.T) {
+	d, _ := Lookup(AL16UTF16)
+	got, _ := d.Decode(nil, []byte{'h', 0, 0x2d, 0x4e, 0x3d, 0xd8, 0x00, 0xde})
+	if string(got) != "h中😀" {
+		t.Fatalf("got %q", got)
+	}
+}
+
+func TestRegister(t *testing.T) {
+	if _, err := Lookup(9999); err == nil {
+		t.Fatal("expected error for unknown csid")
+	}
+	Register(9999, DecoderFunc(func(dst, src []byte) ([]byte, error) {
+		return append(dst, strings.ToUpper(string(src))...), nil
+	}))
+	d, err := Lookup(9999)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if got, _ := d.Decode(nil, []byte("x")); string(got) != "X" {
+		t.Fatalf("got %q", got)
+	}
+}
+
+func BenchmarkDecodeASCII(b *testing.B) {
+	d, _ := Lookup(WE8MSWIN1252)
+	src := []byte(strings.Repeat("The quick brown fox jumps over the lazy dog. ", 20))
+	dst := make([]byte, 0, len(src))
+	b.SetBytes(int64(len(src)))
+	for i := 0; i < b.N; i++ {
+		dst, _ = d.Decode(dst[:0], src)
+	}
+}
+
+func TestValidUTF8(t *testing.T) {
+	long := strings.Repeat("ascii only text ", 4)
+	for _, s := range []string{
+		"", long, long + "中文" + long, "é", "😀" + long,
+		"\xff", long + "\xe4\xb8", "a\xc0\x80", long + "\xed\xa0\x80",
+	} {
+		if got, want := ValidUTF8([]byte(s)), utf8.ValidString(s); got != want {
+			t.Errorf("ValidUTF8(%q) = %v, want %v", s, got, want)
+		}
+	}
+}
+
+func TestUTF8Decoder(t *testing.T) {
+	d, _ := Lookup(AL32UTF8)
+	s, _, err := String(d, []byte("valid 中文"), nil)
+	if err != nil || s != "valid 中文" {
+		t.Fatalf("got %q %v", s, err)
+	}
+	got, _ := d.Decode(nil, []byte("bad\xffbyte\xe4\xb8"))
+	if string(got) != "bad�byte��" {
+		t.Fatalf("got %q", got)
+	}
+}
+
+func BenchmarkValidUTF8(b *testing.B) {
+	src := []byte(strings.Repeat("The quick brown fox jumps over the lazy dog. 中文 ", 20))
+	b.SetBytes(int64(len(src)))
+	for i := 0; i < b.N; i++ {
+		if !ValidUTF8(src) {
+			b.Fatal("invalid")
+		}
+	}
+}
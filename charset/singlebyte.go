@@ -0,0 +1,56 @@
+package charset
+
+import "unicode/utf8"
+
+// singleByte decodes an ASCII compatible single-byte character set through a
+// table holding the UTF-8 encoding of each byte in the high half.
+type singleByte struct {
+	utf [128][3]byte
+	n   [128]uint8
+}
+
+func newSingleByte(high *[128]rune) *singleByte {
+	d := &singleByte{}
+	for i, r := range high {
+		var buf [utf8.UTFMax]byte
+		d.n[i] = uint8(utf8.EncodeRune(buf[:], r))
+		copy(d.utf[i][:], buf[:d.n[i]])
+	}
+	return d
+}
+
+func (*singleByte) asciiCompatible() {}
+
+func (d *singleByte) Decode(dst, src []byte) ([]byte, error) {
+	dst = grow(dst, len(src))
+	for len(src) > 0 {
+		n := ASCIIPrefix(src)
+		dst = append(dst, src[:n]...)
+		src = src[n:]
+		for len(src) > 0 && src[0] >= 0x80 {
+			c := src[0] - 0x80
+			dst = append(dst, d.utf[c][:d.n[c]]...)
+			src = src[1:]
+		}
+	}
+	return dst, nil
+}
+
+// ascii decodes US7ASCII; bytes with the high bit set become U+FFFD.
+type ascii struct{}
+
+func (ascii) asciiCompatible() {}
+
+func (ascii) Decode(dst, src []byte) ([]byte, error) {
+	dst = grow(dst, len(src))
+	for len(src) > 0 {
+		n := ASCIIPrefix(src)
+		dst = append(dst, src[:n]...)
+		src = src[n:]
+		for len(src) > 0 && src[0] >= 0x80 {
+			dst = append(dst, "�"...)
+			src = src[1:]
+		}
+	}
+	return dst, nil
+}
@@ -0,0 +1,78 @@
+package charset
+
+import (
+	"encoding/binary"
+	"unicode/utf8"
+)
+
+// utf8Decoder handles AL32UTF8 text, which needs no conversion. Valid input
+// is passed through unchanged; invalid sequences become U+FFFD.
+type utf8Decoder struct{}
+
+func (utf8Decoder) asciiCompatible() {}
+
+func (utf8Decoder) Valid(src []byte) bool {
+	return ValidUTF8(src)
+}
+
+func (utf8Decoder) Decode(dst, src []byte) ([]byte, error) {
+	if ValidUTF8(src) {
+		return append(dst, src...), nil
+	}
+	dst = grow(dst, len(src)+len(src)/2)
+	for len(src) > 0 {
+		n := ASCIIPrefix(src)
+		dst = append(dst, src[:n]...)
+		src = src[n:]
+		if len(src) == 0 {
+			break
+		}
+		r, size := utf8.DecodeRune(src)
+		if r == utf8.RuneError && size == 1 {
+			dst = append(dst, "�"...)
+		} else {
+			dst = append(dst, src[:size]...)
+		}
+		src = src[size:]
+	}
+	return dst, nil
+}
+
+// validator is implemented by decoders that can tell that src needs no
+// conversion at all, letting String copy it directly.
+type validator interface {
+	Valid(src []byte) bool
+}
+
+// ValidUTF8 reports whether b is valid UTF-8. ASCII runs are skipped
+// sixteen bytes per step; only the bytes around multi-byte sequences are
+// decoded individually.
+func ValidUTF8(b []byte) bool {
+	for len(b) > 0 {
+		for len(b) >= 16 {
+			w0 := binary.LittleEndian.Uint64(b)
+			w1 := binary.LittleEndian.Uint64(b[8:])
+			if (w0|w1)&highBits != 0 {
+				break
+			}
+			b = b[16:]
+		}
+		n := ASCIIPrefix(b)
+		b = b[n:]
+		// validate the non-ASCII stretch up to the next ASCII byte
+		for len(b) > 0 && b[0] >= 0x80 {
+			r, size := utf8.DecodeRune(b)
+			if r == utf8.RuneError && size == 1 {
+				return false
+			}
+			b = b[size:]
+		}
+	}
+	return true
+}
+
+// Passthrough returns a decoder that copies bytes without validation, for
+// sources whose encoding is trusted to match the expected one.
+func Passthrough() Decoder {
+	return passthrough{}
+}
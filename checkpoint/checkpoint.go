@@ -0,0 +1,393 @@
+// Package checkpoint stores the positions of stream consumers, each under
+// a name, in a single file written with group commit: Set only records a
+// position in memory, and a background syncer writes every position set
+// in the last sync interval at once, to a temporary file that is fsynced
+// and renamed over the previous one. However many consumers checkpoint
+// however often, there is one fsync per interval, and a crash leaves
+// either the old or the new file.
+//
+// The file holds:
+//
+//	magic      4 bytes, "XCP1"
+//	crc        4 bytes, CRC-32C of the rest
+//	count      uvarint
+//	per checkpoint, by name:
+//	  name     uvarint length and bytes
+//	  scn      8 bytes, little endian
+//	  position uvarint length + 1 and bytes, 0 for none
+package checkpoint
+
+import (
+	"encoding/binary"
+	"errors"
+	"hash/crc32"
+	"io/ioutil"
+	"os"
+	"path/filepath"
+	"sort"
+	"sync"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+const (
+	magic   = "XCP1"
+	tmpName = ".tmp"
+)
+
+var (
+	// ErrClosed is returned by operations on a closed store.
+	ErrClosed = errors.New("checkpoint: store closed")
+	// ErrCorrupt is returned by Open for a checkpoint file failing its
+	// checksum.
+	ErrCorrupt = errors.New("checkpoint: corrupt file")
+)
+
+var crcTable = crc32.MakeTable(crc32.Castagnoli)
+
+// Checkpoint is the position a consumer has processed the stream up to.
+type Checkpoint struct {
+	SCN scn.SCN
+	// Position is the raw LCR position, the Position of the last Commit or
+	// HeartBeat processed, nil if only the SCN is known. It takes
+	// precedence over SCN when resuming.
+	Position []byte
+}
+
+// Option configures a Store.
+type Option func(*options)
+
+type options struct {
+	syncInterval time.Duration
+}
+
+// WithSyncInterval sets the group commit window: how long a checkpoint
+// may wait for the fsync that makes it durable. The default is 10ms.
+func WithSyncInterval(d time.Duration) Option {
+	return func(o *options) {
+		o.syncInterval = d
+	}
+}
+
+// Store is a checkpoint file. It is safe for concurrent use.
+type Store struct {
+	path string
+	opts options
+
+	mu      sync.Mutex
+	current map[string]Checkpoint
+	version uint64 // of current, counting changes
+	durable uint64 // version on disk
+	notify  chan struct{}
+	err     error
+	closing bool // Close was called
+	closed  bool
+
+	syncReq chan struct{}
+	stop    chan struct{}
+	done    chan struct{}
+}
+
+// Open opens the checkpoint file at path, creating its directory if
+// needed, loads the checkpoints it holds and starts the syncer.
+func Open(path string, opts ...Option) (*Store, error) {
+	o := options{syncInterval: 10 * time.Millisecond}
+	for _, opt := range opts {
+		opt(&o)
+	}
+	if err := os.MkdirAll(filepath.Dir(path), 0755); err != nil {
+		return nil, err
+	}
+	// a temporary file is left by a write that was not renamed
+	if err := os.Remove(path + tmpName); err != nil && !os.IsNotExist(err) {
+		return nil, err
+	}
+	current, err := load(path)
+	if err != nil {
+		return nil, err
+	}
+	s := &Store{
+		path:    path,
+		opts:    o,
+		current: current,
+		notify:  make(chan struct{}),
+		syncReq: make(chan struct{}, 1),
+		stop:    make(chan struct{}),
+		done:    make(chan struct{}),
+	}
+	go s.syncer()
+	return s, nil
+}
+
+func load(path string) (map[string]Checkpoint, error) {
+	b, err := ioutil.ReadFile(path)
+	if os.IsNotExist(err) {
+		return map[string]Checkpoint{}, nil
+	}
+	if err != nil {
+		return nil, err
+	}
+	if len(b) < 8 || string(b[:4]) != magic ||
+		binary.LittleEndian.Uint32(b[4:]) != crc32.Checksum(b[8:], crcTable) {
+		return nil, ErrCorrupt
+	}
+	return decode(b[8:])
+}
+
+func decode(b []byte) (map[string]Checkpoint, error) {
+	next := func(n uint64) []byte {
+		if n > uint64(len(b)) {
+			return nil
+		}
+		v := b[:n:n]
+		b = b[n:]
+		return v
+	}
+	uvarint := func() (uint64, bool) {
+		v, n := binary.Uvarint(b)
+		if n <= 0 {
+			return 0, false
+		}
+		b = b[n:]
+		return v, true
+	}
+	count, ok := uvarint()
+	if !ok || count > uint64(len(b)) {
+		return nil, ErrCorrupt
+	}
+	m := make(map[string]Checkpoint, count)
+	for i := uint64(0); i < count; i++ {
+		n, ok := uvarint()
+		name := next(n)
+		if !ok || name == nil && n != 0 {
+			return nil, ErrCorrupt
+		}
+		v := next(8)
+		if v == nil {
+			return nil, ErrCorrupt
+		}
+		c := Checkpoint{SCN: scn.SCN(binary.LittleEndian.Uint64(v))}
+		if n, ok = uvarint(); !ok {
+			return nil, ErrCorrupt
+		}
+		if n > 0 {
+			if c.Position = next(n - 1); c.Position == nil && n > 1 {
+				return nil, ErrCorrupt
+			}
+			c.Position = append([]byte{}, c.Position...)
+		}
+		m[string(name)] = c
+	}
+	if len(b) != 0 {
+		return nil, ErrCorrupt
+	}
+	return m, nil
+}
+
+// encode returns the file contents for the current checkpoints. s.mu is
+// held.
+func (s *Store) encode() []byte {
+	names := make([]string, 0, len(s.current))
+	for name := range s.current {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	b := make([]byte, 8, 64)
+	copy(b, magic)
+	b = appendUvarint(b, uint64(len(names)))
+	for _, name := range names {
+		c := s.current[name]
+		b = append(appendUvarint(b, uint64(len(name))), name...)
+		var v [8]byte
+		binary.LittleEndian.PutUint64(v[:], uint64(c.SCN))
+		b = append(b, v[:]...)
+		if c.Position == nil {
+			b = append(b, 0)
+		} else {
+			b = append(appendUvarint(b, uint64(len(c.Position))+1), c.Position...)
+		}
+	}
+	binary.LittleEndian.PutUint32(b[4:], crc32.Checksum(b[8:], crcTable))
+	return b
+}
+
+func appendUvarint(b []byte, v uint64) []byte {
+	var buf [binary.MaxVarintLen64]byte
+	return append(b, buf[:binary.PutUvarint(buf[:], v)]...)
+}
+
+// Get returns the last checkpoint set under name, durable or not.
+func (s *Store) Get(name string) (Checkpoint, bool) {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	c, ok := s.current[name]
+	return c, ok
+}
+
+// Names returns the names checkpoints are stored under, sorted.
+func (s *Store) Names() []string {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	names := make([]string, 0, len(s.current))
+	for name := range s.current {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	return names
+}
+
+// Set records the checkpoint of a consumer, to be written with the next
+// group commit. It does not wait; use Commit or Sync for that.
+func (s *Store) Set(name string, c Checkpoint) error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.closed {
+		return ErrClosed
+	}
+	if s.err != nil {
+		return s.err
+	}
+	if c.Position != nil {
+		c.Position = append([]byte{}, c.Position...)
+	}
+	s.current[name] = c
+	s.version++
+	return nil
+}
+
+// Delete removes the checkpoint of a consumer with the next group commit.
+func (s *Store) Delete(name string) error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	if s.closed {
+		return ErrClosed
+	}
+	if _, ok := s.current[name]; ok {
+		delete(s.current, name)
+		s.version++
+	}
+	return s.err
+}
+
+// Commit sets the checkpoint of a consumer and waits until it is durable.
+func (s *Store) Commit(name string, c Checkpoint) error {
+	if err := s.Set(name, c); err != nil {
+		return err
+	}
+	return s.Sync()
+}
+
+// Sync waits until every checkpoint set so far is durable, joining the
+// next group commit rather than forcing one of its own.
+func (s *Store) Sync() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	target := s.version
+	for s.durable < target && s.err == nil && !s.closed {
+		ch := s.notify
+		s.mu.Unlock()
+		select {
+		case s.syncReq <- struct{}{}:
+		default:
+		}
+		<-ch
+		s.mu.Lock()
+	}
+	if s.err != nil {
+		return s.err
+	}
+	if s.durable < target {
+		return ErrClosed
+	}
+	return nil
+}
+
+func (s *Store) syncer() {
+	defer close(s.done)
+	t := time.NewTicker(s.opts.syncInterval)
+	defer t.Stop()
+	for {
+		select {
+		case <-s.stop:
+			s.sync()
+			return
+		case <-t.C:
+		case <-s.syncReq:
+		}
+		s.sync()
+	}
+}
+
+// sync writes the checkpoints out if they changed, outside the lock so
+// Set can go on meanwhile.
+func (s *Store) sync() {
+	s.mu.Lock()
+	if s.durable == s.version || s.err != nil {
+		s.mu.Unlock()
+		return
+	}
+	version := s.version
+	b := s.encode()
+	s.mu.Unlock()
+
+	err := s.write(b)
+
+	s.mu.Lock()
+	if err != nil {
+		s.err = err
+	} else {
+		s.durable = version
+	}
+	close(s.notify)
+	s.notify = make(chan struct{})
+	s.mu.Unlock()
+}
+
+// write replaces the file with b atomically.
+func (s *Store) write(b []byte) error {
+	tmp := s.path + tmpName
+	f, err := os.OpenFile(tmp, os.O_CREATE|os.O_TRUNC|os.O_WRONLY, 0644)
+	if err != nil {
+		return err
+	}
+	if _, err = f.Write(b); err == nil {
+		err = f.Sync()
+	}
+	if cerr := f.Close(); err == nil {
+		err = cerr
+	}
+	if err != nil {
+		return err
+	}
+	if err := os.Rename(tmp, s.path); err != nil {
+		return err
+	}
+	return syncDir(filepath.Dir(s.path))
+}
+
+// Err returns the write error that stopped the store, if any.
+func (s *Store) Err() error {
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	return s.err
+}
+
+// Close writes out the checkpoints set and closes the store.
+func (s *Store) Close() error {
+	s.mu.Lock()
+	if s.closing {
+		s.mu.Unlock()
+		return ErrClosed
+	}
+	s.closing = true
+	s.mu.Unlock()
+	close(s.stop)
+	<-s.done
+	s.mu.Lock()
+	defer s.mu.Unlock()
+	s.closed = true
+	close(s.notify)
+	s.notify = make(chan struct{})
+	return s.err
+}
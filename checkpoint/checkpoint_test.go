@@ -0,0 +1,143 @@
+package checkpoint
+
+import (
+	"fmt"
+	"os"
+	"path/filepath"
+	"reflect"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+func TestCommitAndReopen(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "consumers", "checkpoints")
+	s, err := Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, ok := s.Get("a"); ok {
+		t.Fatal("checkpoint in a new store")
+	}
+	want := map[string]Checkpoint{
+		"a":     {SCN: 100},
+		"b":     {SCN: 200, Position: []byte{1, 2, 3}},
+		"empty": {SCN: 300, Position: []byte{}},
+	}
+	for name, c := range want {
+		if err := s.Commit(name, c); err != nil {
+			t.Fatal(err)
+		}
+	}
+	s.Set("gone", Checkpoint{SCN: 1})
+	s.Delete("gone")
+	if err := s.Close(); err != nil {
+		t.Fatal(err)
+	}
+	if err := s.Set("a", Checkpoint{}); err != ErrClosed {
+		t.Fatalf("set on a closed store: %v", err)
+	}
+
+	if s, err = Open(path); err != nil {
+		t.Fatal(err)
+	}
+	defer s.Close()
+	if names := s.Names(); !reflect.DeepEqual(names, []string{"a", "b", "empty"}) {
+		t.Fatalf("names %v", names)
+	}
+	for name, c := range want {
+		if got, _ := s.Get(name); !reflect.DeepEqual(got, c) {
+			t.Fatalf("%s: %+v, want %+v", name, got, c)
+		}
+	}
+}
+
+func TestGroupCommit(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "checkpoints")
+	s, err := Open(path, WithSyncInterval(time.Hour))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer s.Close()
+	var wg sync.WaitGroup
+	for i := 0; i < 8; i++ {
+		wg.Add(1)
+		go func(i int) {
+			defer wg.Done()
+			name := fmt.Sprint("consumer", i)
+			for j := 1; j <= 50; j++ {
+				if err := s.Commit(name, Checkpoint{SCN: scn.SCN(1000*i + j)}); err != nil {
+					t.Error(err)
+					return
+				}
+			}
+		}(i)
+	}
+	wg.Wait()
+	got, err := load(path)
+	if err != nil || len(got) != 8 {
+		t.Fatalf("%d checkpoints on disk: %v", len(got), err)
+	}
+	for name, c := range got {
+		var i int
+		fmt.Sscan(name[len("consumer"):], &i)
+		if c.SCN != scn.SCN(1000*i+50) {
+			t.Fatalf("%s at %d on disk", name, c.SCN)
+		}
+	}
+}
+
+func TestCorruptFile(t *testing.T) {
+	path := filepath.Join(t.TempDir(), "checkpoints")
+	s, err := Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	s.Commit("a", Checkpoint{SCN: 1, Position: []byte("position")})
+	s.Close()
+	b, _ := os.ReadFile(path)
+	b[len(b)-1] ^= 1
+	os.WriteFile(path, b, 0644)
+	if _, err := Open(path); err != ErrCorrupt {
+		t.Fatalf("open of a corrupt file: %v", err)
+	}
+	// a torn temporary file is ignored
+	os.WriteFile(path+tmpName, b[:5], 0644)
+	b[len(b)-1] ^= 1
+	os.WriteFile(path, b, 0644)
+	s, err = Open(path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if c, _ := s.Get("a"); string(c.Position) != "position" {
+		t.Fatalf("recovered %+v", c)
+	}
+	s.Close()
+}
+
+func TestConcurrentClose(t *testing.T) {
+	s, err := Open(filepath.Join(t.TempDir(), "checkpoints"))
+	if err != nil {
+		t.Fatal(err)
+	}
+	s.Set("a", Checkpoint{SCN: 1})
+	errs := make(chan error, 4)
+	for i := 0; i < cap(errs); i++ {
+		go func() { errs <- s.Close() }()
+	}
+	closed := 0
+	for i := 0; i < cap(errs); i++ {
+		switch err := <-errs; err {
+		case nil:
+			closed++
+		case ErrClosed:
+		default:
+			t.Fatal(err)
+		}
+	}
+	if closed != 1 {
+		t.Fatalf("%d Close calls succeeded", closed)
+	}
+}
@@ -0,0 +1,7 @@
+package checkpoint
+
+// syncDir does nothing on Windows, where a directory cannot be opened for
+// fsync and NTFS journals the rename itself.
+func syncDir(dir string) error {
+	return nil
+}
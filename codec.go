@@ -0,0 +1,319 @@
+package goxstream
+
+import (
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/oraBinary"
+	"github.com/yjhatfdu/goxstream/oraTime"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// ErrMessageEncoding is returned by DecodeMessage for malformed input.
+var ErrMessageEncoding = errors.New("goxstream: malformed message encoding")
+
+const (
+	msgCommit = iota + 1
+	msgInsert
+	msgUpdate
+	msgDelete
+	msgHeartBeat
+)
+
+const (
+	valNull = iota
+	valString
+	valInt
+	valFloat32
+	valFloat64
+	valBytes
+	valTime
+	valIntervalYM
+	valIntervalDS
+	valRowid
+)
+
+// AppendMessage appends a compact binary encoding of m to b, for storing
+// messages, e.g. in a Spool. The AvroSchema of a row message is not kept;
+// the Avro event carries the schema fingerprint.
+func AppendMessage(b []byte, m Message) ([]byte, error) {
+	switch m := m.(type) {
+	case *Commit:
+		b = appendTime(appendUvarint(append(b, msgCommit), uint64(m.SCN)), m.SourceTime)
+		return appendBytes(b, m.Position), nil
+	case *HeartBeat:
+		return appendBytes(appendUvarint(append(b, msgHeartBeat), uint64(m.SCN)), m.Position), nil
+	case *Insert:
+		b = appendRowHeader(append(b, msgInsert), m.SCN, m.SourceTime, m.Owner, m.Table)
+		b, err := appendRow(b, m.NewColumn, m.NewRow)
+		return appendBlobs(b, m.Key, nil, m.JSON, m.Avro), err
+	case *Delete:
+		b = appendRowHeader(append(b, msgDelete), m.SCN, m.SourceTime, m.Owner, m.Table)
+		b, err := appendRow(b, m.OldColumn, m.OldRow)
+		return appendBlobs(b, m.Key, nil, m.JSON, m.Avro), err
+	case *Update:
+		b = appendRowHeader(append(b, msgUpdate), m.SCN, m.SourceTime, m.Owner, m.Table)
+		b, err := appendRow(b, m.OldColumn, m.OldRow)
+		if err != nil {
+			return b, err
+		}
+		b, err = appendRow(b, m.NewColumn, m.NewRow)
+		return appendBlobs(b, m.Key, m.NewKey, m.JSON, m.Avro), err
+	}
+	return b, fmt.Errorf("goxstream: cannot encode message %T", m)
+}
+
+func appendRowHeader(b []byte, s scn.SCN, t time.Time, owner, table string) []byte {
+	b = appendTime(appendUvarint(b, uint64(s)), t)
+	return appendString(appendString(b, owner), table)
+}
+
+func appendRow(b []byte, columns []string, row []interface{}) ([]byte, error) {
+	b = appendUvarint(b, uint64(len(columns)))
+	for i, c := range columns {
+		b = appendString(b, c)
+		var err error
+		if b, err = appendValue(b, row[i]); err != nil {
+			return b, err
+		}
+	}
+	return b, nil
+}
+
+func appendValue(b []byte, v interface{}) ([]byte, error) {
+	switch v := v.(type) {
+	case nil:
+		return append(b, valNull), nil
+	case string:
+		return appendString(append(b, valString), v), nil
+	case int64:
+		return appendVarint(append(b, valInt), v), nil
+	case float32:
+		return appendUint64(append(b, valFloat32), uint64(math.Float32bits(v)), 4), nil
+	case float64:
+		return appendUint64(append(b, valFloat64), math.Float64bits(v), 8), nil
+	case []byte:
+		return appendBytes(append(b, valBytes), v), nil
+	case time.Time:
+		return appendTime(append(b, valTime), v), nil
+	case oraTime.IntervalYM:
+		return appendVarint(appendVarint(append(b, valIntervalYM), int64(v.Years)), int64(v.Months)), nil
+	case oraTime.IntervalDS:
+		return appendVarint(appendVarint(append(b, valIntervalDS), int64(v.Days)), v.Nanos), nil
+	case oraBinary.Rowid:
+		b = appendUvarint(append(b, valRowid), uint64(v.Object))
+		b = appendUvarint(b, uint64(v.File))
+		b = appendUvarint(b, uint64(v.Block))
+		return appendUvarint(b, uint64(v.Row)), nil
+	}
+	return b, fmt.Errorf("goxstream: cannot encode value %T", v)
+}
+
+// appendTime keeps the zone offset, not the location, as MarshalBinary.
+// Offsets MarshalBinary cannot represent are converted to UTC.
+func appendTime(b []byte, t time.Time) []byte {
+	tb, err := t.MarshalBinary()
+	if err != nil {
+		tb, _ = t.UTC().MarshalBinary()
+	}
+	return appendBytes(b, tb)
+}
+
+func appendString(b []byte, s string) []byte {
+	return append(appendUvarint(b, uint64(len(s))), s...)
+}
+
+// appendBytes keeps nil apart from empty, since nil Keys mean no key.
+func appendBytes(b, v []byte) []byte {
+	if v == nil {
+		return append(b, 0)
+	}
+	return append(appendUvarint(b, uint64(len(v))+1), v...)
+}
+
+func appendBlobs(b []byte, blobs ...[]byte) []byte {
+	for _, v := range blobs {
+		b = appendBytes(b, v)
+	}
+	return b
+}
+
+func appendUvarint(b []byte, v uint64) []byte {
+	var buf [binary.MaxVarintLen64]byte
+	return append(b, buf[:binary.PutUvarint(buf[:], v)]...)
+}
+
+func appendVarint(b []byte, v int64) []byte {
+	var buf [binary.MaxVarintLen64]byte
+	return append(b, buf[:binary.PutVarint(buf[:], v)]...)
+}
+
+// appendUint64 appends the low n bytes of v, little endian.
+func appendUint64(b []byte, v uint64, n int) []byte {
+	for i := 0; i < n; i++ {
+		b = append(b, byte(v>>(8*i)))
+	}
+	return b
+}
+
+// DecodeMessage decodes a message encoded by AppendMessage. The message
+// does not refer to b.
+func DecodeMessage(b []byte) (Message, error) {
+	d := msgDecoder{b: b}
+	var m Message
+	switch d.byte() {
+	case msgCommit:
+		m = &Commit{SCN: scn.SCN(d.uvarint()), SourceTime: d.time(), Position: d.bytes()}
+	case msgHeartBeat:
+		m = &HeartBeat{SCN: scn.SCN(d.uvarint()), Position: d.bytes()}
+	case msgInsert:
+		r := &Insert{SCN: scn.SCN(d.uvarint()), SourceTime: d.time(), Owner: d.string(), Table: d.string()}
+		r.NewColumn, r.NewRow = d.row()
+		r.Key, _, r.JSON, r.Avro = d.bytes(), d.bytes(), d.bytes(), d.bytes()
+		m = r
+	case msgDelete:
+		r := &Delete{SCN: scn.SCN(d.uvarint()), SourceTime: d.time(), Owner: d.string(), Table: d.string()}
+		r.OldColumn, r.OldRow = d.row()
+		r.Key, _, r.JSON, r.Avro = d.bytes(), d.bytes(), d.bytes(), d.bytes()
+		m = r
+	case msgUpdate:
+		r := &Update{SCN: scn.SCN(d.uvarint()), SourceTime: d.time(), Owner: d.string(), Table: d.string()}
+		r.OldColumn, r.OldRow = d.row()
+		r.NewColumn, r.NewRow = d.row()
+		r.Key, r.NewKey, r.JSON, r.Avro = d.bytes(), d.bytes(), d.bytes(), d.bytes()
+		m = r
+	default:
+		return nil, ErrMessageEncoding
+	}
+	if d.err != nil || len(d.b) != 0 {
+		return nil, ErrMessageEncoding
+	}
+	return m, nil
+}
+
+// msgDecoder reads the fields of an encoded message; the first error
+// sticks and turns all further reads into zero values.
+type msgDecoder struct {
+	b   []byte
+	err error
+}
+
+func (d *msgDecoder) fail() {
+	d.err, d.b = ErrMessageEncoding, nil
+}
+
+func (d *msgDecoder) byte() byte {
+	if len(d.b) == 0 {
+		d.fail()
+		return 0
+	}
+	c := d.b[0]
+	d.b = d.b[1:]
+	return c
+}
+
+func (d *msgDecoder) uvarint() uint64 {
+	v, n := binary.Uvarint(d.b)
+	if n <= 0 {
+		d.fail()
+		return 0
+	}
+	d.b = d.b[n:]
+	return v
+}
+
+func (d *msgDecoder) varint() int64 {
+	v, n := binary.Varint(d.b)
+	if n <= 0 {
+		d.fail()
+		return 0
+	}
+	d.b = d.b[n:]
+	return v
+}
+
+func (d *msgDecoder) next(n uint64) []byte {
+	if n > uint64(len(d.b)) {
+		d.fail()
+		return nil
+	}
+	v := d.b[:n:n]
+	d.b = d.b[n:]
+	return v
+}
+
+func (d *msgDecoder) string() string {
+	return string(d.next(d.uvarint()))
+}
+
+func (d *msgDecoder) bytes() []byte {
+	n := d.uvarint()
+	if n == 0 {
+		return nil
+	}
+	return append([]byte{}, d.next(n-1)...)
+}
+
+func (d *msgDecoder) time() time.Time {
+	var t time.Time
+	n := d.uvarint()
+	if n == 0 {
+		d.fail()
+		return t
+	}
+	if err := t.UnmarshalBinary(d.next(n - 1)); err != nil && d.err == nil {
+		d.fail()
+	}
+	return t
+}
+
+func (d *msgDecoder) row() ([]string, []interface{}) {
+	n := d.uvarint()
+	if n > uint64(len(d.b)) {
+		d.fail()
+		return nil, nil
+	}
+	columns := make([]string, 0, n)
+	row := make([]interface{}, 0, n)
+	for i := uint64(0); i < n && d.err == nil; i++ {
+		columns = append(columns, d.string())
+		row = append(row, d.value())
+	}
+	return columns, row
+}
+
+func (d *msgDecoder) value() interface{} {
+	switch d.byte() {
+	case valNull:
+		return nil
+	case valString:
+		return d.string()
+	case valInt:
+		return d.varint()
+	case valFloat32:
+		if b := d.next(4); b != nil {
+			return math.Float32frombits(binary.LittleEndian.Uint32(b))
+		}
+	case valFloat64:
+		if b := d.next(8); b != nil {
+			return math.Float64frombits(binary.LittleEndian.Uint64(b))
+		}
+	case valBytes:
+		return d.bytes()
+	case valTime:
+		return d.time()
+	case valIntervalYM:
+		return oraTime.IntervalYM{Years: int32(d.varint()), Months: int32(d.varint())}
+	case valIntervalDS:
+		return oraTime.IntervalDS{Days: int32(d.varint()), Nanos: d.varint()}
+	case valRowid:
+		return oraBinary.Rowid{Object: uint32(d.uvarint()), File: uint16(d.uvarint()),
+			Block: uint32(d.uvarint()), Row: uint16(d.uvarint())}
+	default:
+		d.fail()
+	}
+	return nil
+}
@@ -0,0 +1,57 @@
+package goxstream
+
+import (
+	"errors"
+	"fmt"
+)
+
+// OCIError is an error returned by an OCI call. Code is the ORA error
+// number, or zero when OCI returned no error record.
+type OCIError struct {
+	Op      string
+	Code    int
+	Message string
+}
+
+func (e *OCIError) Error() string {
+	return fmt.Sprintf("%s failed, code:%d, %s", e.Op, e.Code, e.Message)
+}
+
+// transientCodes are the ORA errors after which reattaching can succeed:
+// lost or refused connections, instances going down or not up yet, and
+// the outbound server being restarted.
+var transientCodes = map[int]bool{
+	28:    true, // session killed
+	1012:  true, // not logged on
+	1033:  true, // initialization or shutdown in progress
+	1034:  true, // ORACLE not available
+	1089:  true, // immediate shutdown in progress
+	1092:  true, // ORACLE instance terminated
+	2396:  true, // exceeded maximum idle time
+	3113:  true, // end-of-file on communication channel
+	3114:  true, // not connected to ORACLE
+	3135:  true, // connection lost contact
+	12153: true, // not connected
+	12170: true, // connect timeout
+	12514: true, // listener does not know of service
+	12521: true, // listener does not know of instance
+	12528: true, // all instances are blocking new connections
+	12537: true, // connection closed
+	12541: true, // no listener
+	12543: true, // destination host unreachable
+	12547: true, // lost contact
+	12560: true, // protocol adapter error
+	12571: true, // packet writer failure
+	25408: true, // can not safely replay call
+	26804: true, // apply process is disabled
+}
+
+// IsTransient reports whether err is an OCI error after which the
+// connection is worth reopening.
+func IsTransient(err error) bool {
+	var e *OCIError
+	if !errors.As(err, &e) {
+		return false
+	}
+	return transientCodes[e.Code]
+}
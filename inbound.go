@@ -0,0 +1,528 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"bytes"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"math"
+	"strconv"
+	"sync"
+	"time"
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/charset"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// ErrPositionOrder is returned by XStreamInConn.Send for a commit or
+// heartbeat whose SCN is lower than that of the commit sent before it.
+var ErrPositionOrder = errors.New("goxstream: commit SCN lower than the previous one")
+
+// inPositionLen is the length of the positions XStreamInConn gives its
+// LCRs: the SCN of the last commit followed by a sequence number counting
+// the LCRs since, both big endian, so that positions compare bytewise in
+// stream order. Row SCNs are not used, as they are not in order across
+// the transactions of a commit-ordered stream.
+const inPositionLen = 12
+
+func inPosition(dst []byte, s scn.SCN, seq uint32) []byte {
+	var b [inPositionLen]byte
+	binary.BigEndian.PutUint64(b[:8], uint64(s))
+	binary.BigEndian.PutUint32(b[8:], seq)
+	return append(dst, b[:]...)
+}
+
+// inPositionSCN returns the SCN of a position made by inPosition, or zero
+// for positions in any other format.
+func inPositionSCN(pos []byte) scn.SCN {
+	if len(pos) != inPositionLen {
+		return 0
+	}
+	return scn.SCN(binary.BigEndian.Uint64(pos[:8]))
+}
+
+// XStreamInConn sends changes to an XStream inbound server. Send serialises
+// messages into a batch that is built into LCRs and sent in one call into
+// C once it holds WithBatchSize messages; Flush sends what is left and
+// pushes the stream to the server without waiting for it to be applied.
+//
+// Strings are sent in AL32UTF8, integers as NUMBER, floats as BINARY_DOUBLE,
+// []byte as RAW and time.Time as DATE (to the second, in the WithLocation
+// zone). Owner, table and column names must be canonical (usually upper
+// case). Every LCR gets the position of the last commit and a sequence
+// number after it, so transactions must be sent in commit SCN order; the
+// rows of transactions may interleave.
+type XStreamInConn struct {
+	mu        sync.Mutex
+	ocip      *C.struct_oci
+	opts      *options
+	thread    *osThread
+	source    *C.uchar
+	sourcel   C.ub2
+	free      func()
+	batch     []byte
+	pending   int
+	attachPos []byte
+	scn       scn.SCN
+	seq       uint32
+	txid      string
+	lwm       scn.SCN
+	sent      uint64
+	skipped   uint64
+	err       error
+	stop      chan struct{}
+	done      chan struct{}
+}
+
+// OpenIn attaches to the XStream inbound server servername as the source
+// sourceName. Connections opened with WithRuntime run all their OCI calls
+// on a dedicated OS thread.
+func OpenIn(username, password, dbname, servername, sourceName string, opts ...Option) (*XStreamInConn, error) {
+	o := newOptions(opts)
+	if o.batchSize <= 0 {
+		o.batchSize = 1
+	}
+	var c *XStreamInConn
+	var err error
+	if o.runtime == nil {
+		c, err = openIn(username, password, dbname, servername, sourceName, o)
+	} else {
+		if err := o.runtime.acquire(); err != nil {
+			return nil, err
+		}
+		t := newOSThread()
+		t.do(func() { c, err = openIn(username, password, dbname, servername, sourceName, o) })
+		if err != nil {
+			t.stop()
+			o.runtime.release()
+			return nil, err
+		}
+		c.thread = t
+	}
+	if err != nil {
+		return nil, err
+	}
+	if o.flushEvery > 0 {
+		c.stop = make(chan struct{})
+		c.done = make(chan struct{})
+		go c.flushLoop(o.flushEvery)
+	}
+	return c, nil
+}
+
+func openIn(username, password, dbname, servername, sourceName string, o *options) (*XStreamInConn, error) {
+	var info C.struct_conn_info
+	usernames, usernamel, free := toOciStr(username)
+	defer free()
+	info.user = usernames
+	info.userlen = usernamel
+	psws, pswl, free2 := toOciStr(password)
+	defer free2()
+	info.passw = psws
+	info.passwlen = pswl
+	dbs, dbl, free3 := toOciStr(dbname)
+	defer free3()
+	info.dbname = dbs
+	info.dbnamelen = dbl
+	svrs, svrl, free4 := toOciStr(servername)
+	defer free4()
+	info.svrnm = svrs
+	info.svrnmlen = svrl
+
+	// Go strings are UTF-8, so let OCI convert from AL32UTF8
+	oci, err := connect(&info, C.ushort(charset.AL32UTF8), C.ushort(charset.AL32UTF8), o)
+	if err != nil {
+		return nil, err
+	}
+	src, srcl, freeSrc := toOciStr(sourceName)
+	if C.attach_in(oci, &info, src, C.ub2(srcl)) != C.OCI_SUCCESS {
+		err := ociError("OCIXStreamInAttach", oci.errp)
+		freeSrc()
+		freeOci(oci)
+		return nil, err
+	}
+	attachPos := C.GoBytes(unsafe.Pointer(&oci.pos[0]), C.int(oci.pos_len))
+	return &XStreamInConn{
+		ocip:      oci,
+		opts:      o,
+		source:    src,
+		sourcel:   C.ub2(srcl),
+		free:      freeSrc,
+		attachPos: attachPos,
+		scn:       inPositionSCN(attachPos),
+		lwm:       inPositionSCN(attachPos),
+	}, nil
+}
+
+// run runs f on the connection's thread, if it has one.
+func (c *XStreamInConn) run(f func()) {
+	if c.thread == nil {
+		f()
+		return
+	}
+	c.thread.do(f)
+}
+
+// AttachSCN returns the SCN of the last LCR the inbound server had
+// received from this source when the connection attached. Messages up to
+// and including it are dropped by Send, so the source can be replayed
+// from there.
+func (c *XStreamInConn) AttachSCN() scn.SCN {
+	return inPositionSCN(c.attachPos)
+}
+
+// AttachPosition returns the raw position AttachSCN is taken from. When
+// the source is an outbound server relayed with StartRelay, it is an LCR
+// position of that server, to be passed to WithResumePosition.
+func (c *XStreamInConn) AttachPosition() []byte {
+	return append([]byte(nil), c.attachPos...)
+}
+
+// Send queues msg for the inbound server. Insert, Update and Delete open a
+// transaction that the next Commit ends; a HeartBeat outside a transaction
+// is sent as an empty commit, so the processed low watermark keeps moving
+// while the source is idle.
+func (c *XStreamInConn) Send(msg Message) error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	if c.err != nil {
+		return c.err
+	}
+	if err := c.add(msg); err != nil {
+		return err
+	}
+	if c.pending >= c.opts.batchSize {
+		return c.sendBatch()
+	}
+	return nil
+}
+
+// Flush sends the queued messages and pushes them to the inbound server
+// without waiting for them to be applied, then refreshes ProcessedLWM.
+func (c *XStreamInConn) Flush() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.flush(false)
+}
+
+// FlushWait is Flush, but waits until the inbound server has applied
+// everything sent so far.
+func (c *XStreamInConn) FlushWait() error {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.flush(true)
+}
+
+// ProcessedLWM returns the processed low watermark of the inbound server
+// as of the last flush: every transaction committed at or below it has
+// been applied.
+func (c *XStreamInConn) ProcessedLWM() scn.SCN {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.lwm
+}
+
+// Sent returns the number of LCRs handed to the inbound server, and
+// Skipped the number of messages dropped because the server had already
+// received them before the connection attached.
+func (c *XStreamInConn) Sent() uint64 {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.sent
+}
+
+func (c *XStreamInConn) Skipped() uint64 {
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	return c.skipped
+}
+
+// Close waits until everything sent has been applied and detaches.
+func (c *XStreamInConn) Close() error {
+	if c.stop != nil {
+		close(c.stop)
+		<-c.done
+	}
+	c.mu.Lock()
+	defer c.mu.Unlock()
+	err := c.err
+	if err == nil {
+		err = c.flush(true)
+	}
+	c.run(func() {
+		c.ocip.status = C.OCI_SUCCESS
+		C.detach(c.ocip)
+		if c.ocip.status != C.OCI_SUCCESS && err == nil {
+			err = ociError("OCIXStreamInDetach", c.ocip.errp)
+		}
+		freeOci(c.ocip)
+	})
+	c.free()
+	if c.thread != nil {
+		c.thread.stop()
+		c.opts.runtime.release()
+	}
+	return err
+}
+
+func (c *XStreamInConn) flushLoop(d time.Duration) {
+	defer close(c.done)
+	t := time.NewTicker(d)
+	defer t.Stop()
+	for {
+		select {
+		case <-c.stop:
+			return
+		case <-t.C:
+			c.mu.Lock()
+			if c.err == nil {
+				c.err = c.flush(false)
+			}
+			c.mu.Unlock()
+		}
+	}
+}
+
+func (c *XStreamInConn) flush(wait bool) error {
+	if err := c.sendBatch(); err != nil {
+		return err
+	}
+	var err error
+	c.run(func() {
+		if C.flush_in(c.ocip, cBool(wait)) != C.OCI_SUCCESS {
+			err = ociError("OCIXStreamInFlush", c.ocip.errp)
+			return
+		}
+		if c.ocip.pos_len > 0 {
+			c.lwm = inPositionSCN(C.GoBytes(unsafe.Pointer(&c.ocip.pos[0]), C.int(c.ocip.pos_len)))
+		}
+	})
+	return err
+}
+
+// sendBatch builds and sends the queued LCRs in a single call into C.
+func (c *XStreamInConn) sendBatch() error {
+	if c.pending == 0 {
+		return nil
+	}
+	var status C.sword
+	c.run(func() {
+		status = C.send_lcr_batch(c.ocip, c.source, c.sourcel,
+			(*C.ub1)(unsafe.Pointer(&c.batch[0])), C.ub4(len(c.batch)))
+	})
+	c.sent += uint64(c.ocip.in_sent)
+	c.batch = c.batch[:0]
+	c.pending = 0
+	if status != C.OCI_SUCCESS {
+		// the rest of the batch is lost, so the stream cannot go on
+		c.err = ociError("send_lcr_batch", c.ocip.errp)
+		return c.err
+	}
+	return nil
+}
+
+// next assigns the position of the next LCR, a commit at SCN s if commit
+// is set, and reports whether the inbound server has already received it.
+func (c *XStreamInConn) next(commit bool, s scn.SCN) ([]byte, bool, error) {
+	switch {
+	case !commit || s == c.scn:
+		c.seq++
+	case s > c.scn:
+		c.scn, c.seq = s, 0
+	default:
+		return nil, false, ErrPositionOrder
+	}
+	pos := inPosition(nil, c.scn, c.seq)
+	return pos, bytes.Compare(pos, c.attachPos) <= 0, nil
+}
+
+// begin names the transaction opened by the LCR just positioned, unless
+// one is open already.
+func (c *XStreamInConn) begin() {
+	if c.txid == "" {
+		c.txid = strconv.FormatUint(uint64(c.scn), 10) + "." + strconv.FormatUint(uint64(c.seq), 10)
+	}
+}
+
+func (c *XStreamInConn) add(msg Message) error {
+	switch m := msg.(type) {
+	case *Insert:
+		return c.addRow("INSERT", m.SourceTime, m.Owner, m.Table, nil, nil, m.NewColumn, m.NewRow)
+	case *Update:
+		return c.addRow("UPDATE", m.SourceTime, m.Owner, m.Table, m.OldColumn, m.OldRow, m.NewColumn, m.NewRow)
+	case *Delete:
+		return c.addRow("DELETE", m.SourceTime, m.Owner, m.Table, m.OldColumn, m.OldRow, nil, nil)
+	case *Commit:
+		return c.addCommit(m.SCN, m.SourceTime)
+	case *HeartBeat:
+		if c.txid != "" || m.SCN <= c.scn {
+			return nil
+		}
+		return c.addCommit(m.SCN, time.Time{})
+	}
+	return fmt.Errorf("goxstream: cannot send %T to an inbound server", msg)
+}
+
+func (c *XStreamInConn) addRow(cmd string, src time.Time, owner, table string, oldCols []string, oldRow []interface{}, newCols []string, newRow []interface{}) error {
+	if len(owner) > math.MaxUint16 || len(table) > math.MaxUint16 {
+		return fmt.Errorf("%s on %.32q.%.32q...: name too long", cmd, owner, table)
+	}
+	pos, skip, err := c.next(false, 0)
+	if err != nil {
+		return err
+	}
+	c.begin()
+	if skip {
+		c.skipped++
+		return nil
+	}
+	start := len(c.batch)
+	b := c.appendHeader(c.batch, false, cmd, pos, src, owner, table)
+	if b, err = c.appendColumns(b, oldCols, oldRow); err == nil {
+		b, err = c.appendColumns(b, newCols, newRow)
+	}
+	if err != nil {
+		c.batch = c.batch[:start]
+		return fmt.Errorf("%s on %s.%s: %w", cmd, owner, table, err)
+	}
+	c.batch = b
+	c.pending++
+	return nil
+}
+
+func (c *XStreamInConn) addCommit(s scn.SCN, src time.Time) error {
+	pos, skip, err := c.next(true, s)
+	if err != nil {
+		return err
+	}
+	c.begin()
+	if skip {
+		c.skipped++
+		c.txid = ""
+		return nil
+	}
+	b := c.appendHeader(c.batch, true, "COMMIT", pos, src, "", "")
+	c.batch = append(b, 0, 0, 0, 0) // no OLD and NEW columns
+	c.pending++
+	c.txid = ""
+	return nil
+}
+
+// appendHeader serialises a record header in the layout read by
+// send_lcr_batch in xstrm.c. The strings fit their ub2 lengths: owner and
+// table are checked by addRow, the others are short.
+func (c *XStreamInConn) appendHeader(b []byte, commit bool, cmd string, pos []byte, src time.Time, owner, table string) []byte {
+	if commit {
+		b = append(b, 1)
+	} else {
+		b = append(b, 0)
+	}
+	b = appendInString(b, cmd)
+	b = appendInBytes(b, pos)
+	b = appendInString(b, c.txid)
+	if src.IsZero() {
+		b = append(b, 0)
+	} else {
+		b = append(b, 1)
+	}
+	b = appendInDate(b, src.In(c.opts.location))
+	b = appendInString(b, owner)
+	return appendInString(b, table)
+}
+
+func (c *XStreamInConn) appendColumns(b []byte, cols []string, row []interface{}) ([]byte, error) {
+	if len(cols) != len(row) {
+		return nil, fmt.Errorf("%d column names for %d values", len(cols), len(row))
+	}
+	if len(cols) > math.MaxUint16 {
+		return nil, fmt.Errorf("%d columns, at most %d allowed", len(cols), math.MaxUint16)
+	}
+	b = appendInUint16(b, len(cols))
+	for i, name := range cols {
+		if len(name) > math.MaxUint16 {
+			return nil, fmt.Errorf("column name %.32q... too long", name)
+		}
+		b = appendInString(b, name)
+		var dty C.ub2
+		var v [8]byte
+		var val []byte
+		switch x := row[i].(type) {
+		case nil:
+		case string:
+			dty, val = C.SQLT_CHR, []byte(x)
+		case []byte:
+			dty, val = C.SQLT_BIN, x
+		case int:
+			dty, val = C.SQLT_INT, appendInUint64(v[:0], uint64(x))
+		case int8:
+			dty, val = C.SQLT_INT, appendInUint64(v[:0], uint64(x))
+		case int16:
+			dty, val = C.SQLT_INT, appendInUint64(v[:0], uint64(x))
+		case int32:
+			dty, val = C.SQLT_INT, appendInUint64(v[:0], uint64(x))
+		case int64:
+			dty, val = C.SQLT_INT, appendInUint64(v[:0], uint64(x))
+		case uint:
+			dty, val = C.SQLT_UIN, appendInUint64(v[:0], uint64(x))
+		case uint8:
+			dty, val = C.SQLT_UIN, appendInUint64(v[:0], uint64(x))
+		case uint16:
+			dty, val = C.SQLT_UIN, appendInUint64(v[:0], uint64(x))
+		case uint32:
+			dty, val = C.SQLT_UIN, appendInUint64(v[:0], uint64(x))
+		case uint64:
+			dty, val = C.SQLT_UIN, appendInUint64(v[:0], x)
+		case float32:
+			dty, val = C.SQLT_BDOUBLE, appendInUint64(v[:0], math.Float64bits(float64(x)))
+		case float64:
+			dty, val = C.SQLT_BDOUBLE, appendInUint64(v[:0], math.Float64bits(x))
+		case time.Time:
+			dty, val = C.SQLT_ODT, appendInDate(v[:0], x.In(c.opts.location))
+		default:
+			return nil, fmt.Errorf("column %s: cannot send %T", name, x)
+		}
+		if len(val) > math.MaxUint16 {
+			return nil, fmt.Errorf("column %s: %d bytes, at most %d allowed", name, len(val), math.MaxUint16)
+		}
+		b = appendInUint16(b, int(dty))
+		if row[i] == nil {
+			b = append(b, 1, 0, 0)
+			continue
+		}
+		b = append(b, 0)
+		b = appendInBytes(b, val)
+	}
+	return b, nil
+}
+
+func appendInUint16(b []byte, v int) []byte {
+	return append(b, byte(v), byte(v>>8))
+}
+
+func appendInUint64(b []byte, v uint64) []byte {
+	var e [8]byte
+	binary.LittleEndian.PutUint64(e[:], v)
+	return append(b, e[:]...)
+}
+
+// appendInBytes and appendInString append v with its ub2 length; callers
+// reject values longer than math.MaxUint16 first.
+func appendInBytes(b, v []byte) []byte {
+	return append(appendInUint16(b, len(v)), v...)
+}
+
+func appendInString(b []byte, v string) []byte {
+	return append(appendInUint16(b, len(v)), v...)
+}
+
+// appendInDate appends the 7 byte year, month, day, hour, minute, second
+// image send_lcr_batch turns into an OCIDate.
+func appendInDate(b []byte, t time.Time) []byte {
+	b = appendInUint16(b, t.Year())
+	return append(b, byte(t.Month()), byte(t.Day()), byte(t.Hour()), byte(t.Minute()), byte(t.Second()))
+}
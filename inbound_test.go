@@ -0,0 +1,96 @@
+package goxstream
+
+import (
+	"bytes"
+	"encoding/binary"
+	"testing"
+)
+
+type inRecord struct {
+	commit bool
+	pos    []byte
+	txid   string
+}
+
+// inRecords reads back the headers of a batch of LCRs without columns.
+func inRecords(t *testing.T, b []byte) []inRecord {
+	t.Helper()
+	str := func() []byte {
+		n := int(binary.LittleEndian.Uint16(b))
+		v := b[2 : 2+n]
+		b = b[2+n:]
+		return v
+	}
+	var recs []inRecord
+	for len(b) > 0 {
+		r := inRecord{commit: b[0] == 1}
+		b = b[1:]
+		str()
+		r.pos = str()
+		r.txid = string(str())
+		b = b[1+7:] // source time
+		str()
+		str()
+		b = b[4:] // no OLD and NEW columns
+		recs = append(recs, r)
+	}
+	return recs
+}
+
+func TestInPositionsFollowCommits(t *testing.T) {
+	// the second transaction changes rows before the first one does, but
+	// commits after it
+	stream := []Message{
+		&Insert{SCN: 105, Owner: "O", Table: "T"},
+		&Commit{SCN: 110},
+		&Insert{SCN: 101, Owner: "O", Table: "T"},
+		&Update{SCN: 108, Owner: "O", Table: "T"},
+		&Commit{SCN: 120},
+		&HeartBeat{SCN: 130},
+	}
+	c := &XStreamInConn{opts: newOptions(nil)}
+	for _, m := range stream {
+		if err := c.add(m); err != nil {
+			t.Fatal(err)
+		}
+	}
+	recs := inRecords(t, c.batch)
+	if len(recs) != len(stream) {
+		t.Fatalf("%d LCRs, want %d", len(recs), len(stream))
+	}
+	for i := 1; i < len(recs); i++ {
+		if bytes.Compare(recs[i-1].pos, recs[i].pos) >= 0 {
+			t.Fatalf("position %d %x not after %x", i, recs[i].pos, recs[i-1].pos)
+		}
+	}
+	if recs[0].txid != recs[1].txid || recs[2].txid != recs[4].txid || recs[0].txid == recs[2].txid {
+		t.Fatalf("transaction ids %+v", recs)
+	}
+	if s := inPositionSCN(recs[4].pos); s != 120 {
+		t.Fatalf("commit at position of SCN %d", s)
+	}
+	if err := c.add(&Commit{SCN: 115}); err != ErrPositionOrder {
+		t.Fatalf("commit before the last one: %v", err)
+	}
+
+	// replaying after the first commit gives the same positions again and
+	// skips what the server received before
+	for _, received := range []int{1, 3} {
+		attach := recs[received].pos
+		r := &XStreamInConn{opts: newOptions(nil), attachPos: attach, scn: inPositionSCN(attach)}
+		for _, m := range stream[2:] {
+			if err := r.add(m); err != nil {
+				t.Fatal(err)
+			}
+		}
+		again := inRecords(t, r.batch)
+		if skipped := received - 1; int(r.skipped) != skipped || len(again) != 4-skipped {
+			t.Fatalf("attached at %d: %d LCRs, %d skipped", received, len(again), r.skipped)
+		}
+		for i, rec := range again {
+			if was := recs[len(recs)-len(again)+i]; !bytes.Equal(rec.pos, was.pos) || rec.txid != was.txid {
+				t.Fatalf("attached at %d: LCR %d at %x %s, was %x %s", received, i, rec.pos, rec.txid, was.pos, was.txid)
+			}
+		}
+	}
+}
@@ -0,0 +1,208 @@
+package goxstream
+
+import (
+	"sync"
+	"sync/atomic"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/metrics"
+)
+
+// Stages of receiving one LCR timed by connMetrics.
+const (
+	stageReceive = iota // OCIXStreamOutLCRReceive
+	stageHeader         // OCILCRHeaderGet and position to SCN
+	stageColumns        // staging column values in C
+	stageDecode         // converting column values to Go
+	stageFree           // draining chunks, OCILCRFree and arena reset
+	stageCount
+)
+
+var stageNames = [stageCount]string{"receive", "header", "columns", "decode", "free"}
+
+// Commands counted by connMetrics.
+const (
+	cmdInsert = iota
+	cmdUpdate
+	cmdDelete
+	cmdCommit
+	cmdOther
+	cmdCount
+)
+
+var cmdNames = [cmdCount]string{"INSERT", "UPDATE", "DELETE", "COMMIT", "OTHER"}
+
+// stageMaxNanos bounds the stage histograms at one minute.
+const stageMaxNanos = int64(time.Minute)
+
+// connMetrics are the counters of one connection. They are written only
+// by the goroutine reading the connection, so every connection is its own
+// shard and the atomics never contend; scrapes add them up per label.
+// A nil *connMetrics records nothing.
+type connMetrics struct {
+	labels []metrics.Label
+
+	commands   [cmdCount]uint64
+	heartbeats uint64
+	bytes      uint64
+	chunks     uint64
+	chunkBytes uint64
+	errors     uint64
+	stages     [stageCount]*metrics.Histogram
+
+	// rowBytes collects the column bytes of the LCR being decoded.
+	rowBytes uint64
+
+	// tables is a copy-on-write map from owner and table to counters.
+	tables atomic.Value
+	mu     sync.Mutex
+}
+
+type tableKey struct {
+	owner, table string
+}
+
+type tableCounters struct {
+	commands [cmdCount]uint64
+	bytes    uint64
+}
+
+func newConnMetrics(servername, conn string) *connMetrics {
+	m := &connMetrics{labels: []metrics.Label{{Name: "server", Value: servername}}}
+	if conn != "" {
+		m.labels = append(m.labels, metrics.Label{Name: "conn", Value: conn})
+	}
+	for i := range m.stages {
+		m.stages[i] = metrics.NewHistogram(stageMaxNanos)
+	}
+	m.tables.Store(map[tableKey]*tableCounters{})
+	return m
+}
+
+// start returns the time a stage starts at, the zero time when nothing is
+// recorded.
+func (m *connMetrics) start() time.Time {
+	if m == nil {
+		return time.Time{}
+	}
+	return time.Now()
+}
+
+// stage records the time since t in stage s and returns the current time,
+// where the next stage starts.
+func (m *connMetrics) stage(s int, t time.Time) time.Time {
+	if m == nil {
+		return t
+	}
+	now := time.Now()
+	m.stages[s].Record(int64(now.Sub(t)))
+	return now
+}
+
+func (m *connMetrics) addRowBytes(n int) {
+	if m != nil {
+		m.rowBytes += uint64(n)
+	}
+}
+
+func (m *connMetrics) addChunks(chunks, bytes uint64) {
+	if m != nil {
+		atomic.AddUint64(&m.chunks, chunks)
+		atomic.AddUint64(&m.chunkBytes, bytes)
+	}
+}
+
+func (m *connMetrics) failed() {
+	if m != nil {
+		atomic.AddUint64(&m.errors, 1)
+	}
+}
+
+// received counts a decoded message together with the column bytes
+// collected for it.
+func (m *connMetrics) received(msg Message) {
+	if m == nil {
+		return
+	}
+	rowBytes := m.rowBytes
+	m.rowBytes = 0
+	cmd := cmdOther
+	var key tableKey
+	switch msg := msg.(type) {
+	case *HeartBeat:
+		atomic.AddUint64(&m.heartbeats, 1)
+		return
+	case *Commit:
+		cmd = cmdCommit
+	case *Insert:
+		cmd, key = cmdInsert, tableKey{msg.Owner, msg.Table}
+	case *Update:
+		cmd, key = cmdUpdate, tableKey{msg.Owner, msg.Table}
+	case *Delete:
+		cmd, key = cmdDelete, tableKey{msg.Owner, msg.Table}
+	}
+	atomic.AddUint64(&m.commands[cmd], 1)
+	atomic.AddUint64(&m.bytes, rowBytes)
+	if key.table == "" {
+		return
+	}
+	t := m.tables.Load().(map[tableKey]*tableCounters)[key]
+	if t == nil {
+		t = m.addTable(key)
+	}
+	atomic.AddUint64(&t.commands[cmd], 1)
+	atomic.AddUint64(&t.bytes, rowBytes)
+}
+
+func (m *connMetrics) addTable(key tableKey) *tableCounters {
+	m.mu.Lock()
+	defer m.mu.Unlock()
+	old := m.tables.Load().(map[tableKey]*tableCounters)
+	tables := make(map[tableKey]*tableCounters, len(old)+1)
+	for k, v := range old {
+		tables[k] = v
+	}
+	t := &tableCounters{}
+	tables[key] = t
+	m.tables.Store(tables)
+	return t
+}
+
+func (m *connMetrics) collect(w *metrics.Writer, lag LagStats) {
+	with := func(extra ...metrics.Label) []metrics.Label {
+		return append(m.labels[:len(m.labels):len(m.labels)], extra...)
+	}
+	for i, name := range cmdNames {
+		w.Counter("goxstream_lcrs_total", "LCRs received by command.",
+			atomic.LoadUint64(&m.commands[i]), with(metrics.Label{Name: "command", Value: name})...)
+	}
+	w.Counter("goxstream_heartbeats_total", "Heartbeats received.", atomic.LoadUint64(&m.heartbeats), m.labels...)
+	w.Counter("goxstream_column_bytes_total", "Column value bytes received.", atomic.LoadUint64(&m.bytes), m.labels...)
+	w.Counter("goxstream_lob_chunks_total", "LOB and LONG chunks received.", atomic.LoadUint64(&m.chunks), m.labels...)
+	w.Counter("goxstream_lob_chunk_bytes_total", "LOB and LONG chunk bytes received.", atomic.LoadUint64(&m.chunkBytes), m.labels...)
+	w.Counter("goxstream_errors_total", "Receive errors.", atomic.LoadUint64(&m.errors), m.labels...)
+	for key, t := range m.tables.Load().(map[tableKey]*tableCounters) {
+		tl := with(metrics.Label{Name: "owner", Value: key.owner}, metrics.Label{Name: "table", Value: key.table})
+		for i := 0; i < cmdCommit; i++ {
+			w.Counter("goxstream_table_lcrs_total", "Row LCRs received by table and command.",
+				atomic.LoadUint64(&t.commands[i]), append(tl[:len(tl):len(tl)], metrics.Label{Name: "command", Value: cmdNames[i]})...)
+		}
+		w.Counter("goxstream_table_column_bytes_total", "Column value bytes received by table.", atomic.LoadUint64(&t.bytes), tl...)
+	}
+	for i, h := range m.stages {
+		w.Summary("goxstream_stage_seconds", "Time spent in each receive stage, per LCR or row image.",
+			h.Snapshot(), 1e-9, with(metrics.Label{Name: "stage", Value: stageNames[i]})...)
+	}
+	w.Gauge("goxstream_receive_lag_seconds", "Latest time from a source change to its LCR arriving.", lag.Receive.Seconds(), m.labels...)
+	w.Gauge("goxstream_ack_lag_seconds", "Latest time from a source commit to its acknowledgement.", lag.Ack.Seconds(), m.labels...)
+	w.Summary("goxstream_receive_lag_distribution_seconds", "Receive lag.", lag.ReceiveMicros, 1e-6, m.labels...)
+	w.Summary("goxstream_ack_lag_distribution_seconds", "Ack lag.", lag.AckMicros, 1e-6, m.labels...)
+}
+
+// Collect implements metrics.Collector for connections opened WithMetrics.
+func (x *XStreamConn) Collect(w *metrics.Writer) {
+	if x.metrics == nil {
+		return
+	}
+	x.metrics.collect(w, x.Lag())
+}
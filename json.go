@@ -0,0 +1,104 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/jsonenc"
+	"github.com/yjhatfdu/goxstream/oraBinary"
+	"github.com/yjhatfdu/goxstream/oraTime"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// jsonWriter encodes row messages to JSON from the raw column values while
+// they are decoded (see WithJSON and encodeRow). A nil *jsonWriter does
+// nothing.
+type jsonWriter struct {
+	tables map[tableKey]*jsonenc.Table
+	table  *jsonenc.Table
+	buf    []byte
+	start  int
+	text   []byte // converted text of the current value
+}
+
+func newJSONWriter() *jsonWriter {
+	return &jsonWriter{
+		tables: map[tableKey]*jsonenc.Table{},
+		buf:    make([]byte, 0, eventSlab),
+	}
+}
+
+// begin starts the event of a row change of owner.table.
+func (w *jsonWriter) begin(op jsonenc.Op, s scn.SCN, owner, table string) {
+	if w == nil {
+		return
+	}
+	t := tableKey{owner, table}
+	if w.table = w.tables[t]; w.table == nil {
+		w.table = jsonenc.NewTable(owner, table)
+		w.tables[t] = w.table
+	}
+	w.buf = slab(w.buf)
+	w.start = len(w.buf)
+	w.buf = w.table.Begin(w.buf, op, uint64(s))
+}
+
+// end finishes the event and returns it; its capacity is capped so that
+// appending to it cannot overwrite the next event.
+func (w *jsonWriter) end() []byte {
+	if w == nil {
+		return nil
+	}
+	w.buf = jsonenc.End(w.buf)
+	return w.buf[w.start:len(w.buf):len(w.buf)]
+}
+
+// appendJSONValue encodes a raw column value as staged by
+// get_lcr_row_data, following value2interface.
+func (x *XStreamConn) appendJSONValue(b []byte, p unsafe.Pointer, l C.ub2, csid int, dtype C.ub2) ([]byte, error) {
+	if l == 0 || p == nil {
+		return jsonenc.AppendNull(b), nil
+	}
+	raw := byteView(p, l)
+	switch dtype {
+	case C.SQLT_CHR, C.SQLT_AFC:
+		text, err := x.utf8Text(raw, csid, &x.json.text)
+		return jsonenc.AppendString(b, text), err
+	case C.SQLT_VNU:
+		return jsonenc.AppendNumber(b, raw)
+	case C.SQLT_ODT:
+		v := (*C.OCIDate)(p)
+		t := v.OCIDateTime
+		return jsonenc.AppendDate(b, int(v.OCIDateYYYY), int(v.OCIDateMM), int(v.OCIDateDD),
+			int(t.OCITimeHH), int(t.OCITimeMI), int(t.OCITimeSS)), nil
+	case C.SQLT_TIMESTAMP, C.SQLT_TIMESTAMP_TZ, C.SQLT_TIMESTAMP_LTZ:
+		return jsonenc.AppendTimestamp(b, raw)
+	case C.SQLT_INTERVAL_YM:
+		v, err := oraTime.DecodeIntervalYM(raw)
+		return jsonenc.AppendText(b, v.String()), err
+	case C.SQLT_INTERVAL_DS:
+		v, err := oraTime.DecodeIntervalDS(raw)
+		return jsonenc.AppendText(b, v.String()), err
+	case C.SQLT_BIN:
+		return jsonenc.AppendBytes(b, raw), nil
+	case C.SQLT_BFLOAT:
+		return jsonenc.AppendFloat(b, float64(*(*float32)(p)), 32), nil
+	case C.SQLT_BDOUBLE:
+		return jsonenc.AppendFloat(b, *(*float64)(p), 64), nil
+	case C.SQLT_IBFLOAT:
+		f, err := oraBinary.Float32(raw)
+		return jsonenc.AppendFloat(b, float64(f), 32), err
+	case C.SQLT_IBDOUBLE:
+		f, err := oraBinary.Float64(raw)
+		return jsonenc.AppendFloat(b, f, 64), err
+	case C.SQLT_RDD:
+		if r, err := oraBinary.ParseRowid(raw); err == nil {
+			return append(r.AppendText(append(b, '"')), '"'), nil
+		}
+		return jsonenc.AppendString(b, raw), nil
+	}
+	return jsonenc.AppendNull(b), nil
+}
@@ -0,0 +1,230 @@
+// Package jsonenc writes change events as JSON straight from the raw column
+// images of an LCR, appending to a caller supplied buffer. The parts of an
+// event that only depend on the table, its header and the quoted column
+// names, are built once per table and copied from then on.
+//
+// An event looks like
+//
+//	{"op":"UPDATE","scn":1234,"owner":"HR","table":"EMP",
+//	 "before":{"ID":7,"NAME":"x"},"after":{"ID":7,"NAME":"y"}}
+//
+// NUMBERs are written as exact JSON numbers, DATEs and TIMESTAMPs in RFC
+// 3339 form (without a zone unless the value has one), RAWs in base64 and
+// intervals and non-finite floats as strings.
+package jsonenc
+
+import (
+	"encoding/base64"
+	"math"
+	"strconv"
+
+	"github.com/yjhatfdu/goxstream/oraNumber"
+	"github.com/yjhatfdu/goxstream/oraTime"
+)
+
+// Op is the operation of an event.
+type Op int
+
+const (
+	Insert Op = iota
+	Update
+	Delete
+)
+
+var opText = [...]string{Insert: "INSERT", Update: "UPDATE", Delete: "DELETE"}
+
+// Table holds the precomputed fragments of one table.
+type Table struct {
+	head  [len(opText)][]byte
+	tail  []byte
+	names map[string][]byte
+}
+
+// NewTable precomputes the fragments of owner.table.
+func NewTable(owner, table string) *Table {
+	t := &Table{names: map[string][]byte{}}
+	for op, s := range opText {
+		t.head[op] = append(AppendString([]byte(`{"op":`), []byte(s)), `,"scn":`...)
+	}
+	t.tail = AppendString([]byte(`,"owner":`), []byte(owner))
+	t.tail = AppendString(append(t.tail, `,"table":`...), []byte(table))
+	return t
+}
+
+// Begin opens an event.
+func (t *Table) Begin(b []byte, op Op, scn uint64) []byte {
+	b = append(b, t.head[op]...)
+	b = strconv.AppendUint(b, scn, 10)
+	return append(b, t.tail...)
+}
+
+// Before and After open the old and new row image of an event.
+func Before(b []byte) []byte {
+	return append(b, `,"before":{`...)
+}
+
+func After(b []byte) []byte {
+	return append(b, `,"after":{`...)
+}
+
+// Column appends the quoted name of the next column of a row image and
+// the colon, preceded by a comma unless it is the first column. The name
+// is escaped once, when the table first has a column of that name.
+func (t *Table) Column(b, name []byte) []byte {
+	if b[len(b)-1] != '{' {
+		b = append(b, ',')
+	}
+	f, ok := t.names[string(name)]
+	if !ok {
+		f = append(AppendString(nil, name), ':')
+		t.names[string(name)] = f
+	}
+	return append(b, f...)
+}
+
+// End closes a row image or the event.
+func End(b []byte) []byte {
+	return append(b, '}')
+}
+
+// AppendNull appends a NULL value.
+func AppendNull(b []byte) []byte {
+	return append(b, "null"...)
+}
+
+// AppendString appends s, which must be UTF-8, as a JSON string. Runs of
+// bytes that need no escaping are copied in one piece.
+func AppendString(b, s []byte) []byte {
+	b = append(b, '"')
+	start := 0
+	for i, c := range s {
+		if c >= 0x20 && c != '"' && c != '\\' {
+			continue
+		}
+		b = append(b, s[start:i]...)
+		switch c {
+		case '"', '\\':
+			b = append(b, '\\', c)
+		case '\n':
+			b = append(b, '\\', 'n')
+		case '\r':
+			b = append(b, '\\', 'r')
+		case '\t':
+			b = append(b, '\\', 't')
+		default:
+			b = append(b, '\\', 'u', '0', '0', hex[c>>4], hex[c&0xf])
+		}
+		start = i + 1
+	}
+	b = append(b, s[start:]...)
+	return append(b, '"')
+}
+
+const hex = "0123456789abcdef"
+
+// AppendNumber appends a NUMBER from its OCINumber image.
+func AppendNumber(b, num []byte) ([]byte, error) {
+	return oraNumber.AppendDecimal(b, num)
+}
+
+// AppendFloat appends a BINARY_FLOAT (bits 32) or BINARY_DOUBLE (bits 64)
+// value. NaN and the infinities, which JSON has no numbers for, are
+// written as the strings "NaN", "Infinity" and "-Infinity".
+func AppendFloat(b []byte, v float64, bits int) []byte {
+	switch {
+	case math.IsNaN(v):
+		return append(b, `"NaN"`...)
+	case math.IsInf(v, 1):
+		return append(b, `"Infinity"`...)
+	case math.IsInf(v, -1):
+		return append(b, `"-Infinity"`...)
+	}
+	return strconv.AppendFloat(b, v, 'g', -1, bits)
+}
+
+// AppendBytes appends a RAW value as a base64 string, like encoding/json.
+func AppendBytes(b, v []byte) []byte {
+	n := base64.StdEncoding.EncodedLen(len(v))
+	b = append(b, '"')
+	b = append(b, make([]byte, n)...)
+	base64.StdEncoding.Encode(b[len(b)-n:], v)
+	return append(b, '"')
+}
+
+// AppendDate appends a DATE as "2006-01-02T15:04:05".
+func AppendDate(b []byte, year, month, day, hour, minute, second int) []byte {
+	b = append(b, '"')
+	b = appendDateTime(b, year, month, day, hour, minute, second)
+	return append(b, '"')
+}
+
+// AppendTimestamp appends a TIMESTAMP or TIMESTAMP WITH (LOCAL) TIME ZONE
+// image (see package oraTime) with nanoseconds, and the zone offset of the
+// latter, e.g. "2006-01-02T15:04:05.999999999+07:00".
+func AppendTimestamp(b, ts []byte) ([]byte, error) {
+	t, err := oraTime.ParseTimestamp(ts)
+	if err != nil {
+		return b, err
+	}
+	b = append(b, '"')
+	b = appendDateTime(b, t.Year, t.Month, t.Day, t.Hour, t.Minute, t.Second)
+	if t.Nanos != 0 {
+		b = append(b, '.')
+		b = appendDigits(b, t.Nanos, 9)
+		for b[len(b)-1] == '0' {
+			b = b[:len(b)-1]
+		}
+	}
+	if len(ts) == oraTime.TimestampTZLen {
+		off := t.Offset
+		if off < 0 {
+			b = append(b, '-')
+			off = -off
+		} else {
+			b = append(b, '+')
+		}
+		b = appendDigits(b, off/60, 2)
+		b = append(b, ':')
+		b = appendDigits(b, off%60, 2)
+	}
+	return append(b, '"'), nil
+}
+
+// AppendText appends the text form of a value, such as an interval, as a
+// JSON string.
+func AppendText(b []byte, s string) []byte {
+	return AppendString(b, []byte(s))
+}
+
+func appendDateTime(b []byte, year, month, day, hour, minute, second int) []byte {
+	if year < 0 {
+		b = append(b, '-')
+		year = -year
+	}
+	b = appendDigits(b, year, 4)
+	b = append(b, '-')
+	b = appendDigits(b, month, 2)
+	b = append(b, '-')
+	b = appendDigits(b, day, 2)
+	b = append(b, 'T')
+	b = appendDigits(b, hour, 2)
+	b = append(b, ':')
+	b = appendDigits(b, minute, 2)
+	b = append(b, ':')
+	return appendDigits(b, second, 2)
+}
+
+// appendDigits appends v zero padded to at least n digits.
+func appendDigits(b []byte, v, n int) []byte {
+	var buf [20]byte
+	i := len(buf)
+	for v >= 10 || n > 1 {
+		i--
+		buf[i] = byte('0' + v%10)
+		v /= 10
+		n--
+	}
+	i--
+	buf[i] = byte('0' + v)
+	return append(b, buf[i:]...)
+}
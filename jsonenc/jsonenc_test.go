@@ -0,0 +1,74 @@
+package jsonenc
+
+import (
+	"encoding/json"
+	"math"
+	"testing"
+)
+
+func TestEvent(t *testing.T) {
+	tbl := NewTable("HR", `EMP"S`)
+	var b []byte
+	for i := 0; i < 2; i++ {
+		b = tbl.Begin(b[:0], Update, 1234)
+		b = Before(b)
+		b = tbl.Column(b, []byte("ID"))
+		b, _ = AppendNumber(b, []byte{2, 0xc1, 0x08})
+		b = tbl.Column(b, []byte("NAME"))
+		b = AppendString(b, []byte("a\"b\\c\n\x01é"))
+		b = End(b)
+		b = After(b)
+		b = tbl.Column(b, []byte("NAME"))
+		b = AppendNull(b)
+		b = tbl.Column(b, []byte("PHOTO"))
+		b = AppendBytes(b, []byte{0, 1, 2, 0xff})
+		b = tbl.Column(b, []byte("RATE"))
+		b = AppendFloat(b, 0.1, 32)
+		b = tbl.Column(b, []byte("SCORE"))
+		b = AppendFloat(b, math.Inf(-1), 64)
+		b = End(End(b))
+	}
+	want := `{"op":"UPDATE","scn":1234,"owner":"HR","table":"EMP\"S",` +
+		`"before":{"ID":7,"NAME":"a\"b\\c\n\u0001é"},` +
+		`"after":{"NAME":null,"PHOTO":"AAEC/w==","RATE":0.1,"SCORE":"-Infinity"}}`
+	if string(b) != want {
+		t.Fatalf("got  %s\nwant %s", b, want)
+	}
+	if !json.Valid(b) {
+		t.Fatal("invalid JSON")
+	}
+}
+
+func TestAppendString(t *testing.T) {
+	for _, s := range []string{"", "plain", "tab\there", "\x00\x1f\x7f", `"\`, "日本語"} {
+		var got string
+		if err := json.Unmarshal(AppendString(nil, []byte(s)), &got); err != nil || got != s {
+			t.Errorf("AppendString(%q) round trips to %q, %v", s, got, err)
+		}
+	}
+}
+
+func TestDates(t *testing.T) {
+	if got := string(AppendDate(nil, 2024, 2, 9, 7, 5, 0)); got != `"2024-02-09T07:05:00"` {
+		t.Errorf("AppendDate = %s", got)
+	}
+	for _, c := range []struct {
+		ts   []byte
+		want string
+	}{
+		// 2024-02-09 07:05:01.5
+		{[]byte{120, 124, 2, 9, 8, 6, 2, 0x1d, 0xcd, 0x65, 0x00}, `"2024-02-09T07:05:01.5"`},
+		{[]byte{120, 124, 2, 9, 8, 6, 2, 0, 0, 0, 0}, `"2024-02-09T07:05:01"`},
+		// +05:30 and -03:00
+		{[]byte{120, 124, 2, 9, 8, 6, 2, 0, 0, 0, 1, 25, 90}, `"2024-02-09T07:05:01.000000001+05:30"`},
+		{[]byte{120, 124, 2, 9, 8, 6, 2, 0, 0, 0, 0, 17, 60}, `"2024-02-09T07:05:01-03:00"`},
+	} {
+		got, err := AppendTimestamp(nil, c.ts)
+		if err != nil || string(got) != c.want {
+			t.Errorf("AppendTimestamp(% x) = %s, %v, want %s", c.ts, got, err, c.want)
+		}
+	}
+	if _, err := AppendTimestamp(nil, []byte{1, 2}); err == nil {
+		t.Error("short image accepted")
+	}
+}
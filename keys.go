@@ -0,0 +1,218 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"errors"
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/oraBinary"
+	"github.com/yjhatfdu/goxstream/rowkey"
+)
+
+// keyDef lists the columns of a table's key in key order. Tables without
+// a primary or unique key have an empty keyDef.
+type keyDef struct {
+	columns []string
+	index   map[string]int
+}
+
+// keyCache loads key metadata over a session of its own, so that lookups
+// never interleave with the stream, and encodes row keys from raw column
+// values while a row is being decoded.
+type keyCache struct {
+	meta   *C.struct_oci
+	tables map[tableKey]*keyDef
+	parts  [][2]int // start and end in buf of each key column, -1 if unset
+	buf    []byte
+}
+
+// newKeyCache logs on for metadata and loads the keys of the tables in the
+// outbound server's DML rules. Reading the rules needs access to
+// DBA_XSTREAM_RULES; without it (ORA-00942 or ORA-01031) the keys are only
+// loaded per table, when the table is first seen. Other errors are
+// returned.
+func newKeyCache(info *C.struct_conn_info, csid, ncsid C.ushort, o *options) (*keyCache, error) {
+	meta, err := connect(info, csid, ncsid, o)
+	if err != nil {
+		return nil, err
+	}
+	k := &keyCache{meta: meta, tables: map[tableKey]*keyDef{}}
+	if err := k.query(true, info.svrnm, C.ub2(info.svrnmlen), nil, 0); err != nil {
+		var e *OCIError
+		if !errors.As(err, &e) || e.Code != 942 && e.Code != 1031 {
+			k.close()
+			return nil, err
+		}
+	}
+	return k, nil
+}
+
+func (k *keyCache) close() {
+	freeOci(k.meta)
+}
+
+// query runs a key query and adds the first key found for each table.
+// Nothing is added unless every row was fetched, so a failed fetch never
+// leaves a key with only some of its columns.
+func (k *keyCache) query(byServer bool, a *C.uchar, al C.ub2, b *C.uchar, bl C.ub2) error {
+	// the defines point into q until the last fetch, so it lives in C
+	q := (*C.key_query_t)(C.calloc(1, C.sizeof_key_query_t))
+	defer C.free(unsafe.Pointer(q))
+	if C.start_key_query(k.meta, q, cBool(byServer), a, al, b, bl) != C.OCI_SUCCESS {
+		return ociError("query key columns", k.meta.errp)
+	}
+	found := map[tableKey]*keyDef{}
+	var def *keyDef
+	var key tableKey
+	var constraint string
+	for {
+		status := C.fetch_key_row(k.meta)
+		if status == C.OCI_NO_DATA {
+			for t, def := range found {
+				k.tables[t] = def
+			}
+			return nil
+		}
+		if status != C.OCI_SUCCESS && status != C.OCI_SUCCESS_WITH_INFO {
+			return ociError("fetch key columns", k.meta.errp)
+		}
+		t := tableKey{
+			owner: tostring((*C.uchar)(&q.owner[0]), q.owner_len),
+			table: tostring((*C.uchar)(&q.table[0]), q.table_len),
+		}
+		c := tostring((*C.uchar)(&q.constraint[0]), q.constraint_len)
+		if def == nil || t != key {
+			def = &keyDef{index: map[string]int{}}
+			key, constraint = t, c
+			found[t] = def
+		} else if c != constraint {
+			// only the first key of a table is used
+			continue
+		}
+		column := tostring((*C.uchar)(&q.column[0]), q.column_len)
+		def.index[column] = len(def.columns)
+		def.columns = append(def.columns, column)
+	}
+}
+
+// lookup returns the key of owner.table, loading it on first use.
+func (k *keyCache) lookup(owner, table string) (*keyDef, error) {
+	t := tableKey{owner, table}
+	if def, ok := k.tables[t]; ok {
+		return def, nil
+	}
+	o, ol, free := toOciStr(owner)
+	defer free()
+	n, nl, free2 := toOciStr(table)
+	defer free2()
+	if err := k.query(false, o, C.ub2(ol), n, C.ub2(nl)); err != nil {
+		return nil, err
+	}
+	def, ok := k.tables[t]
+	if !ok {
+		def = &keyDef{}
+		k.tables[t] = def
+	}
+	return def, nil
+}
+
+// invalidate drops the cached key of owner.table after DDL on it, or of
+// every table when the DDL names no table.
+func (k *keyCache) invalidate(owner, table string) {
+	if table == "" {
+		k.tables = map[tableKey]*keyDef{}
+		return
+	}
+	delete(k.tables, tableKey{owner, table})
+}
+
+// reset forgets the parts of the previous row image.
+func (k *keyCache) reset(def *keyDef) {
+	k.buf = k.buf[:0]
+	k.parts = k.parts[:0]
+	for range def.columns {
+		k.parts = append(k.parts, [2]int{-1, -1})
+	}
+}
+
+// set encodes the raw value of key column i, replacing an earlier value.
+func (k *keyCache) set(i int, p unsafe.Pointer, l C.ub2, dtype C.ub2) error {
+	start := len(k.buf)
+	b, err := appendKeyValue(k.buf, p, l, dtype)
+	if err != nil {
+		return err
+	}
+	k.buf = b
+	k.parts[i] = [2]int{start, len(b)}
+	return nil
+}
+
+// key assembles the parts set so far, or returns nil when a key column
+// is missing from the row images.
+func (k *keyCache) key() []byte {
+	n := 0
+	for _, p := range k.parts {
+		if p[0] < 0 {
+			return nil
+		}
+		n += p[1] - p[0]
+	}
+	if n == 0 {
+		return nil
+	}
+	key := make([]byte, 0, n)
+	for _, p := range k.parts {
+		key = append(key, k.buf[p[0]:p[1]]...)
+	}
+	return key
+}
+
+// appendKeyValue encodes a raw column value as staged by get_lcr_row_data.
+func appendKeyValue(b []byte, p unsafe.Pointer, l C.ub2, dtype C.ub2) ([]byte, error) {
+	if l == 0 || p == nil {
+		return rowkey.AppendNull(b), nil
+	}
+	raw := byteView(p, l)
+	switch dtype {
+	case C.SQLT_VNU:
+		return rowkey.AppendNumber(b, raw)
+	case C.SQLT_ODT:
+		v := (*C.OCIDate)(p)
+		t := v.OCIDateTime
+		return rowkey.AppendDate(b, int(v.OCIDateYYYY), int(v.OCIDateMM), int(v.OCIDateDD),
+			int(t.OCITimeHH), int(t.OCITimeMI), int(t.OCITimeSS)), nil
+	case C.SQLT_TIMESTAMP:
+		return rowkey.AppendTimestamp(b, raw)
+	case C.SQLT_TIMESTAMP_TZ, C.SQLT_TIMESTAMP_LTZ:
+		return rowkey.AppendTimestampTZ(b, raw)
+	case C.SQLT_BFLOAT:
+		return rowkey.AppendFloat(b, float64(*(*float32)(p))), nil
+	case C.SQLT_BDOUBLE:
+		return rowkey.AppendFloat(b, *(*float64)(p)), nil
+	case C.SQLT_IBFLOAT:
+		f, err := oraBinary.Float32(raw)
+		return rowkey.AppendFloat(b, float64(f)), err
+	case C.SQLT_IBDOUBLE:
+		f, err := oraBinary.Float64(raw)
+		return rowkey.AppendFloat(b, f), err
+	}
+	// text, RAW, ROWID and the staged interval images compare bytewise
+	return rowkey.AppendBytes(b, raw), nil
+}
+
+// rowKey returns the key of owner.table and starts a new row key, or nil
+// when row keys are off or the table has no key.
+func (x *XStreamConn) rowKey(owner, table string) (*keyDef, error) {
+	if x.keys == nil {
+		return nil, nil
+	}
+	def, err := x.keys.lookup(owner, table)
+	if err != nil || len(def.columns) == 0 {
+		return nil, err
+	}
+	x.keys.reset(def)
+	return def, nil
+}
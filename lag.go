@@ -0,0 +1,131 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"sort"
+	"sync"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/metrics"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// lagMaxMicros bounds the lag histograms at one day.
+const lagMaxMicros = int64(24 * time.Hour / time.Microsecond)
+
+// lagCommits is how many received commits are remembered to find the source
+// time of an acknowledged SCN.
+const lagCommits = 4096
+
+// LagStats describes how far a connection is behind its source. Receive
+// lag is the time from a change at the source to its LCR arriving; ack lag
+// is the time from a commit at the source to SetSCNLwm acknowledging it.
+// Both are measured against source times in the connection's location
+// (see WithLocation), so the clocks of both hosts are assumed to agree.
+type LagStats struct {
+	// Receive and Ack are the latest values. Receive drops to zero when a
+	// heartbeat shows that nothing more is pending.
+	Receive time.Duration
+	Ack     time.Duration
+	// ReceiveMicros and AckMicros are histograms in microseconds.
+	ReceiveMicros metrics.Snapshot
+	AckMicros     metrics.Snapshot
+}
+
+type lagTracker struct {
+	receive     metrics.Gauge
+	ack         metrics.Gauge
+	receiveHist *metrics.Histogram
+	ackHist     *metrics.Histogram
+
+	mu      sync.Mutex
+	commits []lagCommit
+}
+
+type lagCommit struct {
+	scn scn.SCN
+	at  time.Time
+}
+
+func newLagTracker() *lagTracker {
+	return &lagTracker{
+		receiveHist: metrics.NewHistogram(lagMaxMicros),
+		ackHist:     metrics.NewHistogram(lagMaxMicros),
+	}
+}
+
+func (l *lagTracker) received(m Message, now time.Time) {
+	var src time.Time
+	switch m := m.(type) {
+	case *Commit:
+		src = m.SourceTime
+		if !src.IsZero() {
+			l.mu.Lock()
+			if len(l.commits) == lagCommits {
+				l.commits = append(l.commits[:0], l.commits[lagCommits/2:]...)
+			}
+			l.commits = append(l.commits, lagCommit{scn: m.SCN, at: src})
+			l.mu.Unlock()
+		}
+	case *Insert:
+		src = m.SourceTime
+	case *Update:
+		src = m.SourceTime
+	case *Delete:
+		src = m.SourceTime
+	case *HeartBeat:
+		l.receive.Set(0)
+		return
+	}
+	if src.IsZero() {
+		return
+	}
+	d := now.Sub(src)
+	l.receive.Set(int64(d))
+	l.receiveHist.Record(int64(d / time.Microsecond))
+}
+
+// acked records the lag of the newest received commit at or below s and
+// forgets the commits up to it.
+func (l *lagTracker) acked(s scn.SCN, now time.Time) {
+	l.mu.Lock()
+	i := sort.Search(len(l.commits), func(i int) bool { return l.commits[i].scn > s })
+	if i == 0 {
+		l.mu.Unlock()
+		return
+	}
+	src := l.commits[i-1].at
+	l.commits = append(l.commits[:0], l.commits[i:]...)
+	l.mu.Unlock()
+	d := now.Sub(src)
+	l.ack.Set(int64(d))
+	l.ackHist.Record(int64(d / time.Microsecond))
+}
+
+func (l *lagTracker) stats() LagStats {
+	return LagStats{
+		Receive:       time.Duration(l.receive.Value()),
+		Ack:           time.Duration(l.ack.Value()),
+		ReceiveMicros: l.receiveHist.Snapshot(),
+		AckMicros:     l.ackHist.Snapshot(),
+	}
+}
+
+// Lag reports the replication lag of the connection.
+func (x *XStreamConn) Lag() LagStats {
+	return x.lag.stats()
+}
+
+// sourceTime converts the source time of an LCR header, which carries no
+// zone, in the connection's location.
+func (x *XStreamConn) sourceTime(d *C.OCIDate) time.Time {
+	if d.OCIDateYYYY == 0 {
+		return time.Time{}
+	}
+	t := d.OCIDateTime
+	return time.Date(int(d.OCIDateYYYY), time.Month(d.OCIDateMM), int(d.OCIDateDD),
+		int(t.OCITimeHH), int(t.OCITimeMI), int(t.OCITimeSS), 0, x.opts.location)
+}
@@ -2,7 +2,9 @@ package goxstream
 
 import (
 	"fmt"
+	"github.com/yjhatfdu/goxstream/avro"
 	"github.com/yjhatfdu/goxstream/scn"
+	"time"
 )
 
 type Message interface {
@@ -11,7 +13,11 @@ type Message interface {
 }
 
 type Commit struct {
-	SCN scn.SCN
+	SCN        scn.SCN
+	SourceTime time.Time
+	// Position is the raw LCR position of the commit, to checkpoint the
+	// stream at (see checkpoint.Checkpoint and WithCheckpoint).
+	Position []byte
 }
 
 func (c *Commit) Scn() scn.SCN {
@@ -23,11 +29,21 @@ func (c *Commit) String() string {
 }
 
 type Insert struct {
-	SCN       scn.SCN
-	NewColumn []string
-	NewRow    []interface{}
-	Table     string
-	Owner     string
+	SCN        scn.SCN
+	SourceTime time.Time
+	NewColumn  []string
+	NewRow     []interface{}
+	Table      string
+	Owner      string
+	// Key is the encoded primary key of the row with WithRowKeys, nil
+	// without it or when a key column is missing from the row.
+	Key []byte
+	// JSON is the change encoded with WithJSON.
+	JSON []byte
+	// Avro is the change encoded with WithAvro in Avro single object
+	// encoding, and AvroSchema the schema it is written in.
+	Avro       []byte
+	AvroSchema *avro.Schema
 }
 
 func (c *Insert) Scn() scn.SCN {
@@ -39,11 +55,16 @@ func (c *Insert) String() string {
 }
 
 type Delete struct {
-	SCN       scn.SCN
-	OldColumn []string
-	OldRow    []interface{}
-	Table     string
-	Owner     string
+	SCN        scn.SCN
+	SourceTime time.Time
+	OldColumn  []string
+	OldRow     []interface{}
+	Table      string
+	Owner      string
+	Key        []byte
+	JSON       []byte
+	Avro       []byte
+	AvroSchema *avro.Schema
 }
 
 func (c *Delete) Scn() scn.SCN {
@@ -54,13 +75,20 @@ func (c *Delete) String() string {
 }
 
 type Update struct {
-	SCN       scn.SCN
-	NewColumn []string
-	NewRow    []interface{}
-	OldColumn []string
-	OldRow    []interface{}
-	Table     string
-	Owner     string
+	SCN        scn.SCN
+	SourceTime time.Time
+	NewColumn  []string
+	NewRow     []interface{}
+	OldColumn  []string
+	OldRow     []interface{}
+	Table      string
+	Owner      string
+	Key        []byte
+	// NewKey is the key after the update when the update changed it.
+	NewKey     []byte
+	JSON       []byte
+	Avro       []byte
+	AvroSchema *avro.Schema
 }
 
 func (c *Update) Scn() scn.SCN {
@@ -70,8 +98,14 @@ func (c *Update) String() string {
 	return fmt.Sprintf("CMD: UPDATE\tSCN:%s\n", c.SCN.String())
 }
 
+// HeartBeat reports the fetch low watermark when the outbound server has
+// nothing more to send.
 type HeartBeat struct {
 	SCN scn.SCN
+	// Position is the fetch low watermark the SCN was read from, a raw LCR
+	// position like Commit.Position. Heartbeats at the same position share
+	// it, so it must not be modified.
+	Position []byte
 }
 
 func (h *HeartBeat) Scn() scn.SCN {
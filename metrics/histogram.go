@@ -0,0 +1,156 @@
+// Package metrics holds the lock-free counters, gauges and histograms that
+// goxstream connections keep about themselves.
+package metrics
+
+import (
+	"math/bits"
+	"sync/atomic"
+)
+
+// subBits sets the histogram precision: every power of two is split into
+// 1<<subBits linear buckets, so a recorded value is off by less than
+// 1/128 of itself, as in an HDR histogram with two significant digits.
+const (
+	subBits  = 7
+	subCount = 1 << subBits
+)
+
+// Histogram is a log-linear histogram of non-negative values that can be
+// recorded from any number of goroutines without locking. Values above the
+// maximum given to NewHistogram are counted as the maximum.
+type Histogram struct {
+	counts []uint64
+	max    int64
+	count  uint64
+	sum    uint64
+	high   int64
+}
+
+// NewHistogram returns a histogram for values from 0 to max.
+func NewHistogram(max int64) *Histogram {
+	if max < subCount {
+		max = subCount
+	}
+	return &Histogram{counts: make([]uint64, bucketOf(max)+1), max: max}
+}
+
+func bucketOf(v int64) int {
+	if v < subCount {
+		return int(v)
+	}
+	shift := bits.Len64(uint64(v)) - subBits - 1
+	return subCount*shift + int(v>>uint(shift))
+}
+
+// bucketValue is the middle of the values that fall into bucket i.
+func bucketValue(i int) int64 {
+	if i < 2*subCount {
+		return int64(i)
+	}
+	shift := i/subCount - 1
+	low := int64(i-subCount*shift) << uint(shift)
+	return low + (int64(1)<<uint(shift))/2
+}
+
+// Record adds v to the histogram. Negative values are recorded as 0.
+func (h *Histogram) Record(v int64) {
+	if v < 0 {
+		v = 0
+	} else if v > h.max {
+		v = h.max
+	}
+	atomic.AddUint64(&h.counts[bucketOf(v)], 1)
+	atomic.AddUint64(&h.count, 1)
+	atomic.AddUint64(&h.sum, uint64(v))
+	for {
+		high := atomic.LoadInt64(&h.high)
+		if v <= high || atomic.CompareAndSwapInt64(&h.high, high, v) {
+			return
+		}
+	}
+}
+
+// Snapshot summarises a histogram. Quantiles are accurate to the bucket
+// precision; Max is exact.
+type Snapshot struct {
+	Count uint64
+	Mean  float64
+	P50   int64
+	P90   int64
+	P99   int64
+	P999  int64
+	Max   int64
+}
+
+// Snapshot reads the histogram. Values recorded while it runs may or may
+// not be included.
+func (h *Histogram) Snapshot() Snapshot {
+	counts := make([]uint64, len(h.counts))
+	var total uint64
+	for i := range h.counts {
+		counts[i] = atomic.LoadUint64(&h.counts[i])
+		total += counts[i]
+	}
+	s := Snapshot{Count: total, Max: atomic.LoadInt64(&h.high)}
+	if total == 0 {
+		return s
+	}
+	s.Mean = float64(atomic.LoadUint64(&h.sum)) / float64(atomic.LoadUint64(&h.count))
+	s.P50 = quantile(counts, total, 0.5)
+	s.P90 = quantile(counts, total, 0.9)
+	s.P99 = quantile(counts, total, 0.99)
+	s.P999 = quantile(counts, total, 0.999)
+	for _, p := range []*int64{&s.P50, &s.P90, &s.P99, &s.P999} {
+		if *p > s.Max {
+			*p = s.Max
+		}
+	}
+	return s
+}
+
+// Quantile returns the value below which the fraction q of the recorded
+// values fall.
+func (h *Histogram) Quantile(q float64) int64 {
+	counts := make([]uint64, len(h.counts))
+	var total uint64
+	for i := range h.counts {
+		counts[i] = atomic.LoadUint64(&h.counts[i])
+		total += counts[i]
+	}
+	if total == 0 {
+		return 0
+	}
+	v := quantile(counts, total, q)
+	if high := atomic.LoadInt64(&h.high); v > high {
+		v = high
+	}
+	return v
+}
+
+func quantile(counts []uint64, total uint64, q float64) int64 {
+	rank := uint64(q*float64(total) + 0.5)
+	if rank < 1 {
+		rank = 1
+	}
+	var seen uint64
+	for i, c := range counts {
+		seen += c
+		if seen >= rank {
+			return bucketValue(i)
+		}
+	}
+	return bucketValue(len(counts) - 1)
+}
+
+// Gauge is a value that is set rather than accumulated.
+type Gauge struct {
+	v int64
+}
+
+func (g *Gauge) Set(v int64) {
+	atomic.StoreInt64(&g.v, v)
+}
+
+func (g *Gauge) Value() int64 {
+	return atomic.LoadInt64(&g.v)
+}
@@ -0,0 +1,63 @@
+package metrics
+
+import (
+	"sync"
+	"testing"
+)
+
+func TestBuckets(t *testing.T) {
+	prev := -1
+	for v := int64(0); v < 1<<20; v++ {
+		b := bucketOf(v)
+		if b < prev || b > prev+1 {
+			t.Fatalf("bucketOf(%d) = %d after %d", v, b, prev)
+		}
+		prev = b
+		mid := bucketValue(b)
+		if d := mid - v; d*subCount > v+subCount || -d*subCount > v+subCount {
+			t.Fatalf("bucketValue(bucketOf(%d)) = %d", v, mid)
+		}
+	}
+}
+
+func TestSnapshot(t *testing.T) {
+	h := NewHistogram(1e9)
+	for v := int64(1); v <= 10000; v++ {
+		h.Record(v)
+	}
+	s := h.Snapshot()
+	if s.Count != 10000 || s.Max != 10000 || s.Mean != 5000.5 {
+		t.Fatalf("snapshot %+v", s)
+	}
+	for _, c := range []struct{ got, want int64 }{{s.P50, 5000}, {s.P90, 9000}, {s.P99, 9900}} {
+		if d := c.got - c.want; d*100 > c.want || -d*100 > c.want {
+			t.Errorf("quantile %d, want about %d", c.got, c.want)
+		}
+	}
+	if q := h.Quantile(1); q != 10000 {
+		t.Errorf("Quantile(1) = %d", q)
+	}
+}
+
+func TestClampAndConcurrency(t *testing.T) {
+	h := NewHistogram(1000)
+	var wg sync.WaitGroup
+	for g := 0; g < 4; g++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			for i := 0; i < 1000; i++ {
+				h.Record(5000)
+				h.Record(-1)
+			}
+		}()
+	}
+	wg.Wait()
+	s := h.Snapshot()
+	if s.Count != 8000 || s.Max != 1000 {
+		t.Fatalf("snapshot %+v", s)
+	}
+	if h.Quantile(0.25) != 0 {
+		t.Errorf("Quantile(0.25) = %d", h.Quantile(0.25))
+	}
+}
@@ -0,0 +1,181 @@
+package metrics
+
+import (
+	"bufio"
+	"io"
+	"math"
+	"net/http"
+	"sort"
+	"strconv"
+	"strings"
+	"sync"
+)
+
+// Label is a Prometheus label pair.
+type Label struct {
+	Name, Value string
+}
+
+// Collector reports its current values to a Writer on every scrape.
+type Collector interface {
+	Collect(w *Writer)
+}
+
+// Registry is a set of collectors exported together in the Prometheus text
+// format. It is an http.Handler serving that format.
+type Registry struct {
+	mu         sync.Mutex
+	collectors []Collector
+}
+
+func NewRegistry() *Registry {
+	return &Registry{}
+}
+
+func (r *Registry) Register(c Collector) {
+	r.mu.Lock()
+	r.collectors = append(r.collectors, c)
+	r.mu.Unlock()
+}
+
+func (r *Registry) Unregister(c Collector) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	for i, rc := range r.collectors {
+		if rc == c {
+			r.collectors = append(r.collectors[:i], r.collectors[i+1:]...)
+			return
+		}
+	}
+}
+
+// WriteText collects every registered collector and writes the result in
+// the Prometheus text exposition format.
+func (r *Registry) WriteText(out io.Writer) error {
+	r.mu.Lock()
+	cs := append([]Collector(nil), r.collectors...)
+	r.mu.Unlock()
+	w := &Writer{families: map[string]*family{}}
+	for _, c := range cs {
+		c.Collect(w)
+	}
+	return w.writeTo(out)
+}
+
+func (r *Registry) ServeHTTP(rw http.ResponseWriter, _ *http.Request) {
+	rw.Header().Set("Content-Type", "text/plain; version=0.0.4; charset=utf-8")
+	_ = r.WriteText(rw)
+}
+
+// Writer gathers the samples of one scrape, grouped into metric families.
+type Writer struct {
+	families map[string]*family
+}
+
+type family struct {
+	help, typ string
+	samples   []string
+}
+
+func (w *Writer) family(name, help, typ string) *family {
+	f := w.families[name]
+	if f == nil {
+		f = &family{help: help, typ: typ}
+		w.families[name] = f
+	}
+	return f
+}
+
+func (w *Writer) sample(f *family, name string, labels []Label, v float64) {
+	var b strings.Builder
+	b.WriteString(name)
+	if len(labels) > 0 {
+		b.WriteByte('{')
+		for i, l := range labels {
+			if i > 0 {
+				b.WriteByte(',')
+			}
+			b.WriteString(l.Name)
+			b.WriteString(`="`)
+			writeLabelValue(&b, l.Value)
+			b.WriteByte('"')
+		}
+		b.WriteByte('}')
+	}
+	b.WriteByte(' ')
+	b.WriteString(formatFloat(v))
+	f.samples = append(f.samples, b.String())
+}
+
+func (w *Writer) Counter(name, help string, v uint64, labels ...Label) {
+	w.sample(w.family(name, help, "counter"), name, labels, float64(v))
+}
+
+func (w *Writer) Gauge(name, help string, v float64, labels ...Label) {
+	w.sample(w.family(name, help, "gauge"), name, labels, v)
+}
+
+// Summary writes a histogram snapshot as a summary, multiplying its values
+// by scale (e.g. 1e-9 to report nanoseconds as seconds).
+func (w *Writer) Summary(name, help string, s Snapshot, scale float64, labels ...Label) {
+	f := w.family(name, help, "summary")
+	for _, q := range []struct {
+		q string
+		v int64
+	}{{"0.5", s.P50}, {"0.9", s.P90}, {"0.99", s.P99}, {"0.999", s.P999}} {
+		ls := append(labels[:len(labels):len(labels)], Label{"quantile", q.q})
+		w.sample(f, name, ls, float64(q.v)*scale)
+	}
+	w.sample(f, name+"_sum", labels, s.Mean*float64(s.Count)*scale)
+	w.sample(f, name+"_count", labels, float64(s.Count))
+}
+
+func (w *Writer) writeTo(out io.Writer) error {
+	names := make([]string, 0, len(w.families))
+	for name := range w.families {
+		names = append(names, name)
+	}
+	sort.Strings(names)
+	bw := bufio.NewWriter(out)
+	for _, name := range names {
+		f := w.families[name]
+		bw.WriteString("# HELP " + name + " " + escapeHelp(f.help) + "\n")
+		bw.WriteString("# TYPE " + name + " " + f.typ + "\n")
+		for _, s := range f.samples {
+			bw.WriteString(s)
+			bw.WriteByte('\n')
+		}
+	}
+	return bw.Flush()
+}
+
+func writeLabelValue(b *strings.Builder, v string) {
+	for i := 0; i < len(v); i++ {
+		switch c := v[i]; c {
+		case '\\':
+			b.WriteString(`\\`)
+		case '"':
+			b.WriteString(`\"`)
+		case '\n':
+			b.WriteString(`\n`)
+		default:
+			b.WriteByte(c)
+		}
+	}
+}
+
+func escapeHelp(s string) string {
+	return strings.NewReplacer(`\`, `\\`, "\n", `\n`).Replace(s)
+}
+
+func formatFloat(v float64) string {
+	switch {
+	case math.IsInf(v, 1):
+		return "+Inf"
+	case math.IsInf(v, -1):
+		return "-Inf"
+	case math.IsNaN(v):
+		return "NaN"
+	}
+	return strconv.FormatFloat(v, 'g', -1, 64)
+}
@@ -0,0 +1,60 @@
+package metrics
+
+import (
+	"net/http/httptest"
+	"strings"
+	"testing"
+)
+
+type testCollector struct {
+	collect func(w *Writer)
+}
+
+func (c *testCollector) Collect(w *Writer) { c.collect(w) }
+
+func TestWriteText(t *testing.T) {
+	h := NewHistogram(1000)
+	h.Record(10)
+	h.Record(20)
+	r := NewRegistry()
+	a := &testCollector{func(w *Writer) {
+		w.Counter("x_total", "X count.", 3, Label{"conn", "a"})
+		w.Summary("x_seconds", "X time.", h.Snapshot(), 0.5)
+	}}
+	b := &testCollector{func(w *Writer) {
+		w.Counter("x_total", "X count.", 4, Label{"conn", `b"\`})
+		w.Gauge("a_lag", "Lag.", 1.5)
+	}}
+	r.Register(a)
+	r.Register(b)
+	var out strings.Builder
+	if err := r.WriteText(&out); err != nil {
+		t.Fatal(err)
+	}
+	want := `# HELP a_lag Lag.
+# TYPE a_lag gauge
+a_lag 1.5
+# HELP x_seconds X time.
+# TYPE x_seconds summary
+x_seconds{quantile="0.5"} 5
+x_seconds{quantile="0.9"} 10
+x_seconds{quantile="0.99"} 10
+x_seconds{quantile="0.999"} 10
+x_seconds_sum 15
+x_seconds_count 2
+# HELP x_total X count.
+# TYPE x_total counter
+x_total{conn="a"} 3
+x_total{conn="b\"\\"} 4
+`
+	if out.String() != want {
+		t.Fatalf("got\n%s\nwant\n%s", out.String(), want)
+	}
+
+	r.Unregister(a)
+	rec := httptest.NewRecorder()
+	r.ServeHTTP(rec, httptest.NewRequest("GET", "/metrics", nil))
+	if body := rec.Body.String(); strings.Contains(body, "x_seconds") || !strings.Contains(body, "a_lag 1.5") {
+		t.Fatalf("after Unregister:\n%s", body)
+	}
+}
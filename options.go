@@ -0,0 +1,219 @@
+package goxstream
+
+import (
+	"time"
+
+	"github.com/yjhatfdu/goxstream/checkpoint"
+	"github.com/yjhatfdu/goxstream/metrics"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// Option configures optional behaviour of a connection created by Open.
+type Option func(*options)
+
+type options struct {
+	pooledAlloc bool
+	location    *time.Location
+	epochMicros bool
+	trustText   bool
+	runtime     *Runtime
+	csid        int
+	ncsid       int
+	resumeSCN   scn.SCN
+	resumePos   []byte
+	backoffMin  time.Duration
+	backoffMax  time.Duration
+	registry    *metrics.Registry
+	connLabel   string
+	profile     bool
+	batchSize   int
+	flushEvery  time.Duration
+	rowKeys     bool
+	json        bool
+	avro        bool
+}
+
+func newOptions(opts []Option) *options {
+	o := &options{
+		location:   time.Local,
+		backoffMin: 100 * time.Millisecond,
+		backoffMax: 30 * time.Second,
+		batchSize:  256,
+	}
+	for _, opt := range opts {
+		opt(o)
+	}
+	return o
+}
+
+// WithPooledAllocator installs size-class pooled malloc/realloc/free
+// callbacks into the OCI environment, so the memory OCI allocates for each
+// received LCR is recycled instead of going through the C allocator.
+// Allocation counters are available through XStreamConn.MemStats.
+func WithPooledAllocator() Option {
+	return func(o *options) {
+		o.pooledAlloc = true
+	}
+}
+
+// WithLocation sets the zone DATE and TIMESTAMP values (which carry no zone
+// of their own) are interpreted in. The default is time.Local.
+func WithLocation(loc *time.Location) Option {
+	return func(o *options) {
+		o.location = loc
+	}
+}
+
+// WithEpochMicros decodes DATE and all TIMESTAMP columns as int64
+// microseconds since the Unix epoch instead of time.Time. DATE and
+// TIMESTAMP wall clocks are taken as UTC; zoned timestamps are converted
+// to UTC.
+func WithEpochMicros() Option {
+	return func(o *options) {
+		o.epochMicros = true
+	}
+}
+
+// WithTrustedEncoding skips UTF-8 validation of text from an AL32UTF8 or
+// UTF8 database and copies it as is. Only use it when the source is known
+// to hold well-formed data; invalid bytes are passed on unchanged.
+func WithTrustedEncoding() Option {
+	return func(o *options) {
+		o.trustText = true
+	}
+}
+
+// WithCharsets sets the database CHAR and NCHAR character set ids, so Open
+// neither queries them nor consults the charsets cached from an earlier
+// Open of the same user and database.
+func WithCharsets(csid, ncsid int) Option {
+	return func(o *options) {
+		o.csid = csid
+		o.ncsid = ncsid
+	}
+}
+
+// WithResumeSCN attaches at the position of s, as SetSCNLwm would record
+// it, so the outbound server starts streaming after it. LCRs at or before
+// that position that are still sent are dropped before being decoded, so
+// changes already applied before a restart are not seen again. It
+// replaces the position of an earlier WithResumePosition or WithCheckpoint.
+func WithResumeSCN(s scn.SCN) Option {
+	return func(o *options) {
+		o.resumeSCN = s
+		o.resumePos = nil
+	}
+}
+
+// WithResumePosition is WithResumeSCN for a raw LCR position, e.g. one
+// saved from a previous run.
+func WithResumePosition(pos []byte) Option {
+	return func(o *options) {
+		o.resumePos = append([]byte(nil), pos...)
+	}
+}
+
+// WithCheckpoint resumes after a checkpoint loaded from a checkpoint.Store,
+// at its position if it has one and at its SCN otherwise. Checkpoint the
+// SCN and Position of the last Commit or HeartBeat processed. The zero
+// Checkpoint, as returned for a consumer without one, leaves the start
+// to the outbound server.
+func WithCheckpoint(c checkpoint.Checkpoint) Option {
+	return func(o *options) {
+		o.resumeSCN = c.SCN
+		if c.Position != nil {
+			o.resumePos = append([]byte(nil), c.Position...)
+		} else {
+			o.resumePos = nil
+		}
+	}
+}
+
+// WithBackoff sets how long a SupervisedConn waits before reopening: min
+// after the first failure, doubling up to max. The defaults are 100ms and
+// 30s.
+func WithBackoff(min, max time.Duration) Option {
+	return func(o *options) {
+		o.backoffMin = min
+		o.backoffMax = max
+	}
+}
+
+// WithMetrics registers the connection with r until it is closed. Its
+// counters (LCRs per command and table, bytes, LOB chunks, heartbeats,
+// errors), per-stage receive latencies and lag are then exported through
+// r, which serves them to Prometheus as an http.Handler. The series are
+// labelled with the server name, so connections to the same server need
+// WithMetricsLabel to tell them apart.
+func WithMetrics(r *metrics.Registry) Option {
+	return func(o *options) {
+		o.registry = r
+	}
+}
+
+// WithMetricsLabel adds the label conn="name" to the series of
+// WithMetrics. A SupervisedConn passes it to every reopened connection, so
+// its series carry on across reconnects.
+func WithMetricsLabel(name string) Option {
+	return func(o *options) {
+		o.connLabel = name
+	}
+}
+
+// WithOCIProfiling times the hot-path OCI calls and copies in C (see
+// XStreamConn.OCIProfile) and labels row decoding with the owner and table
+// for pprof.
+func WithOCIProfiling() Option {
+	return func(o *options) {
+		o.profile = true
+	}
+}
+
+// WithRowKeys loads the primary key (or else the first unique key) of
+// the streamed tables over a second session and sets the Key of every row
+// message to its memcomparable encoding (see package rowkey). Keys are
+// loaded for the tables in the outbound server's rules at Open and for
+// other tables when they are first seen, and reloaded after DDL.
+func WithRowKeys() Option {
+	return func(o *options) {
+		o.rowKeys = true
+	}
+}
+
+// WithJSON encodes every row message to JSON while it is decoded, from
+// the raw column values (see package jsonenc), and sets its JSON field
+// instead of the column and row slices. Events of many messages share
+// buffers, so a message's JSON must not be modified.
+func WithJSON() Option {
+	return func(o *options) {
+		o.json = true
+	}
+}
+
+// WithAvro encodes every row message to Avro while it is decoded, from the
+// raw column values, and sets its Avro and AvroSchema fields instead of
+// the column and row slices. The schema of each table is derived from the
+// column types in its LCRs and changes as new columns appear (see package
+// avro). Events of many messages share buffers, so a message's Avro must
+// not be modified. WithAvro can be combined with WithJSON.
+func WithAvro() Option {
+	return func(o *options) {
+		o.avro = true
+	}
+}
+
+// WithBatchSize sets how many LCRs an XStreamInConn buffers before handing
+// them to OCI in a single call. The default is 256.
+func WithBatchSize(n int) Option {
+	return func(o *options) {
+		o.batchSize = n
+	}
+}
+
+// WithFlushInterval makes an XStreamInConn flush in the background every d
+// and refresh the processed low watermark reported by ProcessedLWM.
+func WithFlushInterval(d time.Duration) Option {
+	return func(o *options) {
+		o.flushEvery = d
+	}
+}
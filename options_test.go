@@ -0,0 +1,19 @@
+package goxstream
+
+import (
+	"bytes"
+	"testing"
+
+	"github.com/yjhatfdu/goxstream/checkpoint"
+)
+
+func TestWithCheckpointReplacesResumePosition(t *testing.T) {
+	o := newOptions([]Option{WithResumePosition([]byte{1}), WithCheckpoint(checkpoint.Checkpoint{SCN: 100})})
+	if o.resumePos != nil || o.resumeSCN != 100 {
+		t.Fatalf("resume at %x, SCN %d; want SCN 100", o.resumePos, o.resumeSCN)
+	}
+	o = newOptions([]Option{WithResumeSCN(5), WithCheckpoint(checkpoint.Checkpoint{SCN: 100, Position: []byte{2}})})
+	if !bytes.Equal(o.resumePos, []byte{2}) {
+		t.Fatalf("resume at %x, want the checkpoint's position", o.resumePos)
+	}
+}
@@ -0,0 +1,115 @@
+// Package oraBinary decodes Oracle binary column images: canonical
+// BINARY_FLOAT/BINARY_DOUBLE values and extended ROWIDs.
+package oraBinary
+
+import (
+	"errors"
+	"math"
+)
+
+var (
+	ErrInvalidLength = errors.New("oraBinary: invalid image length")
+	ErrInvalidRowid  = errors.New("oraBinary: not an extended rowid")
+)
+
+// Float32 decodes a 4 byte canonical BINARY_FLOAT. Oracle stores the IEEE
+// bits big endian with the sign bit flipped for positive values and all
+// bits inverted for negative ones, so that the images sort bytewise.
+func Float32(b []byte) (float32, error) {
+	if len(b) != 4 {
+		return 0, ErrInvalidLength
+	}
+	u := uint32(b[0])<<24 | uint32(b[1])<<16 | uint32(b[2])<<8 | uint32(b[3])
+	if u&0x80000000 != 0 {
+		u &^= 0x80000000
+	} else {
+		u = ^u
+	}
+	return math.Float32frombits(u), nil
+}
+
+// Float64 decodes an 8 byte canonical BINARY_DOUBLE, see Float32.
+func Float64(b []byte) (float64, error) {
+	if len(b) != 8 {
+		return 0, ErrInvalidLength
+	}
+	u := uint64(b[0])<<56 | uint64(b[1])<<48 | uint64(b[2])<<40 | uint64(b[3])<<32 |
+		uint64(b[4])<<24 | uint64(b[5])<<16 | uint64(b[6])<<8 | uint64(b[7])
+	if u&0x8000000000000000 != 0 {
+		u &^= 0x8000000000000000
+	} else {
+		u = ^u
+	}
+	return math.Float64frombits(u), nil
+}
+
+// Rowid is a physical extended ROWID.
+type Rowid struct {
+	Object uint32 // data object number
+	File   uint16 // relative file number
+	Block  uint32 // block number within the file
+	Row    uint16 // row slot within the block
+}
+
+// RowidLen is the length of the base64 form of an extended ROWID.
+const RowidLen = 18
+
+const rowidAlphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/"
+
+var rowidValues [256]byte
+
+func init() {
+	for i := range rowidValues {
+		rowidValues[i] = 0xff
+	}
+	for i := 0; i < len(rowidAlphabet); i++ {
+		rowidValues[rowidAlphabet[i]] = byte(i)
+	}
+}
+
+// ParseRowid decodes the 18 character OOOOOOFFFBBBBBBRRR form returned by
+// OCIRowidToChar. Logical (IOT) and foreign UROWIDs are rejected.
+func ParseRowid(b []byte) (Rowid, error) {
+	if len(b) != RowidLen {
+		return Rowid{}, ErrInvalidRowid
+	}
+	var v [RowidLen]uint64
+	for i, c := range b {
+		d := rowidValues[c]
+		if d == 0xff {
+			return Rowid{}, ErrInvalidRowid
+		}
+		v[i] = uint64(d)
+	}
+	field := func(from, to int) uint64 {
+		var n uint64
+		for _, d := range v[from:to] {
+			n = n<<6 | d
+		}
+		return n
+	}
+	return Rowid{
+		Object: uint32(field(0, 6)),
+		File:   uint16(field(6, 9)),
+		Block:  uint32(field(9, 15)),
+		Row:    uint16(field(15, 18)),
+	}, nil
+}
+
+// AppendText appends the 18 character base64 form of r to dst.
+func (r Rowid) AppendText(dst []byte) []byte {
+	put := func(n uint64, width int) {
+		for i := width - 1; i >= 0; i-- {
+			dst = append(dst, rowidAlphabet[(n>>(6*uint(i)))&63])
+		}
+	}
+	put(uint64(r.Object), 6)
+	put(uint64(r.File), 3)
+	put(uint64(r.Block), 6)
+	put(uint64(r.Row), 3)
+	return dst
+}
+
+func (r Rowid) String() string {
+	return string(r.AppendText(make([]byte, 0, RowidLen)))
+}
@@ -0,0 +1,54 @@
+package oraBinary
+
+import (
+	"math"
+	"testing"
+)
+
+func canonical64(f float64) []byte {
+	u := math.Float64bits(f)
+	if u&(1<<63) == 0 {
+		u |= 1 << 63
+	} else {
+		u = ^u
+	}
+	b := make([]byte, 8)
+	for i := range b {
+		b[i] = byte(u >> (56 - 8*uint(i)))
+	}
+	return b
+}
+
+func TestFloat(t *testing.T) {
+	for _, f := range []float64{0, 1.5, -1.5, math.MaxFloat64, -math.SmallestNonzeroFloat64, math.Inf(-1)} {
+		got, err := Float64(canonical64(f))
+		if err != nil || got != f {
+			t.Fatalf("Float64(%v) = %v, %v", f, got, err)
+		}
+	}
+	got, err := Float32([]byte{0xbf, 0xc0, 0, 0})
+	if err != nil || got != 1.5 {
+		t.Fatalf("Float32 = %v, %v", got, err)
+	}
+	got, _ = Float32([]byte{0x40, 0x3f, 0xff, 0xff})
+	if got != -1.5 {
+		t.Fatalf("Float32 = %v", got)
+	}
+}
+
+func TestRowid(t *testing.T) {
+	const text = "AAAR3sAAEAAAACXAAA"
+	r, err := ParseRowid([]byte(text))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if r.Object != 73196 || r.File != 4 || r.Block != 151 || r.Row != 0 {
+		t.Fatalf("unexpected %+v", r)
+	}
+	if r.String() != text {
+		t.Fatalf("round trip %s", r.String())
+	}
+	if _, err := ParseRowid([]byte("*BAMAAJUCwQL+")); err != ErrInvalidRowid {
+		t.Fatal("expected error for logical rowid")
+	}
+}
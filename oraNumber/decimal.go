@@ -0,0 +1,136 @@
+package oraNumber
+
+import "errors"
+
+var (
+	// ErrInvalid is returned for a malformed NUMBER image.
+	ErrInvalid = errors.New("oraNumber: malformed NUMBER")
+	// ErrInfinite is returned for the +/-infinity images, which have no
+	// decimal form.
+	ErrInfinite = errors.New("oraNumber: infinite NUMBER")
+)
+
+// AppendDecimal appends the exact decimal text of an OCINumber image (a
+// length byte followed by the exponent and base 100 mantissa bytes) to
+// dst, without exponent notation, e.g. "-123.45" or "0.001".
+func AppendDecimal(dst, num []byte) ([]byte, error) {
+	m, exp, neg, err := parse(num)
+	if err != nil || m == nil {
+		if err == nil {
+			dst = append(dst, '0')
+		}
+		return dst, err
+	}
+	if neg {
+		dst = append(dst, '-')
+	}
+	if exp < 0 {
+		dst = append(dst, '0', '.')
+		for i := exp + 1; i < 0; i++ {
+			dst = append(dst, '0', '0')
+		}
+		return appendFraction(dst, m, 0, neg), nil
+	}
+	if d := digit(m, 0, neg); d >= 10 {
+		dst = append(dst, '0'+d/10, '0'+d%10)
+	} else {
+		dst = append(dst, '0'+d)
+	}
+	for i := 1; i <= exp; i++ {
+		d := digit(m, i, neg)
+		dst = append(dst, '0'+d/10, '0'+d%10)
+	}
+	if exp+1 < len(m) {
+		dst = appendFraction(append(dst, '.'), m, exp+1, neg)
+	}
+	return dst, nil
+}
+
+// Int64 returns the value of an OCINumber image if it is an integer that
+// fits in an int64.
+func Int64(num []byte) (int64, bool) {
+	m, exp, neg, err := parse(num)
+	if err != nil || exp >= 10 || exp < len(m)-1 {
+		return 0, false
+	}
+	var v uint64
+	for i := 0; i <= exp && m != nil; i++ {
+		if v > (1<<64-1-99)/100 {
+			return 0, false
+		}
+		v = v*100 + uint64(digit(m, i, neg))
+	}
+	if neg {
+		if v > 1<<63 {
+			return 0, false
+		}
+		return -int64(v), true
+	}
+	if v > 1<<63-1 {
+		return 0, false
+	}
+	return int64(v), true
+}
+
+// parse splits an OCINumber image into its mantissa bytes, without the
+// trailing byte of negative numbers, and base 100 exponent: the value is
+// sum(digit(i) * 100^(exp-i)). Zero has a nil mantissa.
+func parse(num []byte) (m []byte, exp int, neg bool, err error) {
+	if len(num) < 2 || int(num[0]) >= len(num) || num[0] > 21 {
+		return nil, 0, false, ErrInvalid
+	}
+	b := num[1 : 1+num[0]]
+	e := b[0]
+	m = b[1:]
+	if len(m) == 0 {
+		switch e {
+		case 0x80:
+			return nil, 0, false, nil
+		case 0x00:
+			return nil, 0, false, ErrInfinite
+		}
+		return nil, 0, false, ErrInvalid
+	}
+	neg = e&0x80 == 0
+	if neg {
+		e = ^e
+		if m[len(m)-1] == tRAILING_BYTE_ON_NEGATIVE_NUMBERS {
+			m = m[:len(m)-1]
+		}
+		if len(m) == 0 {
+			return nil, 0, false, ErrInvalid
+		}
+	} else if e == 0xff && m[0] == 0x65 {
+		return nil, 0, false, ErrInfinite
+	}
+	for i, c := range m {
+		if c == 0 || c > 0x65 || digit(m, i, neg) > 99 {
+			return nil, 0, false, ErrInvalid
+		}
+	}
+	return m, int(e) - 0xc1, neg, nil
+}
+
+// appendFraction appends the digit pairs from i on, dropping the trailing
+// zero of the last pair.
+func appendFraction(dst, m []byte, i int, neg bool) []byte {
+	for ; i < len(m); i++ {
+		d := digit(m, i, neg)
+		dst = append(dst, '0'+d/10)
+		if d%10 != 0 || i < len(m)-1 {
+			dst = append(dst, '0'+d%10)
+		}
+	}
+	return dst
+}
+
+// digit returns base 100 digit i of the mantissa m, 0 past its end.
+func digit(m []byte, i int, neg bool) byte {
+	if i >= len(m) {
+		return 0
+	}
+	if neg {
+		return 0x65 - m[i]
+	}
+	return m[i] - 1
+}
@@ -0,0 +1,63 @@
+package oraNumber
+
+import "testing"
+
+func TestAppendDecimal(t *testing.T) {
+	for _, c := range []struct {
+		num  []byte
+		want string
+	}{
+		{[]byte{1, 0x80}, "0"},
+		{[]byte{2, 0xc1, 0x02}, "1"},
+		{[]byte{2, 0xc2, 0x02}, "100"},
+		{[]byte{2, 0xc6, 0x02}, "10000000000"},
+		{[]byte{4, 0xc2, 0x02, 0x18, 0x2e}, "123.45"},
+		{[]byte{3, 0xc2, 0x0b, 0x02}, "1001"},
+		{[]byte{2, 0xc0, 0x33}, "0.5"},
+		{[]byte{2, 0xbf, 0x0b}, "0.001"},
+		{[]byte{3, 0x3e, 0x64, 0x66}, "-1"},
+		{[]byte{5, 0x3d, 0x64, 0x4e, 0x38, 0x66}, "-123.45"},
+		{[]byte{3, 0x3f, 0x33, 0x66}, "-0.5"},
+	} {
+		got, err := AppendDecimal([]byte("x"), c.num)
+		if err != nil || string(got) != "x"+c.want {
+			t.Errorf("AppendDecimal(% x) = %q, %v, want %q", c.num, got, err, c.want)
+		}
+	}
+	for _, num := range [][]byte{nil, {5, 0xc1, 0x02}, {2, 0xc1, 0x00}, {2, 0xc1, 0x66}, {2, 0x3e, 0x66}} {
+		if _, err := AppendDecimal(nil, num); err != ErrInvalid {
+			t.Errorf("AppendDecimal(% x) returned %v", num, err)
+		}
+	}
+	for _, num := range [][]byte{{1, 0x00}, {2, 0xff, 0x65}} {
+		if _, err := AppendDecimal(nil, num); err != ErrInfinite {
+			t.Errorf("AppendDecimal(% x) returned %v", num, err)
+		}
+	}
+}
+
+func TestInt64(t *testing.T) {
+	for _, c := range []struct {
+		num  []byte
+		want int64
+		ok   bool
+	}{
+		{[]byte{1, 0x80}, 0, true},
+		{[]byte{2, 0xc2, 0x02}, 100, true},
+		{[]byte{3, 0xc2, 0x0b, 0x02}, 1001, true},
+		{[]byte{3, 0x3e, 0x64, 0x66}, -1, true},
+		// 9223372036854775807 and -9223372036854775808
+		{[]byte{11, 0xca, 0x0a, 0x17, 0x22, 0x49, 0x04, 0x45, 0x37, 0x4e, 0x3b, 0x08}, 1<<63 - 1, true},
+		{[]byte{12, 0x35, 0x5c, 0x4f, 0x44, 0x1d, 0x62, 0x21, 0x2f, 0x18, 0x2b, 0x5d, 0x66}, -1 << 63, true},
+		{[]byte{11, 0xca, 0x0a, 0x17, 0x22, 0x49, 0x04, 0x45, 0x37, 0x4e, 0x3b, 0x09}, 0, false},
+		{[]byte{2, 0xca, 0x5b}, 0, false}, // 9e19 overflows a uint64
+		{[]byte{4, 0xc2, 0x02, 0x18, 0x2e}, 0, false},
+		{[]byte{2, 0xc0, 0x33}, 0, false},
+		{[]byte{1, 0x00}, 0, false},
+	} {
+		got, ok := Int64(c.num)
+		if got != c.want || ok != c.ok {
+			t.Errorf("Int64(% x) = %d, %v, want %d, %v", c.num, got, ok, c.want, c.ok)
+		}
+	}
+}
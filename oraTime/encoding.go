@@ -0,0 +1,204 @@
+// Package oraTime decodes the fixed-width datetime and interval images that
+// xstrm.c stages for TIMESTAMP, TIMESTAMP WITH (LOCAL) TIME ZONE and INTERVAL
+// columns. The layouts follow Oracle's external formats:
+//
+//	TIMESTAMP        century+100, year+100, month, day, hour+1, minute+1,
+//	                 second+1, nanoseconds (4 bytes, big endian)
+//	TIMESTAMP TZ     TIMESTAMP image followed by tz hour+20, tz minute+60;
+//	                 the wall clock fields are in the value's own zone
+//	INTERVAL YM      years+0x80000000 (4 bytes, big endian), months+60
+//	INTERVAL DS      days+0x80000000 (4 bytes, big endian), hours+60,
+//	                 minutes+60, seconds+60, nanoseconds+0x80000000 (4 bytes)
+package oraTime
+
+import (
+	"errors"
+	"fmt"
+	"time"
+)
+
+const (
+	TimestampLen   = 11
+	TimestampTZLen = 13
+	IntervalYMLen  = 5
+	IntervalDSLen  = 11
+)
+
+var ErrInvalidLength = errors.New("oraTime: invalid image length")
+
+const (
+	microsPerSecond = int64(1e6)
+	secondsPerDay   = int64(86400)
+)
+
+// Timestamp holds the decoded fields of a TIMESTAMP image.
+type Timestamp struct {
+	Year   int
+	Month  int
+	Day    int
+	Hour   int
+	Minute int
+	Second int
+	Nanos  int
+	// Offset is the zone offset in minutes, zero for TIMESTAMP images.
+	Offset int
+}
+
+// IntervalYM is an INTERVAL YEAR TO MONTH value.
+type IntervalYM struct {
+	Years  int32
+	Months int32
+}
+
+func (i IntervalYM) String() string {
+	if i.Years < 0 || i.Months < 0 {
+		return fmt.Sprintf("-%d-%d", -i.Years, -i.Months)
+	}
+	return fmt.Sprintf("+%d-%d", i.Years, i.Months)
+}
+
+// IntervalDS is an INTERVAL DAY TO SECOND value. Days are kept apart from
+// the sub-day part because Oracle allows ranges beyond time.Duration.
+type IntervalDS struct {
+	Days  int32
+	Nanos int64
+}
+
+// Duration converts the interval, saturating on overflow.
+func (i IntervalDS) Duration() time.Duration {
+	const maxDays = int64(1<<63-1) / int64(24*time.Hour)
+	d := int64(i.Days)
+	if d > maxDays {
+		return time.Duration(1<<63 - 1)
+	}
+	if d < -maxDays {
+		return time.Duration(-1 << 63)
+	}
+	return time.Duration(d)*24*time.Hour + time.Duration(i.Nanos)
+}
+
+func (i IntervalDS) String() string {
+	return i.Duration().String()
+}
+
+// ParseTimestamp splits a TIMESTAMP or TIMESTAMP TZ image into its fields.
+func ParseTimestamp(b []byte) (Timestamp, error) {
+	if len(b) != TimestampLen && len(b) != TimestampTZLen {
+		return Timestamp{}, ErrInvalidLength
+	}
+	ts := Timestamp{
+		Year:   (int(b[0])-100)*100 + int(b[1]) - 100,
+		Month:  int(b[2]),
+		Day:    int(b[3]),
+		Hour:   int(b[4]) - 1,
+		Minute: int(b[5]) - 1,
+		Second: int(b[6]) - 1,
+		Nanos:  int(be32(b[7:])),
+	}
+	if len(b) == TimestampTZLen {
+		ts.Offset = (int(b[11])-20)*60 + int(b[12]) - 60
+	}
+	return ts, nil
+}
+
+// DecodeTimestamp decodes a TIMESTAMP image as a wall clock time in loc.
+func DecodeTimestamp(b []byte, loc *time.Location) (time.Time, error) {
+	ts, err := ParseTimestamp(b)
+	if err != nil {
+		return time.Time{}, err
+	}
+	return time.Date(ts.Year, time.Month(ts.Month), ts.Day, ts.Hour, ts.Minute, ts.Second, ts.Nanos, loc), nil
+}
+
+// DecodeTimestampTZ decodes a TIMESTAMP TZ image into a time in a cached
+// fixed zone for its offset.
+func DecodeTimestampTZ(b []byte) (time.Time, error) {
+	ts, err := ParseTimestamp(b)
+	if err != nil {
+		return time.Time{}, err
+	}
+	return ts.Time(), nil
+}
+
+// Time converts the fields to a time.Time in the cached zone of Offset.
+func (ts Timestamp) Time() time.Time {
+	sec := ts.wallSeconds() - int64(ts.Offset)*60
+	return time.Unix(sec, int64(ts.Nanos)).In(FixedZone(ts.Offset))
+}
+
+// UnixMicros returns microseconds since the Unix epoch. For TIMESTAMP images
+// (Offset zero) the wall clock is taken as UTC.
+func (ts Timestamp) UnixMicros() int64 {
+	sec := ts.wallSeconds() - int64(ts.Offset)*60
+	return sec*microsPerSecond + int64(ts.Nanos/1000)
+}
+
+func (ts Timestamp) wallSeconds() int64 {
+	return daysFromCivil(ts.Year, ts.Month, ts.Day)*secondsPerDay +
+		int64(ts.Hour*3600+ts.Minute*60+ts.Second)
+}
+
+// TimestampMicros is the allocation free fast path: it returns microseconds
+// since the Unix epoch without building a time.Time.
+func TimestampMicros(b []byte) (int64, error) {
+	ts, err := ParseTimestamp(b)
+	if err != nil {
+		return 0, err
+	}
+	return ts.UnixMicros(), nil
+}
+
+// DateMicros converts DATE fields to microseconds since the Unix epoch,
+// taking the wall clock as UTC.
+func DateMicros(year, month, day, hour, minute, second int) int64 {
+	sec := daysFromCivil(year, month, day)*secondsPerDay + int64(hour*3600+minute*60+second)
+	return sec * microsPerSecond
+}
+
+// DecodeIntervalYM decodes an INTERVAL YEAR TO MONTH image.
+func DecodeIntervalYM(b []byte) (IntervalYM, error) {
+	if len(b) != IntervalYMLen {
+		return IntervalYM{}, ErrInvalidLength
+	}
+	return IntervalYM{
+		Years:  int32(be32(b) - 0x80000000),
+		Months: int32(b[4]) - 60,
+	}, nil
+}
+
+// DecodeIntervalDS decodes an INTERVAL DAY TO SECOND image.
+func DecodeIntervalDS(b []byte) (IntervalDS, error) {
+	if len(b) != IntervalDSLen {
+		return IntervalDS{}, ErrInvalidLength
+	}
+	h := int64(b[4]) - 60
+	m := int64(b[5]) - 60
+	s := int64(b[6]) - 60
+	ns := int64(int32(be32(b[7:]) - 0x80000000))
+	return IntervalDS{
+		Days:  int32(be32(b) - 0x80000000),
+		Nanos: ((h*60+m)*60+s)*int64(time.Second) + ns,
+	}, nil
+}
+
+func be32(b []byte) uint32 {
+	return uint32(b[0])<<24 | uint32(b[1])<<16 | uint32(b[2])<<8 | uint32(b[3])
+}
+
+// daysFromCivil returns the number of days since 1970-01-01 of a proleptic
+// Gregorian date (Howard Hinnant's algorithm).
+func daysFromCivil(y, m, d int) int64 {
+	if m <= 2 {
+		y--
+	}
+	era := y
+	if era < 0 {
+		era -= 399
+	}
+	era /= 400
+	yoe := y - era*400
+	mp := (m + 9) % 12
+	doy := (153*mp+2)/5 + d - 1
+	doe := yoe*365 + yoe/4 - yoe/100 + doy
+	return int64(era)*146097 + int64(doe) - 719468
+}
@@ -0,0 +1,86 @@
+package oraTime
+
+import (
+	"testing"
+	"time"
+)
+
+func timestampImage(t time.Time, offset int) []byte {
+	b := []byte{
+		byte(t.Year()/100 + 100), byte(t.Year()%100 + 100),
+		byte(t.Month()), byte(t.Day()),
+		byte(t.Hour() + 1), byte(t.Minute() + 1), byte(t.Second() + 1),
+		byte(t.Nanosecond() >> 24), byte(t.Nanosecond() >> 16), byte(t.Nanosecond() >> 8), byte(t.Nanosecond()),
+	}
+	if offset != 0 {
+		b = append(b, byte(offset/60+20), byte(offset%60+60))
+	}
+	return b
+}
+
+func TestDecodeTimestamp(t *testing.T) {
+	want := time.Date(2021, 7, 9, 13, 4, 59, 123456789, time.UTC)
+	got, err := DecodeTimestamp(timestampImage(want, 0), time.UTC)
+	if err != nil || !got.Equal(want) {
+		t.Fatalf("got %v %v, want %v", got, err, want)
+	}
+	micros, _ := TimestampMicros(timestampImage(want, 0))
+	if micros != want.UnixNano()/1000 {
+		t.Fatalf("micros %d, want %d", micros, want.UnixNano()/1000)
+	}
+}
+
+func TestDecodeTimestampTZ(t *testing.T) {
+	zone := time.FixedZone("", 8*3600+30*60)
+	want := time.Date(1999, 12, 31, 23, 59, 1, 5000, zone)
+	got, err := DecodeTimestampTZ(timestampImage(want, 8*60+30))
+	if err != nil || !got.Equal(want) {
+		t.Fatalf("got %v %v, want %v", got, err, want)
+	}
+	if _, off := got.Zone(); off != 8*3600+30*60 {
+		t.Fatalf("offset %d", off)
+	}
+	if got.Location() != FixedZone(8*60+30) {
+		t.Fatal("zone not cached")
+	}
+	micros, _ := TimestampMicros(timestampImage(want, 8*60+30))
+	if micros != want.UnixNano()/1000 {
+		t.Fatalf("micros %d, want %d", micros, want.UnixNano()/1000)
+	}
+	neg := time.Date(2000, 1, 1, 0, 0, 0, 0, time.FixedZone("", -5*3600))
+	got, _ = DecodeTimestampTZ(timestampImage(neg, -5*60))
+	if !got.Equal(neg) {
+		t.Fatalf("got %v, want %v", got, neg)
+	}
+}
+
+func TestDateMicros(t *testing.T) {
+	for _, d := range []time.Time{
+		time.Date(1, 1, 1, 0, 0, 0, 0, time.UTC),
+		time.Date(1969, 12, 31, 23, 59, 59, 0, time.UTC),
+		time.Date(2400, 2, 29, 12, 0, 0, 0, time.UTC),
+	} {
+		got := DateMicros(d.Year(), int(d.Month()), d.Day(), d.Hour(), d.Minute(), d.Second())
+		if want := d.Unix() * 1e6; got != want {
+			t.Fatalf("%v: got %d, want %d", d, got, want)
+		}
+	}
+}
+
+func TestDecodeInterval(t *testing.T) {
+	ym, err := DecodeIntervalYM([]byte{0x7f, 0xff, 0xff, 0xfe, 60 - 3})
+	if err != nil || ym.Years != -2 || ym.Months != -3 || ym.String() != "-2-3" {
+		t.Fatalf("got %+v %v", ym, err)
+	}
+	ds, err := DecodeIntervalDS([]byte{0x80, 0, 0, 1, 60 + 2, 60 + 3, 60 + 4, 0x80, 0, 0x01, 0xf4})
+	if err != nil {
+		t.Fatal(err)
+	}
+	want := 24*time.Hour + 2*time.Hour + 3*time.Minute + 4*time.Second + 500*time.Nanosecond
+	if ds.Duration() != want {
+		t.Fatalf("got %v, want %v", ds.Duration(), want)
+	}
+	if _, err := DecodeIntervalDS([]byte{1}); err != ErrInvalidLength {
+		t.Fatal("expected length error")
+	}
+}
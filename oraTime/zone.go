@@ -0,0 +1,53 @@
+package oraTime
+
+import (
+	"fmt"
+	"sync"
+	"time"
+)
+
+// Offsets in whole quarter hours between -15:00 and +15:00 cover every zone
+// in use and are built once; anything else is created on demand.
+const (
+	quarterMin = -15 * 4
+	quarterMax = 15 * 4
+)
+
+var (
+	quarterZones [quarterMax - quarterMin + 1]*time.Location
+	otherZones   sync.Map
+)
+
+func init() {
+	for q := quarterMin; q <= quarterMax; q++ {
+		quarterZones[q-quarterMin] = newFixedZone(q * 15)
+	}
+}
+
+// FixedZone returns a shared fixed zone for an offset in minutes.
+func FixedZone(offsetMinutes int) *time.Location {
+	if offsetMinutes%15 == 0 {
+		q := offsetMinutes / 15
+		if q >= quarterMin && q <= quarterMax {
+			return quarterZones[q-quarterMin]
+		}
+	}
+	if loc, ok := otherZones.Load(offsetMinutes); ok {
+		return loc.(*time.Location)
+	}
+	loc, _ := otherZones.LoadOrStore(offsetMinutes, newFixedZone(offsetMinutes))
+	return loc.(*time.Location)
+}
+
+func newFixedZone(offsetMinutes int) *time.Location {
+	if offsetMinutes == 0 {
+		return time.UTC
+	}
+	sign := byte('+')
+	m := offsetMinutes
+	if m < 0 {
+		sign = '-'
+		m = -m
+	}
+	return time.FixedZone(fmt.Sprintf("%c%02d:%02d", sign, m/60, m%60), offsetMinutes*60)
+}
@@ -0,0 +1,147 @@
+package goxstream
+
+import (
+	"context"
+	"sync/atomic"
+
+	"github.com/yjhatfdu/goxstream/rowkey"
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// RecordSource is a stream of messages, such as an XStreamConn or a
+// SupervisedConn.
+type RecordSource interface {
+	GetRecordContext(ctx context.Context) (Message, error)
+}
+
+// Partitioned fans a stream out to n shards. Row changes go to the shard
+// picked by the XXH64 hash of their row key, so that all changes of a row
+// reach the same shard in order; commits and heartbeats go to every shard,
+// so each shard sees the transaction boundaries. Open the connection
+// WithRowKeys: rows without a key are routed by table instead.
+//
+// An update that changes the key is routed by its old key, and later
+// changes of the row by the new one, so they may be applied out of order
+// on different shards.
+type Partitioned struct {
+	shards  []chan Message
+	acked   []uint64
+	cancel  context.CancelFunc
+	done    chan struct{}
+	err     error
+	scratch []byte
+}
+
+// Partition starts reading src into n channels buffering up to size
+// messages each. A full channel holds back every shard, so shards should
+// keep up with each other. src must not be read elsewhere until the
+// channels are closed, after an error or Stop.
+func Partition(ctx context.Context, src RecordSource, n, size int) *Partitioned {
+	if n < 1 {
+		n = 1
+	}
+	ctx, cancel := context.WithCancel(ctx)
+	p := &Partitioned{
+		shards: make([]chan Message, n),
+		acked:  make([]uint64, n),
+		cancel: cancel,
+		done:   make(chan struct{}),
+	}
+	for i := range p.shards {
+		p.shards[i] = make(chan Message, size)
+	}
+	go p.loop(ctx, src)
+	return p
+}
+
+func (p *Partitioned) loop(ctx context.Context, src RecordSource) {
+	defer func() {
+		for _, c := range p.shards {
+			close(c)
+		}
+		close(p.done)
+	}()
+	for {
+		msg, err := src.GetRecordContext(ctx)
+		if err != nil {
+			p.err = err
+			return
+		}
+		switch m := msg.(type) {
+		case *Insert:
+			p.send(ctx, p.shard(m.Owner, m.Table, m.Key), m)
+		case *Update:
+			p.send(ctx, p.shard(m.Owner, m.Table, m.Key), m)
+		case *Delete:
+			p.send(ctx, p.shard(m.Owner, m.Table, m.Key), m)
+		default:
+			p.broadcast(ctx, m)
+		}
+		if ctx.Err() != nil {
+			p.err = ctx.Err()
+			return
+		}
+	}
+}
+
+// shard hashes the key, or owner.table for rows without one.
+func (p *Partitioned) shard(owner, table string, key []byte) int {
+	if key == nil {
+		p.scratch = append(append(append(p.scratch[:0], owner...), '.'), table...)
+		key = p.scratch
+	}
+	return rowkey.Shard(rowkey.Hash(key), len(p.shards))
+}
+
+func (p *Partitioned) send(ctx context.Context, i int, msg Message) {
+	select {
+	case p.shards[i] <- msg:
+	case <-ctx.Done():
+	}
+}
+
+func (p *Partitioned) broadcast(ctx context.Context, msg Message) {
+	for i := range p.shards {
+		p.send(ctx, i, msg)
+	}
+}
+
+// Shards returns the number of shards.
+func (p *Partitioned) Shards() int {
+	return len(p.shards)
+}
+
+// Shard returns the channel of shard i, closed when the stream ends.
+func (p *Partitioned) Shard(i int) <-chan Message {
+	return p.shards[i]
+}
+
+// Done records that shard i has processed everything up to and including
+// the commit or heartbeat at s.
+func (p *Partitioned) Done(i int, s scn.SCN) {
+	atomic.StoreUint64(&p.acked[i], uint64(s))
+}
+
+// LWM returns the SCN every shard is done with, to be passed to SetSCNLwm.
+func (p *Partitioned) LWM() scn.SCN {
+	lwm := atomic.LoadUint64(&p.acked[0])
+	for i := range p.acked[1:] {
+		if s := atomic.LoadUint64(&p.acked[i+1]); s < lwm {
+			lwm = s
+		}
+	}
+	return scn.SCN(lwm)
+}
+
+// Stop stops reading; the channels are closed once the pending read
+// returns.
+func (p *Partitioned) Stop() {
+	p.cancel()
+}
+
+// Wait waits until the channels are closed and returns the error that
+// ended the stream, the context's error after Stop.
+func (p *Partitioned) Wait() error {
+	<-p.done
+	return p.err
+}
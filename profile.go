@@ -0,0 +1,84 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"context"
+	"runtime/pprof"
+	"sync/atomic"
+	"time"
+)
+
+// ProfileCounter is the number of calls of one C-side hot-path step and
+// the time spent in them.
+type ProfileCounter struct {
+	Calls uint64
+	Time  time.Duration
+}
+
+// OCIProfile breaks down the time spent inside cgo calls, which Go's
+// profiler only sees as runtime.cgocall. It is collected by connections
+// opened WithOCIProfiling.
+type OCIProfile struct {
+	// Receive is OCIXStreamOutLCRReceive: waiting for the network and the
+	// outbound server.
+	Receive ProfileCounter
+	// ColumnInfo is OCILCRRowColumnInfoGet: OCI unpacking row images.
+	ColumnInfo ProfileCounter
+	// Copy is copying column names and staging values in the arena,
+	// including datetime, interval and rowid conversions.
+	Copy ProfileCounter
+	// Chunk is OCIXStreamOutChunkReceive for LOB and LONG columns.
+	Chunk ProfileCounter
+}
+
+// OCIProfile reads the C-side timers. They are updated while the
+// connection receives, so read them from another goroutine only for
+// monitoring.
+func (x *XStreamConn) OCIProfile() OCIProfile {
+	p := &x.ocip.prof
+	counter := func(i int) ProfileCounter {
+		return ProfileCounter{
+			Calls: atomic.LoadUint64((*uint64)(&p.calls[i])),
+			Time:  time.Duration(atomic.LoadUint64((*uint64)(&p.nanos[i]))),
+		}
+	}
+	return OCIProfile{
+		Receive:    counter(C.OCI_PROF_RECEIVE),
+		ColumnInfo: counter(C.OCI_PROF_COLUMN_INFO),
+		Copy:       counter(C.OCI_PROF_COPY),
+		Chunk:      counter(C.OCI_PROF_CHUNK),
+	}
+}
+
+func enableProfiling(oci *C.struct_oci) {
+	oci.prof.enabled = 1
+}
+
+var noLabels = func() {}
+
+// labelTable sets the owner and table pprof labels on the decoding
+// goroutine when profiling, so that CPU profiles can be split by table.
+// The returned function removes them again.
+func (x *XStreamConn) labelTable(owner, table string) func() {
+	if !x.opts.profile {
+		return noLabels
+	}
+	key := tableKey{owner, table}
+	ctx, ok := x.labels[key]
+	if !ok {
+		if x.labels == nil {
+			x.labels = map[tableKey]context.Context{}
+		}
+		ctx = pprof.WithLabels(context.Background(), pprof.Labels("owner", owner, "table", table))
+		x.labels[key] = ctx
+	}
+	pprof.SetGoroutineLabels(ctx)
+	return x.unlabel
+}
+
+func (x *XStreamConn) unlabel() {
+	pprof.SetGoroutineLabels(context.Background())
+}
@@ -0,0 +1,134 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"runtime"
+	"sync/atomic"
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// RelayStats reports the progress of a Relay. The counters are updated
+// once per receive batch.
+type RelayStats struct {
+	// LCRs and Chunks count what was forwarded, ChunkBytes the LOB and
+	// LONG bytes in the chunks.
+	LCRs       uint64
+	Chunks     uint64
+	ChunkBytes uint64
+	// Batches counts the receive batches, each followed by a flush of the
+	// inbound server; Pings the commit LCRs sent to carry the fetch low
+	// watermark while the outbound server was idle.
+	Batches uint64
+	Pings   uint64
+	// LWM is the processed low watermark of the inbound server, last
+	// passed back to the outbound server.
+	LWM scn.SCN
+}
+
+// Relay forwards LCRs from an outbound server to an inbound server
+// without decoding them: each receive batch is relayed by a C loop of
+// receive, send, chunk and low watermark calls on a thread of its own.
+type Relay struct {
+	out   *XStreamConn
+	in    *XStreamInConn
+	st    *C.relay_t
+	done  chan struct{}
+	err   error
+	final RelayStats
+}
+
+// StartRelay starts relaying from out to in. Neither connection may be
+// used until Wait returns. To resume where the inbound server left off,
+// open out WithResumePosition(in.AttachPosition()).
+func StartRelay(out *XStreamConn, in *XStreamInConn) (*Relay, error) {
+	in.mu.Lock()
+	err := in.flush(false)
+	in.mu.Unlock()
+	if err != nil {
+		return nil, err
+	}
+	r := &Relay{
+		out:  out,
+		in:   in,
+		st:   new(C.relay_t),
+		done: make(chan struct{}),
+	}
+	go r.loop()
+	return r, nil
+}
+
+// loop relays a batch at a time, holding in.mu only for the batch.
+func (r *Relay) loop() {
+	defer close(r.done)
+	if r.out.thread == nil {
+		runtime.LockOSThread()
+		defer runtime.UnlockOSThread()
+	}
+	var status C.sword
+	relay := func() { status = C.relay_lcrs(r.in.ocip, r.out.ocip, r.st) }
+	for atomic.LoadInt32((*int32)(unsafe.Pointer(&r.st.stop))) == 0 {
+		r.in.mu.Lock()
+		if r.out.thread != nil {
+			r.out.thread.do(relay)
+		} else {
+			relay()
+		}
+		r.in.mu.Unlock()
+		if status != C.OCI_SUCCESS {
+			if r.st.xout_failed != 0 {
+				r.err = ociError("relay from outbound server", r.out.ocip.errp)
+			} else {
+				r.err = ociError("relay to inbound server", r.in.ocip.errp)
+			}
+			break
+		}
+	}
+	r.final = r.snapshot()
+}
+
+// Stop ends the relay. For an outbound connection opened WithRuntime, it
+// breaks the receive call waiting on the outbound server; otherwise the
+// batch in progress ends after the LCR being forwarded, or when the
+// receive call returns.
+func (r *Relay) Stop() {
+	brk := C.int(0)
+	if r.out.thread != nil {
+		brk = 1
+	}
+	C.relay_stop(r.out.ocip, r.st, brk)
+}
+
+// Wait waits for the relay to end and returns the error that ended it,
+// or nil after Stop.
+func (r *Relay) Wait() error {
+	<-r.done
+	return r.err
+}
+
+// Stats returns the progress of the relay.
+func (r *Relay) Stats() RelayStats {
+	select {
+	case <-r.done:
+		return r.final
+	default:
+		return r.snapshot()
+	}
+}
+
+func (r *Relay) snapshot() RelayStats {
+	var s C.relay_t
+	C.relay_snapshot(r.st, &s)
+	return RelayStats{
+		LCRs:       uint64(s.lcrs),
+		Chunks:     uint64(s.chunks),
+		ChunkBytes: uint64(s.chunk_bytes),
+		Batches:    uint64(s.batches),
+		Pings:      uint64(s.pings),
+		LWM:        scn.SCN(s.lwm_scn),
+	}
+}
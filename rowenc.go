@@ -0,0 +1,102 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"unsafe"
+
+	"github.com/yjhatfdu/goxstream/charset"
+	"github.com/yjhatfdu/goxstream/jsonenc"
+)
+
+// eventSlab is the size of the buffers encoded events are appended to.
+// Events of many messages share a buffer; a new one is started once it is
+// nearly full, and the old one is freed by the GC with the last message
+// pointing into it.
+const eventSlab = 64 << 10
+
+// slab returns buf, or a new buffer if buf is nearly full.
+func slab(buf []byte) []byte {
+	if len(buf) > eventSlab-eventSlab/8 {
+		return make([]byte, 0, eventSlab)
+	}
+	return buf
+}
+
+// encodeRow passes the columns of an old or new row image straight from
+// their raw values to the JSON and Avro writers, instead of converting
+// them to Go values. Key columns are passed to the key cache as in
+// getLcrRowData.
+func (x *XStreamConn) encodeRow(ocip *C.struct_oci, row *C.oci_lcr_row_t, n C.ub2, vt valueType, csid int, key *keyDef) error {
+	image := 1
+	if vt == valueTypeOld {
+		image = 0
+	}
+	if w := x.json; w != nil {
+		if image == 0 {
+			w.buf = jsonenc.Before(w.buf)
+		} else {
+			w.buf = jsonenc.After(w.buf)
+		}
+	}
+	if x.avro != nil {
+		x.avro.has[image] = true
+	}
+	for i := 0; i < int(n); i++ {
+		var name *C.char
+		var nameLen, valueLen, valueCsid, dtype C.ub2
+		var value unsafe.Pointer
+		if C.iterate_row_data(ocip, row, C.ub2(i), &name, &nameLen, &value, &valueLen, &valueCsid, &dtype) != C.OCI_SUCCESS {
+			return ociError("iterate_row_data", ocip.errp)
+		}
+		nameBytes := byteView(unsafe.Pointer(name), nameLen)
+		if key != nil {
+			if k, ok := key.index[string(nameBytes)]; ok {
+				if err := x.keys.set(k, value, valueLen, dtype); err != nil {
+					return err
+				}
+			}
+		}
+		x.metrics.addRowBytes(int(valueLen))
+		cs := int(valueCsid)
+		if cs == 0 {
+			cs = csid
+		}
+		if w := x.json; w != nil {
+			w.buf = w.table.Column(w.buf, nameBytes)
+			var err error
+			if w.buf, err = x.appendJSONValue(w.buf, value, valueLen, cs, dtype); err != nil {
+				return err
+			}
+		}
+		if x.avro != nil {
+			x.avro.column(image, nameBytes, avroValue{value, valueLen, dtype, cs})
+		}
+	}
+	if w := x.json; w != nil {
+		w.buf = jsonenc.End(w.buf)
+	}
+	return nil
+}
+
+// utf8Text returns CHAR text in csid as UTF-8: raw itself when it already
+// is, else converted into *scratch. WithTrustedEncoding only skips the
+// validation of UTF-8 text; text in other charsets is always converted.
+func (x *XStreamConn) utf8Text(raw []byte, csid int, scratch *[]byte) ([]byte, error) {
+	if (csid == charset.AL32UTF8 || csid == charset.UTF8) &&
+		(csid == x.csid && x.opts.trustText || charset.ValidUTF8(raw)) {
+		return raw, nil
+	}
+	dec := x.dec
+	if csid != x.csid {
+		var err error
+		if dec, err = charset.Lookup(csid); err != nil {
+			return nil, err
+		}
+	}
+	text, err := dec.Decode((*scratch)[:0], raw)
+	*scratch = text
+	return text, err
+}
@@ -0,0 +1,48 @@
+package goxstream
+
+import (
+	"testing"
+	"unicode/utf8"
+
+	"github.com/yjhatfdu/goxstream/charset"
+)
+
+func TestUTF8TextTrustedEncoding(t *testing.T) {
+	for _, c := range []struct {
+		csid     int
+		raw      string
+		want     string
+		trust    bool
+		passthru bool
+	}{
+		{charset.WE8MSWIN1252, "caf\xe9", "café", true, false},
+		{charset.WE8MSWIN1252, "caf\xe9", "café", false, false},
+		{charset.AL32UTF8, "café", "café", true, true},
+		// trusted text is not validated, invalid bytes pass unchanged
+		{charset.AL32UTF8, "caf\xe9", "caf\xe9", true, true},
+	} {
+		dec, err := charset.Lookup(c.csid)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if c.trust && c.passthru {
+			dec = charset.Passthrough()
+		}
+		x := &XStreamConn{csid: c.csid, dec: dec, opts: &options{trustText: c.trust}}
+		var scratch []byte
+		raw := []byte(c.raw)
+		got, err := x.utf8Text(raw, c.csid, &scratch)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if string(got) != c.want {
+			t.Errorf("csid %d, trusted %v: %q, want %q", c.csid, c.trust, got, c.want)
+		}
+		if c.csid != charset.AL32UTF8 && !utf8.Valid(got) {
+			t.Errorf("csid %d, trusted %v: invalid UTF-8 %q", c.csid, c.trust, got)
+		}
+		if c.passthru && len(got) > 0 && &got[0] != &raw[0] {
+			t.Errorf("csid %d, trusted %v: text copied", c.csid, c.trust)
+		}
+	}
+}
@@ -0,0 +1,126 @@
+// Package rowkey builds binary row keys that compare with bytes.Compare in
+// the order of the column values they encode (memcomparable keys), from the
+// raw column images of an LCR.
+//
+// A key is the concatenation of its columns. Each column starts with a
+// marker, present or NULL (NULLs sort last, as in Oracle), followed by the
+// value. Variable length values are escaped (0x00 becomes 0x00 0xff) and
+// terminated by 0x00 0x01, so that a value sorts before its extensions;
+// fixed length values are written big endian with the sign flipped.
+package rowkey
+
+import (
+	"errors"
+	"math"
+
+	"github.com/yjhatfdu/goxstream/oraTime"
+)
+
+const (
+	markValue = 0x01
+	markNull  = 0x02
+)
+
+// AppendNull appends a NULL column.
+func AppendNull(b []byte) []byte {
+	return append(b, markNull)
+}
+
+// AppendBytes appends a RAW, or text compared in binary, column.
+func AppendBytes(b, v []byte) []byte {
+	b = append(b, markValue)
+	for _, c := range v {
+		if c == 0 {
+			b = append(b, 0, 0xff)
+		} else {
+			b = append(b, c)
+		}
+	}
+	return append(b, 0, 1)
+}
+
+// AppendString is AppendBytes for a string.
+func AppendString(b []byte, v string) []byte {
+	b = append(b, markValue)
+	for i := 0; i < len(v); i++ {
+		if v[i] == 0 {
+			b = append(b, 0, 0xff)
+		} else {
+			b = append(b, v[i])
+		}
+	}
+	return append(b, 0, 1)
+}
+
+// ErrNumber is returned for a malformed NUMBER image.
+var ErrNumber = errors.New("rowkey: malformed NUMBER")
+
+// AppendNumber appends a NUMBER from its OCINumber image: a length byte
+// followed by Oracle's internal representation, which already compares
+// bytewise in numeric order.
+func AppendNumber(b, num []byte) ([]byte, error) {
+	if len(num) == 0 || int(num[0]) >= len(num) {
+		return b, ErrNumber
+	}
+	return AppendBytes(b, num[1:1+num[0]]), nil
+}
+
+// AppendInt appends a signed integer.
+func AppendInt(b []byte, v int64) []byte {
+	return appendUint64(append(b, markValue), uint64(v)^(1<<63))
+}
+
+// AppendUint appends an unsigned integer.
+func AppendUint(b []byte, v uint64) []byte {
+	return appendUint64(append(b, markValue), v)
+}
+
+// AppendFloat appends a BINARY_FLOAT or BINARY_DOUBLE value. Negative
+// numbers have all bits flipped and positive ones only the sign bit, so
+// the IEEE images sort numerically.
+func AppendFloat(b []byte, v float64) []byte {
+	u := math.Float64bits(v)
+	if v == 0 {
+		u = 0 // -0 == 0
+	}
+	if u&(1<<63) != 0 {
+		u = ^u
+	} else {
+		u |= 1 << 63
+	}
+	return appendUint64(append(b, markValue), u)
+}
+
+// AppendDate appends a DATE in Oracle's 7 byte internal form (century and
+// year in excess 100, month, day, hour, minute and second in excess 1).
+func AppendDate(b []byte, year, month, day, hour, minute, second int) []byte {
+	return append(b, markValue,
+		byte(year/100+100), byte(year%100+100), byte(month), byte(day),
+		byte(hour+1), byte(minute+1), byte(second+1))
+}
+
+// AppendTimestamp appends a TIMESTAMP from the 11 byte image the
+// connection stages (see package oraTime), which compares bytewise.
+func AppendTimestamp(b, ts []byte) ([]byte, error) {
+	if len(ts) != oraTime.TimestampLen {
+		return b, oraTime.ErrInvalidLength
+	}
+	return append(append(b, markValue), ts...), nil
+}
+
+// AppendTimestampTZ appends a TIMESTAMP WITH (LOCAL) TIME ZONE from its 13
+// byte image, normalised to UTC so that equal instants give equal keys.
+func AppendTimestampTZ(b, ts []byte) ([]byte, error) {
+	t, err := oraTime.DecodeTimestampTZ(ts)
+	if err != nil {
+		return b, err
+	}
+	b = appendUint64(append(b, markValue), uint64(t.Unix())^(1<<63))
+	n := uint32(t.Nanosecond())
+	return append(b, byte(n>>24), byte(n>>16), byte(n>>8), byte(n)), nil
+}
+
+func appendUint64(b []byte, v uint64) []byte {
+	return append(b, byte(v>>56), byte(v>>48), byte(v>>40), byte(v>>32),
+		byte(v>>24), byte(v>>16), byte(v>>8), byte(v))
+}
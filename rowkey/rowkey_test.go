@@ -0,0 +1,143 @@
+package rowkey
+
+import (
+	"bytes"
+	"math"
+	"sort"
+	"testing"
+)
+
+func sorted(t *testing.T, keys [][]byte) {
+	t.Helper()
+	for i := 1; i < len(keys); i++ {
+		if bytes.Compare(keys[i-1], keys[i]) >= 0 {
+			t.Fatalf("key %d (%x) does not sort before key %d (%x)", i-1, keys[i-1], i, keys[i])
+		}
+	}
+}
+
+func TestBytesOrder(t *testing.T) {
+	vals := []string{"", "\x00", "\x00\x00", "\x00\x01", "a", "a\x00", "a\x00b", "ab", "b"}
+	var keys [][]byte
+	for _, v := range vals {
+		keys = append(keys, AppendString(nil, v))
+	}
+	sorted(t, keys)
+	keys = append(keys, AppendNull(nil))
+	sorted(t, keys)
+}
+
+func TestCompositeOrder(t *testing.T) {
+	// (a, x) < (a\x00, "") must hold although a is a prefix of a\x00
+	k1 := AppendString(AppendString(nil, "a"), "x")
+	k2 := AppendString(AppendString(nil, "a\x00"), "")
+	sorted(t, [][]byte{k1, k2})
+}
+
+func TestIntOrder(t *testing.T) {
+	vals := []int64{math.MinInt64, -1 << 40, -2, -1, 0, 1, 2, 1 << 40, math.MaxInt64}
+	var keys [][]byte
+	for _, v := range vals {
+		keys = append(keys, AppendInt(nil, v))
+	}
+	sorted(t, keys)
+}
+
+func TestFloatOrder(t *testing.T) {
+	vals := []float64{math.Inf(-1), -1e300, -1.5, -1, -1e-300, 0, 1e-300, 1, 1.5, 1e300, math.Inf(1)}
+	var keys [][]byte
+	for _, v := range vals {
+		keys = append(keys, AppendFloat(nil, v))
+	}
+	sorted(t, keys)
+	if !bytes.Equal(AppendFloat(nil, math.Copysign(0, -1)), AppendFloat(nil, 0)) {
+		t.Error("-0 and 0 encode differently")
+	}
+}
+
+func TestNumberOrder(t *testing.T) {
+	// OCINumber images of -101, -100, -10, -2, -1.5, -1, 0, 1, 1.5, 2, 10,
+	// 99, 100 and 101
+	images := [][]byte{
+		{4, 0x3d, 0x64, 0x64, 0x66},
+		{3, 0x3d, 0x64, 0x66},
+		{3, 0x3e, 0x5b, 0x66},
+		{3, 0x3e, 0x63, 0x66},
+		{4, 0x3e, 0x64, 0x33, 0x66},
+		{3, 0x3e, 0x64, 0x66},
+		{1, 0x80},
+		{2, 0xc1, 0x02},
+		{3, 0xc1, 0x02, 0x33},
+		{2, 0xc1, 0x03},
+		{2, 0xc1, 0x0b},
+		{2, 0xc1, 0x64},
+		{2, 0xc2, 0x02},
+		{3, 0xc2, 0x02, 0x02},
+	}
+	var keys [][]byte
+	for _, n := range images {
+		k, err := AppendNumber(nil, n)
+		if err != nil {
+			t.Fatal(err)
+		}
+		keys = append(keys, k)
+	}
+	sorted(t, keys)
+	if _, err := AppendNumber(nil, []byte{5, 1}); err != ErrNumber {
+		t.Errorf("short image: %v", err)
+	}
+}
+
+func TestDateOrder(t *testing.T) {
+	keys := [][]byte{
+		AppendDate(nil, 1899, 12, 31, 23, 59, 59),
+		AppendDate(nil, 1900, 1, 1, 0, 0, 0),
+		AppendDate(nil, 2024, 2, 29, 12, 0, 0),
+		AppendDate(nil, 2024, 2, 29, 12, 0, 1),
+	}
+	sorted(t, keys)
+}
+
+func TestTimestampTZ(t *testing.T) {
+	// 2024-01-01 10:00 +02:00 and 08:00 +00:00 are the same instant
+	a := []byte{120, 124, 1, 1, 11, 1, 1, 0, 0, 0, 0, 22, 60}
+	b := []byte{120, 124, 1, 1, 9, 1, 1, 0, 0, 0, 0, 20, 60}
+	c := []byte{120, 124, 1, 1, 9, 1, 1, 0, 0, 0, 1, 20, 60}
+	ka, err := AppendTimestampTZ(nil, a)
+	if err != nil {
+		t.Fatal(err)
+	}
+	kb, _ := AppendTimestampTZ(nil, b)
+	kc, _ := AppendTimestampTZ(nil, c)
+	if !bytes.Equal(ka, kb) {
+		t.Errorf("equal instants: %x != %x", ka, kb)
+	}
+	sorted(t, [][]byte{kb, kc})
+	if _, err := AppendTimestamp(nil, a); err == nil {
+		t.Error("TIMESTAMP accepted a 13 byte image")
+	}
+}
+
+func TestSortMatchesValues(t *testing.T) {
+	type row struct {
+		a int64
+		b string
+	}
+	rows := []row{{2, "b"}, {1, "z"}, {2, "a"}, {-5, ""}, {1, "y\x00"}, {1, "y"}}
+	keys := make([][]byte, len(rows))
+	for i, r := range rows {
+		keys[i] = AppendString(AppendInt(nil, r.a), r.b)
+	}
+	sort.Slice(rows, func(i, j int) bool {
+		if rows[i].a != rows[j].a {
+			return rows[i].a < rows[j].a
+		}
+		return rows[i].b < rows[j].b
+	})
+	sort.Slice(keys, func(i, j int) bool { return bytes.Compare(keys[i], keys[j]) < 0 })
+	for i, r := range rows {
+		if want := AppendString(AppendInt(nil, r.a), r.b); !bytes.Equal(keys[i], want) {
+			t.Fatalf("position %d: key of %v expected", i, r)
+		}
+	}
+}
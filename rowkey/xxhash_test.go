@@ -0,0 +1,36 @@
+package rowkey
+
+import "testing"
+
+func TestHash(t *testing.T) {
+	for _, c := range []struct {
+		in   string
+		want uint64
+	}{
+		{"", 0xef46db3751d8e999},
+		{"a", 0xd24ec4f1a98c6e5b},
+		{"abc", 0x44bc2cf5ad770999},
+		{"Nobody inspects the spammish repetition", 0xfbcea83c8a378bf1},
+	} {
+		if got := Hash([]byte(c.in)); got != c.want {
+			t.Errorf("Hash(%q) = %#x, want %#x", c.in, got, c.want)
+		}
+	}
+}
+
+func TestShard(t *testing.T) {
+	counts := make([]int, 7)
+	for i := 0; i < 70000; i++ {
+		k := AppendInt(nil, int64(i))
+		s := Shard(Hash(k), len(counts))
+		if s < 0 || s >= len(counts) {
+			t.Fatalf("shard %d out of range", s)
+		}
+		counts[s]++
+	}
+	for i, c := range counts {
+		if c < 9000 || c > 11000 {
+			t.Errorf("shard %d got %d of 70000 keys", i, c)
+		}
+	}
+}
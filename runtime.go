@@ -0,0 +1,109 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"errors"
+	"fmt"
+	"sync"
+	"unsafe"
+)
+
+// Runtime owns the OCI environments shared by many outbound connections in
+// one process. Environments are created in OCI_THREADED mode, one per pair
+// of database character sets, and every connection opened through the
+// runtime (see WithRuntime) is pinned to its own locked OS thread.
+type Runtime struct {
+	mu     sync.Mutex
+	pooled bool
+	envs   map[[2]C.ub2]*runtimeEnv
+	conns  int
+	closed bool
+}
+
+type runtimeEnv struct {
+	envp *C.OCIEnv
+	pool *C.oci_mem_pool_t
+}
+
+// NewRuntime creates an empty runtime. Of the options only
+// WithPooledAllocator applies; it makes every environment of the runtime
+// allocate through a shared, thread-safe pool.
+func NewRuntime(opts ...Option) *Runtime {
+	o := newOptions(opts)
+	return &Runtime{
+		pooled: o.pooledAlloc,
+		envs:   map[[2]C.ub2]*runtimeEnv{},
+	}
+}
+
+// WithRuntime opens the connection in the shared environment of r instead
+// of creating environments of its own.
+func WithRuntime(r *Runtime) Option {
+	return func(o *options) {
+		o.runtime = r
+	}
+}
+
+// env returns the environment for the given character sets, creating it on
+// first use. Character set ids 0 give the environment used for discovery.
+func (r *Runtime) env(csid, ncsid C.ub2) (*runtimeEnv, error) {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if r.closed {
+		return nil, errors.New("goxstream: runtime closed")
+	}
+	key := [2]C.ub2{csid, ncsid}
+	if e := r.envs[key]; e != nil {
+		return e, nil
+	}
+	e := &runtimeEnv{}
+	if r.pooled {
+		e.pool = C.create_pool()
+	}
+	status := C.create_env(&e.envp, C.OCI_THREADED|C.OCI_OBJECT, csid, ncsid, e.pool)
+	if status != C.OCI_SUCCESS {
+		C.oci_pool_destroy(e.pool)
+		return nil, fmt.Errorf("OCIEnvNlsCreate failed for csid %d/%d, status %d", csid, ncsid, status)
+	}
+	r.envs[key] = e
+	return e, nil
+}
+
+func (r *Runtime) acquire() error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if r.closed {
+		return errors.New("goxstream: runtime closed")
+	}
+	r.conns++
+	return nil
+}
+
+func (r *Runtime) release() {
+	r.mu.Lock()
+	r.conns--
+	r.mu.Unlock()
+}
+
+// Close frees the environments. All connections opened through the runtime
+// must be closed first.
+func (r *Runtime) Close() error {
+	r.mu.Lock()
+	defer r.mu.Unlock()
+	if r.conns > 0 {
+		return fmt.Errorf("goxstream: runtime still has %d open connections", r.conns)
+	}
+	if r.closed {
+		return nil
+	}
+	r.closed = true
+	for key, e := range r.envs {
+		C.OCIHandleFree(unsafe.Pointer(e.envp), C.OCI_HTYPE_ENV)
+		C.oci_pool_destroy(e.pool)
+		delete(r.envs, key)
+	}
+	return nil
+}
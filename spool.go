@@ -0,0 +1,202 @@
+package goxstream
+
+import (
+	"context"
+	"sync/atomic"
+
+	"github.com/yjhatfdu/goxstream/scn"
+	"github.com/yjhatfdu/goxstream/wal"
+)
+
+// AckSource is a stream whose progress is acknowledged upstream, such as
+// an XStreamConn or a SupervisedConn.
+type AckSource interface {
+	RecordSource
+	SetSCNLwm(s scn.SCN) error
+}
+
+// Spool receives a stream into a local write-ahead log (package wal) and
+// acknowledges the processed low watermark as soon as the data is durable
+// there, so the outbound server and Oracle's log retention are not held
+// back by slow consumers. Consumers read the log at their own pace with
+// SpoolReaders and remove what all of them have read with RemoveBefore.
+//
+// On restart, open the log first and the connection
+// WithResumeSCN(log.LastCommit()) (if not zero): the log ends with the
+// last complete transaction, and the outbound server resends from the
+// next one. A source that resumes earlier, such as a SupervisedConn
+// reopened at its last acknowledged SCN, resends transactions that are
+// logged already. So when a spool starts, and whenever its source
+// reconnects, it cuts the log back to the last commit and drops the
+// transactions resent up to there.
+type Spool struct {
+	src        AckSource
+	log        *wal.Log
+	cancel     context.CancelFunc
+	done       chan struct{}
+	err        error
+	acked      uint64
+	buf        []byte
+	reconnects int
+	replay     scn.SCN // resent transactions commit up to it
+}
+
+// reconnector is a source that reopens itself, such as SupervisedConn.
+type reconnector interface {
+	Reconnects() int
+}
+
+// StartSpool starts receiving src into log. src must not be read
+// elsewhere until Wait returns.
+func StartSpool(ctx context.Context, src AckSource, log *wal.Log) *Spool {
+	ctx, cancel := context.WithCancel(ctx)
+	s := &Spool{
+		src:    src,
+		log:    log,
+		cancel: cancel,
+		done:   make(chan struct{}),
+		acked:  uint64(log.LastCommit()),
+	}
+	if r, ok := src.(reconnector); ok {
+		s.reconnects = r.Reconnects()
+	}
+	go s.loop(ctx)
+	return s
+}
+
+func (s *Spool) loop(ctx context.Context) {
+	defer close(s.done)
+	if s.err = s.restart(); s.err != nil {
+		return
+	}
+	for {
+		msg, err := s.src.GetRecordContext(ctx)
+		if err != nil {
+			s.err = err
+			break
+		}
+		if err := s.append(msg); err != nil {
+			s.err = err
+			break
+		}
+		if err := s.ack(); err != nil {
+			s.err = err
+			break
+		}
+	}
+	// acknowledge what the last group commit made durable
+	if err := s.log.Sync(); err == nil {
+		if err := s.ack(); err != nil && s.err == ctx.Err() {
+			s.err = err
+		}
+	}
+}
+
+// restart cuts the part of a transaction that the source sends again
+// from the log, and starts dropping the transactions it resends.
+func (s *Spool) restart() error {
+	s.replay = s.log.LastCommit()
+	return s.log.Rewind()
+}
+
+// append logs a message. Commits and heartbeats end a transaction;
+// heartbeats that do not advance the last commit are not logged.
+func (s *Spool) append(msg Message) error {
+	if r, ok := s.src.(reconnector); ok && r.Reconnects() != s.reconnects {
+		s.reconnects = r.Reconnects()
+		if err := s.restart(); err != nil {
+			return err
+		}
+	}
+	commit := false
+	switch msg.(type) {
+	case *Commit:
+		if msg.Scn() <= s.replay {
+			// resent: drop the rows logged since the last commit
+			return s.log.Rewind()
+		}
+		s.replay = 0
+		commit = true
+	case *HeartBeat:
+		if msg.Scn() <= s.log.LastCommit() {
+			return nil
+		}
+		commit = true
+	}
+	var err error
+	if s.buf, err = AppendMessage(s.buf[:0], msg); err != nil {
+		return err
+	}
+	_, err = s.log.Append(msg.Scn(), s.buf, commit)
+	return err
+}
+
+// ack passes the last durable commit to the source when it has advanced.
+func (s *Spool) ack() error {
+	_, c := s.log.Durable()
+	if uint64(c) <= atomic.LoadUint64(&s.acked) {
+		return nil
+	}
+	if err := s.src.SetSCNLwm(c); err != nil {
+		return err
+	}
+	atomic.StoreUint64(&s.acked, uint64(c))
+	return nil
+}
+
+// Acked returns the last SCN acknowledged to the source.
+func (s *Spool) Acked() scn.SCN {
+	return scn.SCN(atomic.LoadUint64(&s.acked))
+}
+
+// Stop stops receiving once the pending read returns.
+func (s *Spool) Stop() {
+	s.cancel()
+}
+
+// Wait waits until the spool has stopped and returns the error that
+// stopped it, the context's error after Stop.
+func (s *Spool) Wait() error {
+	<-s.done
+	return s.err
+}
+
+// SpoolReader reads the messages of a spool's log. It is a RecordSource,
+// so it can feed Partition.
+type SpoolReader struct {
+	rd *wal.Reader
+}
+
+// NewSpoolReader starts reading log at off: log.Start(), log.Seek(s) to
+// replay the transactions committed after s, or the Offset of a reader
+// saved when it was last stopped.
+func NewSpoolReader(log *wal.Log, off wal.Offset) (*SpoolReader, error) {
+	rd, err := log.NewReader(off)
+	if err != nil {
+		return nil, err
+	}
+	return &SpoolReader{rd: rd}, nil
+}
+
+// GetRecord returns the next message, waiting until one is durable.
+func (r *SpoolReader) GetRecord() (Message, error) {
+	return r.GetRecordContext(context.Background())
+}
+
+// GetRecordContext is GetRecord bounded by ctx.
+func (r *SpoolReader) GetRecordContext(ctx context.Context) (Message, error) {
+	rec, err := r.rd.Next(ctx)
+	if err != nil {
+		return nil, err
+	}
+	return DecodeMessage(rec.Data)
+}
+
+// Offset returns the offset of the next message.
+func (r *SpoolReader) Offset() wal.Offset {
+	return r.rd.Offset()
+}
+
+func (r *SpoolReader) Close() error {
+	return r.rd.Close()
+}
@@ -0,0 +1,134 @@
+package goxstream
+
+import (
+	"bytes"
+	"context"
+	"errors"
+	"fmt"
+	"testing"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+	"github.com/yjhatfdu/goxstream/wal"
+)
+
+var errSourceDone = errors.New("source done")
+
+// scriptSource plays sessions of messages, reconnecting between them.
+type scriptSource struct {
+	sessions   [][]Message
+	reconnects int
+	acked      scn.SCN
+	// reconnect runs before the first message of every session but the
+	// first one.
+	reconnect func()
+}
+
+func (s *scriptSource) GetRecordContext(ctx context.Context) (Message, error) {
+	for len(s.sessions) > 0 && len(s.sessions[0]) == 0 {
+		s.sessions = s.sessions[1:]
+		if len(s.sessions) == 0 {
+			break
+		}
+		s.reconnect()
+		s.reconnects++
+	}
+	if len(s.sessions) == 0 {
+		return nil, errSourceDone
+	}
+	msg := s.sessions[0][0]
+	s.sessions[0] = s.sessions[0][1:]
+	return msg, nil
+}
+
+func (s *scriptSource) SetSCNLwm(lwm scn.SCN) error {
+	s.acked = lwm
+	return nil
+}
+
+func (s *scriptSource) Reconnects() int {
+	return s.reconnects
+}
+
+func spoolRows(s scn.SCN, n int) []Message {
+	var msgs []Message
+	for i := 0; i < n; i++ {
+		msgs = append(msgs, &Insert{SCN: s + scn.SCN(i), Owner: "HR", Table: "EMP", NewColumn: []string{"ID"}, NewRow: []interface{}{int64(s) + int64(i)}})
+	}
+	return msgs
+}
+
+func TestSpoolDropsResentTransactions(t *testing.T) {
+	log, err := wal.Open(t.TempDir(), wal.WithSyncInterval(time.Millisecond))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer log.Close()
+	cat := func(parts ...[]Message) []Message {
+		var msgs []Message
+		for _, p := range parts {
+			msgs = append(msgs, p...)
+		}
+		return msgs
+	}
+	commit := func(s scn.SCN) []Message {
+		return []Message{&Commit{SCN: s, Position: []byte{0, byte(s)}}}
+	}
+	src := &scriptSource{
+		sessions: [][]Message{
+			// the connection drops in the middle of the transaction at 20
+			cat(spoolRows(10, 2), commit(12), spoolRows(20, 2)),
+			// and resumes at the acknowledged SCN, before 12
+			cat(spoolRows(10, 2), commit(12), spoolRows(20, 3), commit(23), spoolRows(30, 1)),
+		},
+	}
+	// make the part of the transaction received before reconnecting
+	// durable, so that it has to be cut
+	src.reconnect = func() { log.Sync() }
+	sp := StartSpool(context.Background(), src, log)
+	if err := sp.Wait(); err != errSourceDone {
+		t.Fatalf("spool stopped with %v", err)
+	}
+	if c := log.LastCommit(); c != 23 || sp.Acked() != 23 || src.acked != 23 {
+		t.Fatalf("last commit %d, acked %d and %d, want 23", c, sp.Acked(), src.acked)
+	}
+
+	// a new spool on the log cuts the transaction at 30 and drops it
+	// being sent again from the start
+	src = &scriptSource{sessions: [][]Message{
+		cat(commit(23), spoolRows(30, 2), commit(32)),
+	}}
+	if err := StartSpool(context.Background(), src, log).Wait(); err != errSourceDone {
+		t.Fatalf("second spool stopped with %v", err)
+	}
+
+	rd, err := NewSpoolReader(log, log.Start())
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer rd.Close()
+	var got []string
+	for {
+		ctx, cancel := context.WithTimeout(context.Background(), 20*time.Millisecond)
+		msg, err := rd.GetRecordContext(ctx)
+		cancel()
+		if err == context.DeadlineExceeded {
+			break
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+		if c, ok := msg.(*Commit); ok && !bytes.Equal(c.Position, []byte{0, byte(c.SCN)}) {
+			t.Fatalf("commit %d spooled with position %x", c.SCN, c.Position)
+		}
+		got = append(got, fmt.Sprintf("%T %d", msg, msg.Scn()))
+	}
+	want := []string{
+		"*goxstream.Insert 10", "*goxstream.Insert 11", "*goxstream.Commit 12",
+		"*goxstream.Insert 20", "*goxstream.Insert 21", "*goxstream.Insert 22", "*goxstream.Commit 23",
+		"*goxstream.Insert 30", "*goxstream.Insert 31", "*goxstream.Commit 32",
+	}
+	if fmt.Sprint(got) != fmt.Sprint(want) {
+		t.Fatalf("spooled\n%v\nwant\n%v", got, want)
+	}
+}
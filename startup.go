@@ -0,0 +1,99 @@
+package goxstream
+
+/* #
+#include "xstrm.h"
+*/
+import "C"
+import (
+	"fmt"
+	"strings"
+	"sync"
+	"unsafe"
+)
+
+// charsetCache remembers the database charsets per user@dbname, so that
+// reopening a stream (e.g. after a failover) logs on in the right charsets
+// straight away.
+var charsetCache sync.Map
+
+func charsetKey(username, dbname string) string {
+	return strings.ToUpper(username) + "@" + dbname
+}
+
+func cachedCharsets(key string) (csid, ncsid C.ushort, ok bool) {
+	v, ok := charsetCache.Load(key)
+	if !ok {
+		return 0, 0, false
+	}
+	ids := v.([2]C.ushort)
+	return ids[0], ids[1], true
+}
+
+// connect logs on in the given charsets, through the runtime's shared
+// environment if there is one.
+func connect(info *C.struct_conn_info, csid, ncsid C.ushort, o *options) (*C.struct_oci, error) {
+	var oci *C.struct_oci
+	var status C.sword
+	if o.runtime == nil {
+		status = C.connect_db(info, &oci, csid, ncsid, cBool(o.pooledAlloc))
+	} else {
+		e, err := o.runtime.env(csid, ncsid)
+		if err != nil {
+			return nil, err
+		}
+		status = C.connect_db_env(info, &oci, e.envp, e.pool)
+	}
+	if status != C.OCI_SUCCESS {
+		err := ociError("logon", oci.errp)
+		freeOci(oci)
+		return nil, err
+	}
+	return oci, nil
+}
+
+// discoverCharsets queries the database charsets over oci's session and
+// caches them under key. It reports whether the session's environment
+// already converts to them, in which case the session can be attached.
+func discoverCharsets(oci *C.struct_oci, key string) (csid, ncsid C.ushort, reuse bool, err error) {
+	if C.query_db_charsets(oci, &csid, &ncsid) != C.OCI_SUCCESS {
+		return 0, 0, false, ociError("query database charsets", oci.errp)
+	}
+	charsetCache.Store(key, [2]C.ushort{csid, ncsid})
+	var envCsid, envNcsid C.ushort
+	if C.env_charsets(oci, &envCsid, &envNcsid) != C.OCI_SUCCESS {
+		return csid, ncsid, false, nil
+	}
+	return csid, ncsid, envCsid == csid && envNcsid == ncsid, nil
+}
+
+func freeOci(oci *C.struct_oci) {
+	C.disconnect_db(oci)
+	C.free(unsafe.Pointer(oci))
+}
+
+// setResumePosition makes attach start after pos and has every LCR at or
+// before it dropped in C before it is decoded.
+func setResumePosition(oci *C.struct_oci, pos []byte) error {
+	if len(pos) > C.OCI_LCR_MAX_POSITION_LEN {
+		return fmt.Errorf("resume position is %d bytes, at most %d allowed", len(pos), C.OCI_LCR_MAX_POSITION_LEN)
+	}
+	dst := (*[C.OCI_LCR_MAX_POSITION_LEN]byte)(unsafe.Pointer(&oci.resume_pos[0]))
+	copy(dst[:], pos)
+	oci.resume_pos_len = C.ub2(len(pos))
+	return nil
+}
+
+// ResumeSkipped reports how many LCRs at or before the resume position
+// were dropped without being decoded.
+func (x *XStreamConn) ResumeSkipped() int {
+	return int(x.ocip.resume_skipped)
+}
+
+// ociError returns the error recorded in errp as an *OCIError.
+func ociError(op string, errp *C.OCIError) error {
+	if errp == nil {
+		return &OCIError{Op: op, Message: "no error handle"}
+	}
+	msg, code := getError(errp)
+	return &OCIError{Op: op, Code: int(code), Message: strings.TrimSpace(msg)}
+}
@@ -0,0 +1,72 @@
+package goxstream
+
+import "time"
+
+// ArenaStats describes the per-connection arena used for LCR scratch memory.
+type ArenaStats struct {
+	// HighWater is the largest number of bytes used while decoding one LCR.
+	HighWater int
+	// Capacity is the current size of the arena's primary block.
+	Capacity int
+	// Grows counts how many times the primary block had to be enlarged.
+	Grows int
+}
+
+// MemStats describes the allocations OCI made through the pooled allocator
+// installed by WithPooledAllocator. All values are zero without it.
+type MemStats struct {
+	// Allocs and Frees count the malloc/realloc and free callbacks.
+	Allocs uint64
+	Frees  uint64
+	// PoolHits counts allocations served from a size-class free list.
+	PoolHits uint64
+	// Bytes is the total number of bytes requested, InUse the bytes that
+	// are currently handed out to OCI.
+	Bytes uint64
+	InUse uint64
+	// LCRs is the number of LCRs accounted in LCRAllocs and LCRBytes, the
+	// allocation volume between receiving and freeing an LCR.
+	LCRs      uint64
+	LCRAllocs uint64
+	LCRBytes  uint64
+	// LastLCRAllocs and LastLCRBytes hold the volume of the latest LCR.
+	LastLCRAllocs uint64
+	LastLCRBytes  uint64
+}
+
+// Where Open took the database character sets from.
+const (
+	// CharsetExplicit: given by WithCharsets.
+	CharsetExplicit = "explicit"
+	// CharsetCached: remembered from an earlier Open of the same user and
+	// database in this process.
+	CharsetCached = "cached"
+	// CharsetSession: queried over the XStream session itself, whose
+	// environment already matched, so a single logon was needed.
+	CharsetSession = "session"
+	// CharsetQueried: queried over a first session that had to be replaced
+	// by one in the database charsets.
+	CharsetQueried = "queried"
+)
+
+// StartupTiming breaks down the time Open spent connecting.
+type StartupTiming struct {
+	// Discovery is the time spent querying the database charsets.
+	Discovery time.Duration
+	// Logon is the time spent creating environments and logging on, over
+	// Logons logons.
+	Logon  time.Duration
+	Logons int
+	// Attach is the time spent attaching to the outbound server.
+	Attach time.Duration
+	// Total is the whole time spent in Open.
+	Total time.Duration
+	// CharsetSource is one of CharsetExplicit, CharsetCached,
+	// CharsetSession or CharsetQueried.
+	CharsetSource string
+}
+
+// StartupTiming reports how long Open took and where it spent the time.
+func (x *XStreamConn) StartupTiming() StartupTiming {
+	return x.startup
+}
@@ -0,0 +1,160 @@
+package goxstream
+
+import (
+	"context"
+	"math/rand"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// SupervisedConn is an outbound connection that reopens itself after
+// transient failures (see IsTransient), waiting with exponential backoff
+// between attempts. Each reopen attaches at the last SCN acknowledged
+// through SetSCNLwm, so nothing acknowledged is delivered again. Like
+// XStreamConn it is not safe for concurrent use.
+type SupervisedConn struct {
+	username, password, dbname, servername string
+	oracleVer                              int
+	opts                                   []Option
+	backoffMin, backoffMax                 time.Duration
+
+	conn       *XStreamConn
+	acked      scn.SCN
+	failures   int
+	reconnects int
+}
+
+// OpenSupervised opens a connection like Open and supervises it. Errors of
+// the first attempt are returned as is.
+func OpenSupervised(username, password, dbname, servername string, oracleVer int, opts ...Option) (*SupervisedConn, error) {
+	o := newOptions(opts)
+	s := &SupervisedConn{
+		username:   username,
+		password:   password,
+		dbname:     dbname,
+		servername: servername,
+		oracleVer:  oracleVer,
+		opts:       opts,
+		backoffMin: o.backoffMin,
+		backoffMax: o.backoffMax,
+	}
+	if o.resumePos == nil {
+		// a resume position stays in opts until something is acknowledged
+		s.acked = o.resumeSCN
+	}
+	conn, err := Open(username, password, dbname, servername, oracleVer, opts...)
+	if err != nil {
+		return nil, err
+	}
+	s.conn = conn
+	return s, nil
+}
+
+// GetRecord returns the next message, reopening the connection as often as
+// needed. Only errors that are not transient are returned.
+func (s *SupervisedConn) GetRecord() (Message, error) {
+	return s.GetRecordContext(context.Background())
+}
+
+// GetRecordContext is GetRecord bounded by ctx, which also cuts short the
+// backoff between reopen attempts.
+func (s *SupervisedConn) GetRecordContext(ctx context.Context) (Message, error) {
+	for {
+		if s.conn == nil {
+			if err := s.reopen(ctx); err != nil {
+				return nil, err
+			}
+		}
+		msg, err := s.conn.GetRecordContext(ctx)
+		if err == nil {
+			s.failures = 0
+			return msg, nil
+		}
+		if !IsTransient(err) {
+			return nil, err
+		}
+		s.drop()
+	}
+}
+
+// SetSCNLwm acknowledges s. If the connection is lost meanwhile, s is
+// passed at the next attach instead and no error is returned.
+func (s *SupervisedConn) SetSCNLwm(lwm scn.SCN) error {
+	s.acked = lwm
+	if s.conn == nil {
+		return nil
+	}
+	err := s.conn.SetSCNLwm(lwm)
+	if err != nil && IsTransient(err) {
+		s.drop()
+		return nil
+	}
+	return err
+}
+
+// Reconnects reports how many times the connection has been reopened.
+func (s *SupervisedConn) Reconnects() int {
+	return s.reconnects
+}
+
+// Conn returns the current connection, nil while it is being reopened.
+func (s *SupervisedConn) Conn() *XStreamConn {
+	return s.conn
+}
+
+func (s *SupervisedConn) Close() error {
+	if s.conn == nil {
+		return nil
+	}
+	err := s.conn.Close()
+	s.conn = nil
+	return err
+}
+
+func (s *SupervisedConn) drop() {
+	// the session is most likely gone, so detach errors are expected
+	_ = s.conn.Close()
+	s.conn = nil
+}
+
+func (s *SupervisedConn) reopen(ctx context.Context) error {
+	for {
+		t := time.NewTimer(s.delay())
+		select {
+		case <-ctx.Done():
+			t.Stop()
+			return ctx.Err()
+		case <-t.C:
+		}
+		s.failures++
+		opts := s.opts
+		if s.acked != 0 {
+			// also replaces a resume position among opts
+			opts = append(opts[:len(opts):len(opts)], WithResumeSCN(s.acked))
+		}
+		conn, err := Open(s.username, s.password, s.dbname, s.servername, s.oracleVer, opts...)
+		if err == nil {
+			s.conn = conn
+			s.reconnects++
+			return nil
+		}
+		if !IsTransient(err) {
+			return err
+		}
+	}
+}
+
+// delay is the backoff before the next attempt: backoffMin doubled for
+// every failure in a row, capped at backoffMax, with up to half of it
+// taken off at random so that many streams do not reconnect in lockstep.
+func (s *SupervisedConn) delay() time.Duration {
+	d := s.backoffMin
+	for i := 0; i < s.failures && d < s.backoffMax; i++ {
+		d *= 2
+	}
+	if d > s.backoffMax {
+		d = s.backoffMax
+	}
+	return d - time.Duration(rand.Int63n(int64(d)/2+1))
+}
@@ -0,0 +1,113 @@
+package goxstream
+
+import (
+	"runtime"
+	"sync"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// osThread runs calls on a single locked OS thread, so that every OCI call
+// of a connection is made from the same thread.
+type osThread struct {
+	mu    sync.Mutex
+	calls chan func()
+	ret   chan struct{}
+}
+
+func newOSThread() *osThread {
+	t := &osThread{
+		calls: make(chan func()),
+		ret:   make(chan struct{}),
+	}
+	go t.loop()
+	return t
+}
+
+func (t *osThread) loop() {
+	runtime.LockOSThread()
+	defer runtime.UnlockOSThread()
+	for f := range t.calls {
+		f()
+		t.ret <- struct{}{}
+	}
+}
+
+// do runs f on the thread and waits for it to return.
+func (t *osThread) do(f func()) {
+	t.mu.Lock()
+	t.calls <- f
+	<-t.ret
+	t.mu.Unlock()
+}
+
+// stop ends the thread after the calls in flight.
+func (t *osThread) stop() {
+	t.mu.Lock()
+	close(t.calls)
+	t.mu.Unlock()
+}
+
+// Open attaches to the XStream outbound server servername. Connections
+// opened with WithRuntime run all their OCI calls on a dedicated OS thread.
+func Open(username, password, dbname, servername string, oracleVer int, opts ...Option) (*XStreamConn, error) {
+	o := newOptions(opts)
+	if o.runtime == nil {
+		return open(username, password, dbname, servername, oracleVer, o)
+	}
+	if err := o.runtime.acquire(); err != nil {
+		return nil, err
+	}
+	t := newOSThread()
+	var x *XStreamConn
+	var err error
+	t.do(func() { x, err = open(username, password, dbname, servername, oracleVer, o) })
+	if err != nil {
+		t.stop()
+		o.runtime.release()
+		return nil, err
+	}
+	x.thread = t
+	return x, nil
+}
+
+// run runs f on the connection's thread, if it has one.
+func (x *XStreamConn) run(f func()) {
+	if x.thread == nil {
+		f()
+		return
+	}
+	x.thread.do(f)
+}
+
+func (x *XStreamConn) GetRecord() (Message, error) {
+	if x.thread == nil {
+		return x.getRecord()
+	}
+	var msg Message
+	var err error
+	x.thread.do(func() { msg, err = x.getRecord() })
+	return msg, err
+}
+
+func (x *XStreamConn) SetSCNLwm(s scn.SCN) error {
+	if x.thread == nil {
+		return x.setSCNLwm(s)
+	}
+	var err error
+	x.thread.do(func() { err = x.setSCNLwm(s) })
+	return err
+}
+
+func (x *XStreamConn) Close() error {
+	if x.thread == nil {
+		return x.close()
+	}
+	var err error
+	x.thread.do(func() { err = x.close() })
+	x.thread.stop()
+	if x.opts.runtime != nil {
+		x.opts.runtime.release()
+	}
+	return err
+}
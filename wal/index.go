@@ -0,0 +1,303 @@
+package wal
+
+import (
+	"bufio"
+	"encoding/binary"
+	"hash/crc32"
+	"io/ioutil"
+	"os"
+	"sort"
+	"strings"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// A segment's sparse index lists some of its commits, each as the commit
+// SCN and the offset in the segment after the commit record, in order:
+// the first commit, commits at least an index interval apart and the
+// last one. Commits arrive in SCN order, so Seek finds a transaction
+// boundary by binary search and only scans less than an interval plus a
+// transaction from there. The index of the segment being appended to is
+// kept in memory; it is written next to the segment file when the
+// segment is sealed and loaded lazily, mapped into memory:
+//
+//	magic    4 bytes, "WIX1"
+//	crc      4 bytes, CRC-32C of the fields below
+//	size     8 bytes, little endian, of the segment file
+//	last     8 bytes, the last commit SCN in or before the segment
+//	entries  16 bytes each: commit SCN and offset, little endian
+//
+// An index is only derived data: one that is missing or does not match
+// its segment is rebuilt from the segment.
+
+const (
+	indexSuffix    = ".idx"
+	indexMagic     = "WIX1"
+	indexHeaderLen = 24
+	entryLen       = 16
+)
+
+type index struct {
+	last    scn.SCN // last commit SCN in or before the segment
+	entries []byte
+	mapping []byte // to unmap, nil if read into memory
+}
+
+func (x *index) len() int {
+	return len(x.entries) / entryLen
+}
+
+func (x *index) at(i int) (scn.SCN, Offset) {
+	e := x.entries[i*entryLen:]
+	return scn.SCN(binary.LittleEndian.Uint64(e)), Offset(binary.LittleEndian.Uint64(e[8:]))
+}
+
+// search returns the last entry with an SCN at most s and an offset at
+// most end, -1 if there is none.
+func (x *index) search(s scn.SCN, end Offset) int {
+	return sort.Search(x.len(), func(i int) bool {
+		c, off := x.at(i)
+		return c > s || off > end
+	}) - 1
+}
+
+func (x *index) close() {
+	if x.mapping != nil {
+		munmap(x.mapping)
+		x.mapping = nil
+	}
+	x.entries = nil
+}
+
+// indexer builds the index of a segment as its records are appended.
+type indexer struct {
+	interval int64
+	entries  []byte
+	last     scn.SCN // last commit so far
+	lastEnd  Offset  // offset after it, 0 if the segment has none
+	indexed  Offset  // offset of the last entry
+}
+
+func (x *indexer) reset(last scn.SCN) {
+	x.entries = nil
+	x.last, x.lastEnd, x.indexed = last, 0, 0
+}
+
+func (x *indexer) commit(s scn.SCN, end Offset) {
+	if len(x.entries) == 0 || int64(end-x.indexed) >= x.interval {
+		x.add(s, end)
+	}
+	x.last, x.lastEnd = s, end
+}
+
+func (x *indexer) add(s scn.SCN, end Offset) {
+	var e [entryLen]byte
+	binary.LittleEndian.PutUint64(e[0:], uint64(s))
+	binary.LittleEndian.PutUint64(e[8:], uint64(end))
+	x.entries = append(x.entries, e[:]...)
+	x.indexed = end
+}
+
+// seal completes the index with the last commit.
+func (x *indexer) seal() *index {
+	if x.lastEnd != 0 && x.indexed != x.lastEnd {
+		x.add(x.last, x.lastEnd)
+	}
+	return &index{last: x.last, entries: x.entries}
+}
+
+func indexPath(segmentPath string) string {
+	return strings.TrimSuffix(segmentPath, suffix) + indexSuffix
+}
+
+// writeIndex writes the index of a sealed segment of the given size. It
+// is not synced, as it is validated when loaded.
+func writeIndex(path string, size int64, x *index) error {
+	b := make([]byte, indexHeaderLen, indexHeaderLen+len(x.entries))
+	copy(b, indexMagic)
+	binary.LittleEndian.PutUint64(b[8:], uint64(size))
+	binary.LittleEndian.PutUint64(b[16:], uint64(x.last))
+	b = append(b, x.entries...)
+	binary.LittleEndian.PutUint32(b[4:], crc32.Checksum(b[8:], crcTable))
+	tmp := path + ".tmp"
+	if err := ioutil.WriteFile(tmp, b, 0644); err != nil {
+		return err
+	}
+	return os.Rename(tmp, path)
+}
+
+// readIndex loads the index file of a segment of the given size, nil if it
+// is missing or stale.
+func readIndex(path string, size int64) *index {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil
+	}
+	defer f.Close()
+	fi, err := f.Stat()
+	if err != nil || fi.Size() < indexHeaderLen || (fi.Size()-indexHeaderLen)%entryLen != 0 {
+		return nil
+	}
+	x := &index{}
+	b, err := mmap(f, int(fi.Size()))
+	if err == nil {
+		x.mapping = b
+	} else if b, err = ioutil.ReadAll(f); err != nil {
+		return nil
+	}
+	if string(b[:4]) != indexMagic ||
+		binary.LittleEndian.Uint32(b[4:]) != crc32.Checksum(b[8:], crcTable) ||
+		int64(binary.LittleEndian.Uint64(b[8:])) != size {
+		if x.mapping != nil {
+			munmap(x.mapping)
+		}
+		return nil
+	}
+	x.last = scn.SCN(binary.LittleEndian.Uint64(b[16:]))
+	x.entries = b[indexHeaderLen:]
+	return x
+}
+
+// buildIndex scans a sealed segment for its index; prev is the last
+// commit before it.
+func buildIndex(path string, size int64, interval int64, prev scn.SCN) (*index, error) {
+	f, err := os.Open(path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	x := indexer{interval: interval}
+	x.reset(prev)
+	r := bufio.NewReaderSize(f, 1<<20)
+	var pos Offset
+	var buf []byte
+	for int64(pos) < size {
+		rec, n, err := readRecord(r, buf, size-int64(pos))
+		if err != nil {
+			return nil, err
+		}
+		buf = rec.Data[:0]
+		pos += Offset(n)
+		if rec.Commit {
+			x.commit(rec.SCN, pos)
+		}
+	}
+	return x.seal(), nil
+}
+
+// segmentIndex returns the index of sealed segment i, loading or
+// rebuilding it on first use. l.mu is held.
+func (l *Log) segmentIndex(i int) (*index, error) {
+	seg := &l.segments[i]
+	if seg.index != nil {
+		return seg.index, nil
+	}
+	size := int64(l.segments[i+1].base - seg.base)
+	path := indexPath(seg.path)
+	if x := readIndex(path, size); x != nil {
+		seg.index = x
+		return x, nil
+	}
+	var prev scn.SCN
+	if i > 0 {
+		p, err := l.segmentIndex(i - 1)
+		if err != nil {
+			return nil, err
+		}
+		prev = p.last
+	}
+	x, err := buildIndex(seg.path, size, l.opts.indexInterval, prev)
+	if err != nil {
+		return nil, err
+	}
+	writeIndex(path, size, x) // rebuilt again next time if this fails
+	seg.index = x
+	return x, nil
+}
+
+// Seek returns the offset to read from to receive the transactions that
+// commit after s: the offset after the last commit at or before s. Seeking
+// past the durable end of the log returns the offset after its last
+// durable commit. ErrRemoved is returned if the transaction after s starts
+// before the start of the log.
+func (l *Log) Seek(s scn.SCN) (Offset, error) {
+	off, err := l.seekIndex(s)
+	if err != nil {
+		return 0, err
+	}
+	rd, err := l.NewReader(off)
+	if err != nil {
+		return 0, err
+	}
+	defer rd.Close()
+	for {
+		rec, more, err := rd.read()
+		if err != nil {
+			return 0, err
+		}
+		if more != nil || rec.Commit && rec.SCN > s {
+			return off, nil
+		}
+		if rec.Commit {
+			off = rec.End
+		}
+	}
+}
+
+// seekIndex returns the offset after the last indexed durable commit at
+// or before s.
+func (l *Log) seekIndex(s scn.SCN) (Offset, error) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if l.closed {
+		return 0, ErrClosed
+	}
+	active := len(l.segments) - 1
+	last := func(i int) (scn.SCN, error) {
+		if i == active {
+			return l.durCommt, nil
+		}
+		x, err := l.segmentIndex(i)
+		if err != nil {
+			return 0, err
+		}
+		return x.last, nil
+	}
+	// the last commit SCNs of the segments are in order; the entry sought
+	// is in the first segment ending after s or before it
+	var err error
+	i := sort.Search(len(l.segments), func(i int) bool {
+		c, e := last(i)
+		if e != nil {
+			err = e
+			return true
+		}
+		return c > s
+	})
+	if err != nil {
+		return 0, err
+	}
+	if i == len(l.segments) {
+		i--
+	}
+	for ; i >= 0; i-- {
+		x := &index{entries: l.index.entries}
+		if i != active {
+			if x, err = l.segmentIndex(i); err != nil {
+				return 0, err
+			}
+		}
+		base := l.segments[i].base
+		if base > l.durable {
+			continue
+		}
+		if j := x.search(s, l.durable-base); j >= 0 {
+			_, off := x.at(j)
+			return base + off, nil
+		}
+	}
+	if l.segments[0].base != 0 {
+		return 0, ErrRemoved
+	}
+	return 0, nil
+}
@@ -0,0 +1,15 @@
+package wal
+
+import (
+	"os"
+	"syscall"
+)
+
+// mmap maps the first size bytes of f read-only, for reading sequentially.
+func mmap(f *os.File, size int) ([]byte, error) {
+	return syscall.Mmap(int(f.Fd()), 0, size, syscall.PROT_READ, syscall.MAP_SHARED)
+}
+
+func munmap(b []byte) error {
+	return syscall.Munmap(b)
+}
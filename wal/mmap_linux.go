@@ -0,0 +1,20 @@
+package wal
+
+import (
+	"os"
+	"syscall"
+)
+
+// mmap maps the first size bytes of f read-only, for reading sequentially.
+func mmap(f *os.File, size int) ([]byte, error) {
+	b, err := syscall.Mmap(int(f.Fd()), 0, size, syscall.PROT_READ, syscall.MAP_SHARED)
+	if err != nil {
+		return nil, err
+	}
+	syscall.Madvise(b, syscall.MADV_SEQUENTIAL)
+	return b, nil
+}
+
+func munmap(b []byte) error {
+	return syscall.Munmap(b)
+}
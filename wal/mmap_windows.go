@@ -0,0 +1,18 @@
+package wal
+
+import (
+	"errors"
+	"os"
+)
+
+var errNoMmap = errors.New("wal: mmap not supported")
+
+// mmap is not supported on Windows; segments and indexes are read from
+// the file instead.
+func mmap(f *os.File, size int) ([]byte, error) {
+	return nil, errNoMmap
+}
+
+func munmap(b []byte) error {
+	return errNoMmap
+}
@@ -0,0 +1,178 @@
+package wal
+
+import (
+	"bufio"
+	"context"
+	"io"
+	"os"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// Record is a record read from the log.
+type Record struct {
+	SCN    scn.SCN
+	Commit bool
+	// Data is only valid until the next call to Next and must not be
+	// modified.
+	Data []byte
+	// Offset is the offset of the record, End the offset after it.
+	Offset Offset
+	End    Offset
+}
+
+// Reader reads the records of a log in order up to the last durable
+// commit, waiting for new ones at the end. Sealed segments are mapped into memory where supported,
+// for replaying without copying, the last one is read through a buffer.
+// It is not safe for concurrent use; each consumer has a reader of its
+// own.
+type Reader struct {
+	l    *Log
+	off  Offset
+	next Offset // base of the segment after the open one, 0 if unknown
+	f    *os.File
+	r    *bufio.Reader
+	m    []byte // mapping of the open segment, if sealed
+	pos  int    // of off in m
+	buf  []byte
+	// rewinds of the log seen when the segment was opened: a rewind
+	// rewrites the file after the offsets read
+	rewinds int
+}
+
+// NewReader returns a reader starting at off, which must be the start of
+// the log or an offset returned by Append, Seek or Record.End.
+func (l *Log) NewReader(off Offset) (*Reader, error) {
+	rd := &Reader{l: l, off: off}
+	if err := rd.open(); err != nil {
+		return nil, err
+	}
+	return rd, nil
+}
+
+// open opens the segment holding rd.off and seeks to it.
+func (rd *Reader) open() error {
+	rd.l.mu.Lock()
+	seg, next, err := rd.l.segmentAt(rd.off)
+	rd.rewinds = rd.l.rewinds
+	rd.l.mu.Unlock()
+	if err != nil {
+		return err
+	}
+	f, err := os.Open(seg.path)
+	if err != nil {
+		return err
+	}
+	rd.unmap()
+	if next != 0 {
+		if m, err := mmap(f, int(next-seg.base)); err == nil {
+			f.Close()
+			if rd.f != nil {
+				rd.f.Close()
+				rd.f = nil
+			}
+			rd.m, rd.pos, rd.next = m, int(rd.off-seg.base), next
+			return nil
+		}
+	}
+	if _, err := f.Seek(int64(rd.off-seg.base), 0); err != nil {
+		f.Close()
+		return err
+	}
+	if rd.f != nil {
+		rd.f.Close()
+	}
+	rd.f, rd.next = f, next
+	if rd.r == nil {
+		rd.r = bufio.NewReaderSize(f, 256<<10)
+	} else {
+		rd.r.Reset(f)
+	}
+	return nil
+}
+
+func (rd *Reader) unmap() {
+	if rd.m != nil {
+		munmap(rd.m)
+		rd.m = nil
+	}
+}
+
+// Next returns the next record, waiting until its transaction is durable
+// or ctx is done.
+func (rd *Reader) Next(ctx context.Context) (Record, error) {
+	for {
+		rec, more, err := rd.read()
+		if err != nil || more == nil {
+			return rec, err
+		}
+		select {
+		case <-more:
+		case <-ctx.Done():
+			return Record{}, ctx.Err()
+		}
+	}
+}
+
+// read returns the next record, or if there is none yet a channel closed
+// when there may be.
+func (rd *Reader) read() (Record, <-chan struct{}, error) {
+	rd.l.mu.Lock()
+	durable, notify, closed := rd.l.durEnd, rd.l.notify, rd.l.closed
+	rewound := rd.l.rewinds != rd.rewinds
+	if rd.next == 0 {
+		_, rd.next, _ = rd.l.segmentAt(rd.off)
+	}
+	rd.l.mu.Unlock()
+	if rd.off >= durable {
+		if closed {
+			return Record{}, nil, ErrClosed
+		}
+		return Record{}, notify, nil
+	}
+	if rd.off == rd.next || rewound {
+		if err := rd.open(); err != nil {
+			return Record{}, nil, err
+		}
+	}
+	var rec Record
+	var n int
+	var err error
+	if rd.m != nil {
+		end := len(rd.m)
+		if max := rd.pos + int(durable-rd.off); max < end {
+			end = max
+		}
+		rec, n, err = parseRecord(rd.m[rd.pos:end])
+		rd.pos += n
+	} else {
+		rec, n, err = readRecord(rd.r, rd.buf, int64(durable-rd.off))
+		if err == io.EOF || err == io.ErrUnexpectedEOF {
+			err = ErrCorrupt
+		}
+		rd.buf = rec.Data[:0]
+	}
+	if err != nil {
+		return Record{}, nil, err
+	}
+	rec.Offset = rd.off
+	rd.off += Offset(n)
+	rec.End = rd.off
+	return rec, nil, nil
+}
+
+// Offset returns the offset of the next record.
+func (rd *Reader) Offset() Offset {
+	return rd.off
+}
+
+// Close closes the reader's segment file.
+func (rd *Reader) Close() error {
+	rd.unmap()
+	if rd.f == nil {
+		return nil
+	}
+	err := rd.f.Close()
+	rd.f = nil
+	return err
+}
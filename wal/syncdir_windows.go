@@ -0,0 +1,7 @@
+package wal
+
+// syncDir does nothing on Windows, where a directory cannot be opened for
+// fsync and NTFS journals the creation of files itself.
+func syncDir(dir string) error {
+	return nil
+}
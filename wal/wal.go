@@ -0,0 +1,670 @@
+// Package wal is a local, segmented, append-only log of opaque records
+// tagged with an SCN, written with group commit: appends only fill a
+// buffer, and a background syncer writes and fsyncs everything appended
+// in the last sync interval at once.
+//
+// Records that end a transaction are appended as commits. Readers only
+// see records up to the last durable commit, and Open and Rewind drop the
+// records after the last commit, which belong to a transaction that was
+// still being received, so the log always ends at a transaction boundary
+// and the stream can be resumed after LastCommit.
+//
+// The log is a sequence of segment files named after the offset of their
+// first record, each a sequence of records:
+//
+//	length   4 bytes, little endian, of the data
+//	crc      4 bytes, CRC-32C of the fields below
+//	scn      8 bytes, little endian
+//	flags    1 byte, 1 for a commit
+//	data
+//
+// An offset is a position in the concatenation of the segments. Each
+// sealed segment has a sparse SCN index next to it, see Seek.
+package wal
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"fmt"
+	"hash/crc32"
+	"io"
+	"os"
+	"path/filepath"
+	"sort"
+	"sync"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+// Offset is a position in the log.
+type Offset uint64
+
+const (
+	headerLen  = 17
+	flagCommit = 1
+	suffix     = ".wal"
+)
+
+var (
+	// ErrClosed is returned by operations on a closed log.
+	ErrClosed = errors.New("wal: log closed")
+	// ErrRemoved is returned for offsets before the start of the log.
+	ErrRemoved = errors.New("wal: offset removed")
+	// ErrCorrupt is returned for a record failing its checksum before the
+	// end of the log, by Open when a valid record follows it.
+	ErrCorrupt = errors.New("wal: corrupt record")
+)
+
+var crcTable = crc32.MakeTable(crc32.Castagnoli)
+
+// Option configures a Log.
+type Option func(*options)
+
+type options struct {
+	segmentSize   int64
+	syncInterval  time.Duration
+	indexInterval int64
+	bufferSize    int
+}
+
+// WithSegmentSize sets the size after which a new segment file is
+// started. The default is 64 MiB.
+func WithSegmentSize(n int64) Option {
+	return func(o *options) {
+		o.segmentSize = n
+	}
+}
+
+// WithSyncInterval sets the group commit window: how long appended records
+// may wait for the fsync that makes them durable. The default is 10ms.
+func WithSyncInterval(d time.Duration) Option {
+	return func(o *options) {
+		o.syncInterval = d
+	}
+}
+
+// WithIndexInterval sets how many bytes apart commits are indexed, which
+// bounds the scan after the binary search in Seek. The default is 256 KiB.
+func WithIndexInterval(n int64) Option {
+	return func(o *options) {
+		o.indexInterval = n
+	}
+}
+
+type segment struct {
+	base  Offset
+	path  string
+	index *index // of a sealed segment, nil until loaded
+}
+
+// Log is a write-ahead log. Append is meant for a single writer; reading,
+// Sync and the accessors are safe for concurrent use.
+type Log struct {
+	dir  string
+	opts options
+
+	mu       sync.Mutex
+	segments []segment // by base; the last one is appended to
+	file     *os.File  // of the last segment
+	w        *bufio.Writer
+	retired  []*os.File // earlier segment files still to be synced
+	newDir   bool       // a segment was created since the last sync
+	end      Offset
+	commit   scn.SCN // last commit appended
+	commtEnd Offset  // offset after it
+	durable  Offset
+	durCommt scn.SCN // last commit durable
+	durEnd   Offset  // offset after it, the end of what readers see
+	rewinds  int     // readers reopen their segment after a rewind
+	index    indexer // of the last segment
+	notify   chan struct{}
+	err      error
+	closing  bool // Close was called
+	closed   bool
+
+	syncReq chan struct{}
+	stop    chan struct{}
+	done    chan struct{}
+}
+
+// Open opens the log in dir, creating dir if needed, and starts its
+// syncer. A torn record at the end of the log and the records after the
+// last commit are removed. An invalid record counts as torn only if no
+// valid record follows it: a crash can only tear what was never synced,
+// while a record that was synced, and perhaps acknowledged, is corrupt,
+// and Open returns ErrCorrupt rather than cut the log there.
+func Open(dir string, opts ...Option) (*Log, error) {
+	o := options{
+		segmentSize:   64 << 20,
+		syncInterval:  10 * time.Millisecond,
+		indexInterval: 256 << 10,
+		bufferSize:    256 << 10,
+	}
+	for _, opt := range opts {
+		opt(&o)
+	}
+	if err := os.MkdirAll(dir, 0755); err != nil {
+		return nil, err
+	}
+	l := &Log{
+		dir:     dir,
+		opts:    o,
+		notify:  make(chan struct{}),
+		syncReq: make(chan struct{}, 1),
+		stop:    make(chan struct{}),
+		done:    make(chan struct{}),
+	}
+	if err := l.recover(); err != nil {
+		return nil, err
+	}
+	go l.syncer()
+	return l, nil
+}
+
+// recover loads the segment list and cuts the log after its last valid
+// commit, removing trailing segments that hold none: those hold only an
+// incomplete transaction and a torn tail, never acknowledged data.
+func (l *Log) recover() error {
+	names, err := filepath.Glob(filepath.Join(l.dir, "*"+suffix))
+	if err != nil {
+		return err
+	}
+	for _, name := range names {
+		var base uint64
+		if _, err := fmt.Sscanf(filepath.Base(name), "%020d"+suffix, &base); err == nil {
+			l.segments = append(l.segments, segment{base: Offset(base), path: name})
+		}
+	}
+	sort.Slice(l.segments, func(i, j int) bool { return l.segments[i].base < l.segments[j].base })
+	l.index.interval = l.opts.indexInterval
+	for len(l.segments) > 0 {
+		last := l.segments[len(l.segments)-1]
+		// the last segment is appended to again, its index is rebuilt
+		if err := removeIfExists(indexPath(last.path)); err != nil {
+			return err
+		}
+		end, ok, err := scanCommits(last.path, &l.index)
+		if err != nil {
+			return err
+		}
+		if ok || len(l.segments) == 1 {
+			if err := truncate(last.path, int64(end)); err != nil {
+				return err
+			}
+			l.end = last.base + end
+			l.commit, l.commtEnd = l.index.last, l.end
+			break
+		}
+		if err := os.Remove(last.path); err != nil {
+			return err
+		}
+		l.segments = l.segments[:len(l.segments)-1]
+	}
+	if len(l.segments) == 0 {
+		l.segments = []segment{{base: 0, path: l.segmentPath(0)}}
+		l.newDir = true
+	}
+	f, err := os.OpenFile(l.segments[len(l.segments)-1].path, os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0644)
+	if err != nil {
+		return err
+	}
+	l.file = f
+	l.w = bufio.NewWriterSize(f, l.opts.bufferSize)
+	l.durable, l.durCommt, l.durEnd = l.end, l.commit, l.commtEnd
+	return nil
+}
+
+// scanCommits returns the end of the last commit record in a segment file
+// that is followed only by valid records or a torn tail, indexing the
+// commits up to there. It returns ErrCorrupt for an invalid record that
+// is followed by a valid one.
+func scanCommits(path string, x *indexer) (end Offset, ok bool, err error) {
+	x.reset(0)
+	f, err := os.Open(path)
+	if err != nil {
+		return 0, false, err
+	}
+	defer f.Close()
+	fi, err := f.Stat()
+	if err != nil {
+		return 0, false, err
+	}
+	r := bufio.NewReaderSize(f, 1<<20)
+	var pos Offset
+	var buf []byte
+	for {
+		if int64(pos) == fi.Size() {
+			return end, ok, nil
+		}
+		rec, n, err := readRecord(r, buf, fi.Size()-int64(pos))
+		if err != nil {
+			// a short or corrupt record ends the written part of the log
+			// if it starts a torn tail
+			torn, err := tornAt(f, int64(pos), fi.Size())
+			if err != nil {
+				return 0, false, err
+			}
+			if !torn {
+				return 0, false, fmt.Errorf("%w at offset %d of %s", ErrCorrupt, pos, path)
+			}
+			return end, ok, nil
+		}
+		buf = rec.Data[:0]
+		pos += Offset(n)
+		if rec.Commit {
+			end, ok = pos, true
+			x.commit(rec.SCN, pos)
+		}
+	}
+}
+
+// tornAt reports whether the invalid record at pos starts a torn tail:
+// whether no valid record starts anywhere after it.
+func tornAt(f *os.File, pos, size int64) (bool, error) {
+	b := make([]byte, size-pos)
+	if _, err := f.ReadAt(b, pos); err != nil {
+		return false, err
+	}
+	for i := 1; i+headerLen <= len(b); i++ {
+		if _, _, err := parseRecord(b[i:]); err == nil {
+			return false, nil
+		}
+	}
+	return true, nil
+}
+
+func removeIfExists(path string) error {
+	if err := os.Remove(path); err != nil && !os.IsNotExist(err) {
+		return err
+	}
+	return nil
+}
+
+func truncate(path string, size int64) error {
+	f, err := os.OpenFile(path, os.O_WRONLY|os.O_CREATE, 0644)
+	if err != nil {
+		return err
+	}
+	defer f.Close()
+	if fi, err := f.Stat(); err != nil || fi.Size() == size {
+		return err
+	}
+	if err := f.Truncate(size); err != nil {
+		return err
+	}
+	return f.Sync()
+}
+
+func (l *Log) segmentPath(base Offset) string {
+	return filepath.Join(l.dir, fmt.Sprintf("%020d"+suffix, uint64(base)))
+}
+
+// Append adds a record and returns the offset after it. The record is
+// durable once Durable reaches that offset.
+func (l *Log) Append(s scn.SCN, data []byte, commit bool) (Offset, error) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if l.closed {
+		return 0, ErrClosed
+	}
+	if l.err != nil {
+		return 0, l.err
+	}
+	active := l.segments[len(l.segments)-1].base
+	if int64(l.end-active) >= l.opts.segmentSize {
+		if err := l.roll(); err != nil {
+			l.err = err
+			return 0, err
+		}
+	}
+	var h [headerLen]byte
+	binary.LittleEndian.PutUint32(h[0:], uint32(len(data)))
+	binary.LittleEndian.PutUint64(h[8:], uint64(s))
+	if commit {
+		h[16] = flagCommit
+	}
+	crc := crc32.Update(crc32.Checksum(h[8:], crcTable), crcTable, data)
+	binary.LittleEndian.PutUint32(h[4:], crc)
+	if _, err := l.w.Write(h[:]); err != nil {
+		l.err = err
+		return 0, err
+	}
+	if _, err := l.w.Write(data); err != nil {
+		l.err = err
+		return 0, err
+	}
+	l.end += Offset(headerLen + len(data))
+	if commit {
+		l.commit, l.commtEnd = s, l.end
+		l.index.commit(s, l.end-l.segments[len(l.segments)-1].base)
+	}
+	return l.end, nil
+}
+
+// roll starts a new segment at the current end and writes the index of
+// the old one. The old file is synced and closed by the syncer.
+func (l *Log) roll() error {
+	if err := l.w.Flush(); err != nil {
+		return err
+	}
+	old := &l.segments[len(l.segments)-1]
+	old.index = l.index.seal()
+	l.index.reset(l.commit)
+	writeIndex(indexPath(old.path), int64(l.end-old.base), old.index) // rebuilt on use if this fails
+	path := l.segmentPath(l.end)
+	f, err := os.OpenFile(path, os.O_CREATE|os.O_WRONLY|os.O_APPEND, 0644)
+	if err != nil {
+		return err
+	}
+	l.retired = append(l.retired, l.file)
+	l.file = f
+	l.w.Reset(f)
+	l.segments = append(l.segments, segment{base: l.end, path: path})
+	l.newDir = true
+	return nil
+}
+
+func (l *Log) syncer() {
+	defer close(l.done)
+	t := time.NewTicker(l.opts.syncInterval)
+	defer t.Stop()
+	for {
+		select {
+		case <-l.stop:
+			l.sync()
+			return
+		case <-t.C:
+		case <-l.syncReq:
+		}
+		l.sync()
+	}
+}
+
+// sync writes out the buffer and fsyncs, outside the lock so appends can
+// go on meanwhile, then publishes the new durable end.
+func (l *Log) sync() {
+	l.mu.Lock()
+	if l.durable == l.end || l.err != nil {
+		l.mu.Unlock()
+		return
+	}
+	err := l.w.Flush()
+	end, commit, commtEnd := l.end, l.commit, l.commtEnd
+	files := append(l.retired, l.file)
+	l.retired = nil
+	newDir := l.newDir
+	l.newDir = false
+	l.mu.Unlock()
+
+	for i, f := range files {
+		if err == nil {
+			err = f.Sync()
+		}
+		if i < len(files)-1 {
+			f.Close()
+		}
+	}
+	if err == nil && newDir {
+		err = syncDir(l.dir)
+	}
+
+	l.mu.Lock()
+	if err != nil {
+		l.err = err
+	} else {
+		l.durable, l.durCommt, l.durEnd = end, commit, commtEnd
+	}
+	close(l.notify)
+	l.notify = make(chan struct{})
+	l.mu.Unlock()
+}
+
+// Sync waits until everything appended so far is durable, joining the
+// next group commit rather than forcing one of its own.
+func (l *Log) Sync() error {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	target := l.end
+	for l.durable < target && l.err == nil && !l.closed {
+		ch := l.notify
+		l.mu.Unlock()
+		select {
+		case l.syncReq <- struct{}{}:
+		default:
+		}
+		<-ch
+		l.mu.Lock()
+	}
+	if l.err != nil {
+		return l.err
+	}
+	if l.durable < target {
+		return ErrClosed
+	}
+	return nil
+}
+
+// Rewind removes the records appended after the last commit: the part of
+// a transaction that is received again from its start, e.g. after the
+// source reconnected. Readers never saw them. Like Append, it is meant for
+// the single writer.
+func (l *Log) Rewind() error {
+	// let the syncer finish with the files first
+	if err := l.Sync(); err != nil {
+		return err
+	}
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	if l.closed {
+		return ErrClosed
+	}
+	if l.err != nil {
+		return l.err
+	}
+	if l.end == l.commtEnd {
+		return nil
+	}
+	if err := l.rewind(); err != nil {
+		l.err = err
+		return err
+	}
+	return nil
+}
+
+// rewind cuts the log at commtEnd, reopening the segment holding it for
+// appending. l.mu is held and the buffer was written out by Sync.
+func (l *Log) rewind() error {
+	reopen := false
+	for len(l.segments) > 1 && l.segments[len(l.segments)-1].base >= l.commtEnd {
+		if err := l.file.Close(); err != nil {
+			return err
+		}
+		last := l.segments[len(l.segments)-1]
+		if err := os.Remove(last.path); err != nil {
+			return err
+		}
+		l.segments = l.segments[:len(l.segments)-1]
+		l.newDir, reopen = true, true
+		f, err := os.OpenFile(l.segments[len(l.segments)-1].path, os.O_WRONLY|os.O_APPEND, 0644)
+		if err != nil {
+			return err
+		}
+		l.file = f
+	}
+	active := &l.segments[len(l.segments)-1]
+	if err := l.file.Truncate(int64(l.commtEnd - active.base)); err != nil {
+		return err
+	}
+	if err := l.file.Sync(); err != nil {
+		return err
+	}
+	l.w.Reset(l.file)
+	if reopen {
+		// the segment is appended to again, its index is rebuilt
+		if active.index != nil {
+			active.index.close()
+			active.index = nil
+		}
+		if err := removeIfExists(indexPath(active.path)); err != nil {
+			return err
+		}
+		if _, _, err := scanCommits(active.path, &l.index); err != nil {
+			return err
+		}
+		if l.index.lastEnd == 0 {
+			l.index.last = l.commit
+		}
+	}
+	l.end = l.commtEnd
+	if l.durable > l.end {
+		l.durable = l.end
+	}
+	l.rewinds++
+	return nil
+}
+
+// Durable returns the offset up to which the log is on disk, and the SCN
+// of the last commit before it, which is safe to acknowledge upstream.
+func (l *Log) Durable() (Offset, scn.SCN) {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	return l.durable, l.durCommt
+}
+
+// LastCommit returns the SCN of the last commit appended, after Open that
+// of the last commit in the log: the point to resume the stream after.
+func (l *Log) LastCommit() scn.SCN {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	return l.commit
+}
+
+// Start returns the offset of the first record kept.
+func (l *Log) Start() Offset {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	return l.segments[0].base
+}
+
+// RemoveBefore deletes the segments that end at or before off, e.g. the
+// lowest offset all consumers have read up to. The segment being appended
+// to is never removed.
+func (l *Log) RemoveBefore(off Offset) error {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	for len(l.segments) > 1 && l.segments[1].base <= off {
+		seg := &l.segments[0]
+		if seg.index != nil {
+			seg.index.close()
+			seg.index = nil
+		}
+		// without its index a segment still reads, not the other way
+		if err := removeIfExists(indexPath(seg.path)); err != nil {
+			return err
+		}
+		if err := os.Remove(seg.path); err != nil {
+			return err
+		}
+		l.segments = l.segments[1:]
+	}
+	return nil
+}
+
+// Err returns the write or sync error that stopped the log, if any.
+func (l *Log) Err() error {
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	return l.err
+}
+
+// Close makes everything appended durable and closes the log. Readers
+// waiting for records return ErrClosed.
+func (l *Log) Close() error {
+	l.mu.Lock()
+	if l.closing {
+		l.mu.Unlock()
+		return ErrClosed
+	}
+	l.closing = true
+	l.mu.Unlock()
+	close(l.stop)
+	<-l.done
+	l.mu.Lock()
+	defer l.mu.Unlock()
+	l.closed = true
+	close(l.notify)
+	l.notify = make(chan struct{})
+	for _, f := range l.retired {
+		f.Close()
+	}
+	for i := range l.segments {
+		if x := l.segments[i].index; x != nil {
+			x.close()
+		}
+	}
+	if err := l.file.Close(); l.err == nil {
+		return err
+	}
+	return l.err
+}
+
+// segmentAt returns the segment holding off and the base of the next one,
+// 0 if it is the last.
+func (l *Log) segmentAt(off Offset) (segment, Offset, error) {
+	i := sort.Search(len(l.segments), func(i int) bool { return l.segments[i].base > off }) - 1
+	if i < 0 {
+		return segment{}, 0, ErrRemoved
+	}
+	var next Offset
+	if i+1 < len(l.segments) {
+		next = l.segments[i+1].base
+	}
+	return l.segments[i], next, nil
+}
+
+// readRecord reads one record of at most max bytes, reusing buf for its
+// data, and returns it with its encoded length.
+func readRecord(r *bufio.Reader, buf []byte, max int64) (Record, int, error) {
+	var h [headerLen]byte
+	if _, err := io.ReadFull(r, h[:]); err != nil {
+		return Record{}, 0, err
+	}
+	n := int(binary.LittleEndian.Uint32(h[0:]))
+	if int64(headerLen+n) > max {
+		return Record{}, 0, ErrCorrupt
+	}
+	if cap(buf) < n {
+		buf = make([]byte, n)
+	}
+	buf = buf[:n]
+	if _, err := io.ReadFull(r, buf); err != nil {
+		return Record{}, 0, err
+	}
+	return makeRecord(h[:], buf)
+}
+
+// parseRecord is readRecord from memory; the data refers to b.
+func parseRecord(b []byte) (Record, int, error) {
+	if len(b) < headerLen {
+		return Record{}, 0, ErrCorrupt
+	}
+	n := int(binary.LittleEndian.Uint32(b))
+	if n > len(b)-headerLen {
+		return Record{}, 0, ErrCorrupt
+	}
+	return makeRecord(b[:headerLen], b[headerLen:headerLen+n:headerLen+n])
+}
+
+func makeRecord(h, data []byte) (Record, int, error) {
+	crc := crc32.Update(crc32.Checksum(h[8:], crcTable), crcTable, data)
+	if crc != binary.LittleEndian.Uint32(h[4:]) {
+		return Record{}, 0, ErrCorrupt
+	}
+	return Record{
+		SCN:    scn.SCN(binary.LittleEndian.Uint64(h[8:])),
+		Commit: h[16]&flagCommit != 0,
+		Data:   data,
+	}, headerLen + len(data), nil
+}
@@ -0,0 +1,369 @@
+package wal
+
+import (
+	"context"
+	"errors"
+	"fmt"
+	"os"
+	"path/filepath"
+	"testing"
+	"time"
+
+	"github.com/yjhatfdu/goxstream/scn"
+)
+
+func appendN(t *testing.T, l *Log, from, n int) Offset {
+	t.Helper()
+	var end Offset
+	for i := from; i < from+n; i++ {
+		var err error
+		if end, err = l.Append(scn.SCN(i), []byte(fmt.Sprintf("record %d", i)), i%3 == 2); err != nil {
+			t.Fatal(err)
+		}
+	}
+	return end
+}
+
+func readAll(t *testing.T, l *Log, from Offset) []Record {
+	t.Helper()
+	rd, err := l.NewReader(from)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer rd.Close()
+	var recs []Record
+	for {
+		ctx, cancel := context.WithTimeout(context.Background(), 20*time.Millisecond)
+		rec, err := rd.Next(ctx)
+		cancel()
+		if err == context.DeadlineExceeded {
+			return recs
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+		rec.Data = append([]byte(nil), rec.Data...)
+		recs = append(recs, rec)
+	}
+}
+
+func TestAppendRead(t *testing.T) {
+	l, err := Open(t.TempDir(), WithSegmentSize(200))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer l.Close()
+	end := appendN(t, l, 0, 30)
+	if err := l.Sync(); err != nil {
+		t.Fatal(err)
+	}
+	if d, c := l.Durable(); d != end || c != 29 {
+		t.Fatalf("durable %d %d, want %d 29", d, c, end)
+	}
+	recs := readAll(t, l, l.Start())
+	if len(recs) != 30 {
+		t.Fatalf("read %d records", len(recs))
+	}
+	for i, r := range recs {
+		if r.SCN != scn.SCN(i) || string(r.Data) != fmt.Sprintf("record %d", i) || r.Commit != (i%3 == 2) {
+			t.Fatalf("record %d: %+v", i, r)
+		}
+	}
+	if recs[29].End != end {
+		t.Fatalf("last record ends at %d, want %d", recs[29].End, end)
+	}
+	if n := len(l.segments); n < 3 {
+		t.Fatalf("%d segments, want a few", n)
+	}
+	// reading from the middle crosses segments too
+	if rest := readAll(t, l, recs[10].Offset); len(rest) != 20 || rest[0].SCN != 10 {
+		t.Fatalf("read %d records from the middle", len(rest))
+	}
+	if err := l.RemoveBefore(recs[20].Offset); err != nil {
+		t.Fatal(err)
+	}
+	if l.Start() == 0 || l.Start() > recs[20].Offset {
+		t.Fatalf("start %d after removing before %d", l.Start(), recs[20].Offset)
+	}
+	if _, err := l.NewReader(0); err != ErrRemoved {
+		t.Fatalf("reader on removed offset: %v", err)
+	}
+}
+
+func TestReaderWaitsForDurable(t *testing.T) {
+	l, err := Open(t.TempDir(), WithSyncInterval(time.Hour))
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer l.Close()
+	rd, err := l.NewReader(0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer rd.Close()
+	got := make(chan Record)
+	go func() {
+		rec, err := rd.Next(context.Background())
+		if err != nil {
+			t.Error(err)
+		}
+		got <- rec
+	}()
+	l.Append(7, []byte("x"), true)
+	select {
+	case <-got:
+		t.Fatal("record read before it was durable")
+	case <-time.After(20 * time.Millisecond):
+	}
+	if err := l.Sync(); err != nil {
+		t.Fatal(err)
+	}
+	if rec := <-got; rec.SCN != 7 {
+		t.Fatalf("read %+v", rec)
+	}
+}
+
+func TestRecoveryDropsIncompleteTransaction(t *testing.T) {
+	dir := t.TempDir()
+	l, err := Open(dir, WithSegmentSize(100))
+	if err != nil {
+		t.Fatal(err)
+	}
+	appendN(t, l, 0, 12) // commits at 2, 5, 8 and 11
+	l.Append(12, []byte("open transaction"), false)
+	l.Append(13, make([]byte, 300), false)
+	if err := l.Close(); err != nil {
+		t.Fatal(err)
+	}
+	// tear the last record
+	names, _ := filepath.Glob(filepath.Join(dir, "*.wal"))
+	last := names[len(names)-1]
+	fi, _ := os.Stat(last)
+	os.Truncate(last, fi.Size()-10)
+
+	l, err = Open(dir, WithSegmentSize(100))
+	if err != nil {
+		t.Fatal(err)
+	}
+	if c := l.LastCommit(); c != 11 {
+		t.Fatalf("last commit %d, want 11", c)
+	}
+	recs := readAll(t, l, 0)
+	if len(recs) != 12 || recs[11].SCN != 11 {
+		t.Fatalf("recovered %d records", len(recs))
+	}
+	// appending goes on where the log was cut
+	end := appendN(t, l, 12, 3)
+	l.Sync()
+	recs = readAll(t, l, 0)
+	if len(recs) != 15 || recs[14].End != end {
+		t.Fatalf("read %d records after recovery", len(recs))
+	}
+	l.Close()
+}
+
+func TestRecoveryRejectsCorruptRecord(t *testing.T) {
+	dir := t.TempDir()
+	l, err := Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	appendN(t, l, 0, 12)
+	if err := l.Close(); err != nil {
+		t.Fatal(err)
+	}
+	path := filepath.Join(dir, fmt.Sprintf("%020d.wal", 0))
+	b, _ := os.ReadFile(path)
+	good := append([]byte(nil), b...)
+
+	// a bad byte in a record that valid ones follow is not a torn tail
+	b[headerLen+3] ^= 1
+	os.WriteFile(path, b, 0644)
+	if _, err := Open(dir); !errors.Is(err, ErrCorrupt) {
+		t.Fatalf("open with a corrupt record: %v", err)
+	}
+	if fi, _ := os.Stat(path); fi.Size() != int64(len(good)) {
+		t.Fatal("corrupt log was cut")
+	}
+
+	// garbage after the last record is
+	os.WriteFile(path, append(good, 0xff, 0, 0, 0, 1, 2, 3), 0644)
+	if l, err = Open(dir); err != nil {
+		t.Fatal(err)
+	}
+	if c := l.LastCommit(); c != 11 {
+		t.Fatalf("last commit %d, want 11", c)
+	}
+	l.Close()
+}
+
+func TestRewind(t *testing.T) {
+	dir := t.TempDir()
+	l, err := Open(dir, WithSegmentSize(100))
+	if err != nil {
+		t.Fatal(err)
+	}
+	end := appendN(t, l, 0, 6) // commits at 2 and 5
+	rd, err := l.NewReader(0)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer rd.Close()
+	// a transaction running over several segments, durable but not
+	// visible to readers
+	for i := 6; i < 12; i++ {
+		l.Append(scn.SCN(i), make([]byte, 40), false)
+	}
+	l.Sync()
+	segments := len(l.segments)
+	var recs []Record
+	for {
+		ctx, cancel := context.WithTimeout(context.Background(), 20*time.Millisecond)
+		rec, err := rd.Next(ctx)
+		cancel()
+		if err != nil {
+			break
+		}
+		recs = append(recs, rec)
+	}
+	if len(recs) != 6 || recs[5].End != end {
+		t.Fatalf("read %d records before the commit", len(recs))
+	}
+
+	if err := l.Rewind(); err != nil {
+		t.Fatal(err)
+	}
+	if len(l.segments) >= segments {
+		t.Fatalf("%d segments after rewind, %d before", len(l.segments), segments)
+	}
+	if d, c := l.Durable(); d != end || c != 5 {
+		t.Fatalf("durable %d %d after rewind, want %d 5", d, c, end)
+	}
+	end = appendN(t, l, 6, 6)
+	l.Sync()
+	// the reader goes on with the records appended after the rewind
+	for i := 6; i < 12; i++ {
+		rec, err := rd.Next(context.Background())
+		if err != nil {
+			t.Fatal(err)
+		}
+		if rec.SCN != scn.SCN(i) || string(rec.Data) != fmt.Sprintf("record %d", i) {
+			t.Fatalf("record %d after rewind: %+v", i, rec)
+		}
+	}
+	l.Close()
+
+	if l, err = Open(dir, WithSegmentSize(100)); err != nil {
+		t.Fatal(err)
+	}
+	defer l.Close()
+	if recs = readAll(t, l, 0); len(recs) != 12 || recs[11].End != end {
+		t.Fatalf("read %d records after reopening", len(recs))
+	}
+	if off, err := l.Seek(8); err != nil || off != recs[8].End {
+		t.Fatalf("seek after rewind: %d %v, want %d", off, err, recs[8].End)
+	}
+}
+
+func TestSeek(t *testing.T) {
+	dir := t.TempDir()
+	opts := []Option{WithSegmentSize(1000), WithIndexInterval(100)}
+	l, err := Open(dir, opts...)
+	if err != nil {
+		t.Fatal(err)
+	}
+	// transactions of 1 to 4 records committing at SCNs 10, 20, ...,
+	// with row SCNs out of order
+	after := map[scn.SCN]Offset{}
+	for c := scn.SCN(10); c <= 3000; c += 10 {
+		for i := 0; i < int(c/10)%4; i++ {
+			l.Append(c-scn.SCN(i)-1, []byte("row"), false)
+		}
+		end, err := l.Append(c, []byte("commit"), true)
+		if err != nil {
+			t.Fatal(err)
+		}
+		after[c] = end
+	}
+	l.Append(3005, []byte("open transaction"), false)
+	if err := l.Sync(); err != nil {
+		t.Fatal(err)
+	}
+	check := func() {
+		t.Helper()
+		for s := scn.SCN(0); s <= 3010; s += 3 {
+			off, err := l.Seek(s)
+			if err != nil {
+				t.Fatal(err)
+			}
+			want := after[s/10*10]
+			if off != want {
+				t.Fatalf("seek %d: %d, want %d", s, off, want)
+			}
+			if s >= 10 && s < 3000 {
+				rd, _ := l.NewReader(off)
+				rec, _ := rd.Next(context.Background())
+				rd.Close()
+				if next := s/10*10 + 10; rec.SCN > next || rec.SCN < next-3 {
+					t.Fatalf("seek %d: read SCN %d", s, rec.SCN)
+				}
+			}
+		}
+	}
+	check()
+	if n := len(l.segments); n < 5 {
+		t.Fatalf("%d segments, want a few", n)
+	}
+	l.Close()
+
+	// indexes are loaded from their files or rebuilt if they do not match
+	names, _ := filepath.Glob(filepath.Join(dir, "*"+indexSuffix))
+	if len(names) < 4 {
+		t.Fatalf("%d index files", len(names))
+	}
+	os.Remove(names[1])
+	os.WriteFile(names[2], []byte("WIX1 and some garbage..."), 0644)
+	if l, err = Open(dir, opts...); err != nil {
+		t.Fatal(err)
+	}
+	check()
+	if _, err := os.Stat(names[1]); err != nil {
+		t.Fatal("index not rewritten:", err)
+	}
+
+	if err := l.RemoveBefore(after[1500]); err != nil {
+		t.Fatal(err)
+	}
+	if _, err := l.Seek(20); err != ErrRemoved {
+		t.Fatalf("seek before the start: %v", err)
+	}
+	if off, err := l.Seek(2500); err != nil || off != after[2500] {
+		t.Fatalf("seek after removing: %d %v", off, err)
+	}
+	l.Close()
+}
+
+func TestConcurrentClose(t *testing.T) {
+	l, err := Open(t.TempDir())
+	if err != nil {
+		t.Fatal(err)
+	}
+	appendN(t, l, 0, 3)
+	errs := make(chan error, 4)
+	for i := 0; i < cap(errs); i++ {
+		go func() { errs <- l.Close() }()
+	}
+	closed := 0
+	for i := 0; i < cap(errs); i++ {
+		switch err := <-errs; err {
+		case nil:
+			closed++
+		case ErrClosed:
+		default:
+			t.Fatal(err)
+		}
+	}
+	if closed != 1 {
+		t.Fatalf("%d Close calls succeeded", closed)
+	}
+}
@@ -4,19 +4,22 @@ package goxstream
 // #cgo LDFLAGS: -LC:/oracle/instantclient_19_12 -loci
 ////-locijdbc19 -lorannzsbb19 -loraocci19 -loraocci19d -loraociei19 -loraons -lociw32
 /* #
-#include "xstrm.c"
+#include "xstrm.h"
 */
 import "C"
 import (
+	"bytes"
+	"context"
 	"fmt"
 	"github.com/chai2010/cgo"
+	"github.com/yjhatfdu/goxstream/avro"
+	"github.com/yjhatfdu/goxstream/charset"
+	"github.com/yjhatfdu/goxstream/jsonenc"
+	"github.com/yjhatfdu/goxstream/oraBinary"
+	"github.com/yjhatfdu/goxstream/oraTime"
 	"github.com/yjhatfdu/goxstream/scn"
-	"golang.org/x/text/encoding/simplifiedchinese"
-	"golang.org/x/text/encoding/unicode"
-	"log"
 	"reflect"
 	"time"
-	"unicode/utf16"
 	"unsafe"
 )
 
@@ -27,31 +30,6 @@ const (
 	V2 = 2
 )
 
-var decoders = map[int]func(b []byte) (string, error){}
-
-func init() {
-	decoders[2000] = func(b []byte) (string, error) {
-		buf := make([]uint16, len(b)/2)
-		for i := range buf {
-			buf[i] = uint16(b[2*i]) + uint16(b[2*i+1])<<8
-		}
-		return string(utf16.Decode(buf)), nil
-	}
-	gbkDecoder := simplifiedchinese.GBK.NewDecoder()
-	decoders[852] = func(b []byte) (string, error) {
-		s, err := gbkDecoder.Bytes(b)
-		return string(s), err
-	}
-	decoders[0] = func(b []byte) (string, error) {
-		return string(b), nil
-	}
-	utf8Decoder := unicode.UTF8.NewDecoder()
-	decoders[873] = func(b []byte) (string, error) {
-		s, err := utf8Decoder.Bytes(b)
-		return string(s), err
-	}
-}
-
 func toOciStr(s string) (*C.uchar, C.uint, func()) {
 	uchars := cgo.NewUInt8N(len(s))
 	l := uint32(len(s))
@@ -67,9 +45,23 @@ type XStreamConn struct {
 	csid     int
 	ncsid    int
 	lcridVer OCI_LCRID_VERSION
+	lcrMem   MemStats
+	opts     *options
+	dec      charset.Decoder
+	scratch  []byte
+	thread   *osThread
+	startup  StartupTiming
+	lag      *lagTracker
+	metrics  *connMetrics
+	labels   map[tableKey]context.Context
+	brk      breaker
+	hbPos    []byte // position of the last heartbeat, shared while it repeats
+	keys     *keyCache
+	json     *jsonWriter
+	avro     *avroWriter
 }
 
-func Open(username, password, dbname, servername string, oracleVer int) (*XStreamConn, error) {
+func open(username, password, dbname, servername string, oracleVer int, o *options) (*XStreamConn, error) {
 	var info C.struct_conn_info
 	usernames, usernamel, free := toOciStr(username)
 	defer free()
@@ -87,19 +79,60 @@ func Open(username, password, dbname, servername string, oracleVer int) (*XStrea
 	defer free4()
 	info.svrnm = svrs
 	info.svrnmlen = svrl
+	start := time.Now()
+	timing := StartupTiming{Logons: 1}
+	key := charsetKey(username, dbname)
 	var oci *C.struct_oci
 	var char_csid, nchar_csid C.ushort
-	C.get_db_charsets(&info, &char_csid, &nchar_csid)
-	C.connect_db(&info, &oci, char_csid, nchar_csid)
-	r := C.attach0(oci, &info, C.int(1))
-	if int(r) != 0 {
-		errstr, errcode, err := getErrorEnc(oci.errp, int(char_csid))
+	var err error
+	if o.csid != 0 {
+		char_csid, nchar_csid = C.ushort(o.csid), C.ushort(o.ncsid)
+		timing.CharsetSource = CharsetExplicit
+	} else if cs, ncs, ok := cachedCharsets(key); ok {
+		char_csid, nchar_csid = cs, ncs
+		timing.CharsetSource = CharsetCached
+	} else {
+		// log on in the client charsets and ask the session itself; keep
+		// it when its environment already matches the database
+		t := time.Now()
+		if oci, err = connect(&info, 0, 0, o); err != nil {
+			return nil, err
+		}
+		timing.Logon = time.Since(t)
+		t = time.Now()
+		var reuse bool
+		char_csid, nchar_csid, reuse, err = discoverCharsets(oci, key)
+		timing.Discovery = time.Since(t)
 		if err != nil {
-			return nil, fmt.Errorf("failed to parse oci error after calling Open function failed: %s", err.Error())
+			freeOci(oci)
+			return nil, err
+		}
+		if reuse {
+			timing.CharsetSource = CharsetSession
+		} else {
+			timing.CharsetSource = CharsetQueried
+			timing.Logons = 2
+			freeOci(oci)
+			oci = nil
 		}
-		return nil, fmt.Errorf("attach to XStream server specified in connection info failed, code:%d, %s", errcode, errstr)
 	}
-
+	dec, err := charset.Lookup(int(char_csid))
+	if err != nil {
+		if oci != nil {
+			freeOci(oci)
+		}
+		return nil, err
+	}
+	if o.trustText && (char_csid == charset.AL32UTF8 || char_csid == charset.UTF8) {
+		dec = charset.Passthrough()
+	}
+	if oci == nil {
+		t := time.Now()
+		if oci, err = connect(&info, char_csid, nchar_csid, o); err != nil {
+			return nil, err
+		}
+		timing.Logon += time.Since(t)
+	}
 	var version OCI_LCRID_VERSION
 	if oracleVer >= 12 {
 		version = V2
@@ -107,19 +140,139 @@ func Open(username, password, dbname, servername string, oracleVer int) (*XStrea
 		version = V1
 	}
 
-	return &XStreamConn{
+	x := &XStreamConn{
 		ocip:     oci,
 		csid:     int(char_csid),
 		ncsid:    int(nchar_csid),
 		lcridVer: version,
-	}, nil
+		opts:     o,
+		dec:      dec,
+		lag:      newLagTracker(),
+	}
+	if o.registry != nil {
+		x.metrics = newConnMetrics(servername, o.connLabel)
+	}
+	if o.profile {
+		enableProfiling(oci)
+	}
+	if o.resumeSCN != 0 || o.resumePos != nil {
+		pos := o.resumePos
+		if pos == nil {
+			p, l, err := x.scn2pos(oci, o.resumeSCN)
+			if err != nil {
+				freeOci(oci)
+				return nil, err
+			}
+			pos = C.GoBytes(unsafe.Pointer(p), C.int(l))
+		}
+		if err := setResumePosition(oci, pos); err != nil {
+			freeOci(oci)
+			return nil, err
+		}
+	}
+	if o.rowKeys {
+		if x.keys, err = newKeyCache(&info, char_csid, nchar_csid, o); err != nil {
+			freeOci(oci)
+			return nil, err
+		}
+	}
+	if o.json {
+		x.json = newJSONWriter()
+	}
+	if o.avro {
+		x.avro = newAvroWriter()
+	}
+	t := time.Now()
+	r := C.attach0(oci, &info, C.int(1))
+	timing.Attach = time.Since(t)
+	if int(r) != 0 {
+		errstr, errcode, err := getErrorEnc(oci.errp, int(char_csid))
+		if x.keys != nil {
+			x.keys.close()
+		}
+		freeOci(oci)
+		if err != nil {
+			return nil, fmt.Errorf("failed to parse oci error after calling Open function failed: %s", err.Error())
+		}
+		return nil, &OCIError{Op: "attach to XStream server specified in connection info", Code: int(errcode), Message: errstr}
+	}
+
+	timing.Total = time.Since(start)
+	x.startup = timing
+	if o.registry != nil {
+		o.registry.Register(x)
+	}
+	return x, nil
 }
 
-func (x *XStreamConn) Close() error {
+func (x *XStreamConn) close() error {
+	if x.opts.registry != nil {
+		x.opts.registry.Unregister(x)
+	}
+	var err error
+	x.ocip.status = C.OCI_SUCCESS
 	C.detach(x.ocip)
-	C.disconnect_db(x.ocip)
-	C.free(unsafe.Pointer(x.ocip))
-	return nil
+	if x.ocip.status != C.OCI_SUCCESS {
+		err = ociError("OCIXStreamOutDetach", x.ocip.errp)
+	}
+	if x.keys != nil {
+		x.keys.close()
+	}
+	freeOci(x.ocip)
+	return err
+}
+
+// ArenaStats reports the usage of the C-side arena that backs row and
+// column descriptors while an LCR is being decoded.
+func (x *XStreamConn) ArenaStats() ArenaStats {
+	a := &x.ocip.arena
+	return ArenaStats{
+		HighWater: int(a.hwm),
+		Capacity:  int(a.cap),
+		Grows:     int(a.grows),
+	}
+}
+
+// MemStats reports the allocations OCI made through the pooled allocator.
+func (x *XStreamConn) MemStats() MemStats {
+	st := x.lcrMem
+	if p := x.ocip.pool; p != nil {
+		st.Allocs = uint64(p.allocs)
+		st.Frees = uint64(p.frees)
+		st.PoolHits = uint64(p.hits)
+		st.Bytes = uint64(p.bytes)
+		st.InUse = uint64(p.in_use)
+	}
+	return st
+}
+
+// lcrMemMark samples the pool counters before an LCR is received.
+func (x *XStreamConn) lcrMemMark() (allocs, bytes C.oraub8) {
+	if p := x.ocip.pool; p != nil {
+		return p.allocs, p.bytes
+	}
+	return 0, 0
+}
+
+// lcrMemDone accounts the allocations made since lcrMemMark to one LCR.
+func (x *XStreamConn) lcrMemDone(allocs, bytes C.oraub8) {
+	p := x.ocip.pool
+	if p == nil {
+		return
+	}
+	st := &x.lcrMem
+	st.LastLCRAllocs = uint64(p.allocs - allocs)
+	st.LastLCRBytes = uint64(p.bytes - bytes)
+	st.LCRs++
+	st.LCRAllocs += st.LastLCRAllocs
+	st.LCRBytes += st.LastLCRBytes
+}
+
+func cBool(b bool) C.boolean {
+	if b {
+		return C.TRUE
+	}
+	return C.FALSE
 }
 
 func ociNumberToInt(errp *C.OCIError, number *C.OCINumber) int64 {
@@ -141,47 +294,86 @@ func ToCUCharString(str string) (*C.uchar, C.ushort, func()) {
 	}
 }
 
-func (x *XStreamConn) SetSCNLwm(s scn.SCN) error {
-	pos, posl := x.scn2pos(x.ocip, s)
-	defer pos.Free()
-	status := C.OCIXStreamOutProcessedLWMSet(x.ocip.svcp, x.ocip.errp, (*C.ub1)(pos), posl, C.OCI_DEFAULT)
+func (x *XStreamConn) setSCNLwm(s scn.SCN) error {
+	pos, posl, err := x.scn2pos(x.ocip, s)
+	if err != nil {
+		return err
+	}
+	status := C.OCIXStreamOutProcessedLWMSet(x.ocip.svcp, x.ocip.errp, pos, posl, C.OCI_DEFAULT)
 	if status == C.OCI_ERROR {
-		errstr, errcode := getError(x.ocip.errp)
-		return fmt.Errorf("set position lwm failed, code:%d, %s", errcode, errstr)
+		return ociError("set position lwm", x.ocip.errp)
 	}
+	x.lag.acked(s, time.Now())
 	return nil
 }
 
-func (x *XStreamConn) GetRecord() (Message, error) {
-	var lcr = unsafe.Pointer(nil)
-	var lcrtype C.ub1
-	var flag C.oraub8
-	var fetchlwm = cgo.NewUInt8N(C.OCI_LCR_MAX_POSITION_LEN)
-	defer fetchlwm.Free()
-	var fetchlwm_len C.ushort
-	status := C.OCIXStreamOutLCRReceive(x.ocip.svcp, x.ocip.errp, &lcr, &lcrtype,
-		&flag, (*C.ub1)(fetchlwm), &fetchlwm_len, C.OCI_DEFAULT)
+func (x *XStreamConn) getRecord() (Message, error) {
+	memAllocs, memBytes := x.lcrMemMark()
+	t := x.metrics.start()
+	status, err := x.receive()
+	x.metrics.stage(stageReceive, t)
+	lcr, flag := x.ocip.lcrp, x.ocip.lcr_flag
+	if err != nil {
+		x.metrics.failed()
+		if status == C.OCI_STILL_EXECUTING || status == C.OCI_SUCCESS {
+			x.freeLcr()
+		}
+		C.lcr_arena_reset(&x.ocip.arena)
+		return nil, err
+	}
 	if status == C.OCI_STILL_EXECUTING {
 		msg, err := x.getLcrRecords(x.ocip, lcr, x.csid, x.ncsid)
 		if err != nil {
-			return nil, fmt.Errorf("failed to call getLcrRecords function %s", err.Error())
+			x.metrics.failed()
+			x.freeLcr()
+			C.lcr_arena_reset(&x.ocip.arena)
+			return nil, fmt.Errorf("failed to call getLcrRecords function: %w", err)
 		}
 
+		t = x.metrics.start()
 		/* If LCR has chunked columns (i.e, has LOB/Long/XMLType columns) */
-		if flag != 0 && C.OCI_XSTREAM_MORE_ROW_DATA != 0 {
+		if flag&C.OCI_XSTREAM_MORE_ROW_DATA != 0 {
+			chunks, chunkBytes := x.ocip.chunks, x.ocip.chunk_bytes
+			x.ocip.status = C.OCI_SUCCESS
 			C.travel_chunks(x.ocip)
+			x.metrics.addChunks(uint64(x.ocip.chunks-chunks), uint64(x.ocip.chunk_bytes-chunkBytes))
+			if x.ocip.status != C.OCI_SUCCESS {
+				x.metrics.failed()
+				err = ociError("OCIXStreamOutChunkReceive", x.ocip.errp)
+				x.freeLcr()
+				C.lcr_arena_reset(&x.ocip.arena)
+				return nil, err
+			}
 		}
 
-		C.OCILCRFree(x.ocip.svcp, x.ocip.errp, lcr, C.OCI_DEFAULT)
+		x.freeLcr()
+		C.lcr_arena_reset(&x.ocip.arena)
+		x.metrics.stage(stageFree, t)
+		x.lcrMemDone(memAllocs, memBytes)
+		x.metrics.received(msg)
+		if msg != nil {
+			x.lag.received(msg, time.Now())
+		}
 		return msg, nil
 	}
 	if status == C.OCI_ERROR {
-		errstr, errcode := getError(x.ocip.errp)
-		return nil, fmt.Errorf("OCIXStreamOutLCRReceive failed, code:%d, %s", errcode, errstr)
+		x.metrics.failed()
+		return nil, ociError("OCIXStreamOutLCRReceive", x.ocip.errp)
 	} else { // status == C.SUCCESS
-		s := x.pos2SCN(x.ocip, (*C.ub1)(fetchlwm), fetchlwm_len)
-		C.OCILCRFree(x.ocip.svcp, x.ocip.errp, lcr, C.OCI_DEFAULT)
-		return &HeartBeat{SCN: s}, nil
+		s, err := x.pos2SCN(x.ocip, &x.ocip.fetchlwm[0], x.ocip.fetchlwm_len)
+		x.freeLcr()
+		if err != nil {
+			x.metrics.failed()
+			return nil, err
+		}
+		// an idle stream repeats the same fetch LWM, so heartbeats share it
+		if pos := byteView(unsafe.Pointer(&x.ocip.fetchlwm[0]), x.ocip.fetchlwm_len); !bytes.Equal(pos, x.hbPos) {
+			x.hbPos = tobytes(&x.ocip.fetchlwm[0], x.ocip.fetchlwm_len)
+		}
+		hb := &HeartBeat{SCN: s, Position: x.hbPos}
+		x.metrics.received(hb)
+		x.lag.received(hb, time.Time{})
+		return hb, nil
 	}
 }
 
@@ -201,8 +393,8 @@ func (conn *XStreamConn) getColumnChunkData(owner string) (map[string]interface{
 		&col_flags, &col_csid, &chunk_len,
 		&chunk_ptr, &row_flag, C.OCI_DEFAULT)
 	for status == C.OCI_SUCCESS {
-		column, _ := toStringEnc(colname, C.ushort(colname_len), conn.csid)
-		s, err := toStringEnc(chunk_ptr, C.ushort(chunk_len), conn.csid)
+		column, _ := conn.decodeString(colname, C.ushort(colname_len), conn.csid)
+		s, err := conn.decodeString(chunk_ptr, C.ushort(chunk_len), conn.csid)
 		if err != nil {
 			return nil, err
 		}
@@ -225,18 +417,37 @@ func tostring(p *C.uchar, l C.ushort) string {
 }
 
 func toStringEnc(p *C.uchar, l C.ushort, codepage int) (string, error) {
-	b := *(*[]byte)((unsafe.Pointer)(&reflect.SliceHeader{
-		Data: uintptr(unsafe.Pointer(p)),
+	dec, err := charset.Lookup(codepage)
+	if err != nil {
+		return "", err
+	}
+	s, _, err := charset.String(dec, byteView(unsafe.Pointer(p), l), nil)
+	return s, err
+}
+
+// decodeString converts text in csid to a string, reusing the connection's
+// decoder and scratch buffer.
+func (x *XStreamConn) decodeString(p *C.uchar, l C.ushort, csid int) (string, error) {
+	dec := x.dec
+	if csid != x.csid {
+		var err error
+		if dec, err = charset.Lookup(csid); err != nil {
+			return "", err
+		}
+	}
+	s, scratch, err := charset.String(dec, byteView(unsafe.Pointer(p), l), x.scratch)
+	x.scratch = scratch
+	return s, err
+}
+
+// byteView returns a slice over C memory without copying; it is only valid
+// until the LCR it points into is freed.
+func byteView(p unsafe.Pointer, l C.ushort) []byte {
+	return *(*[]byte)((unsafe.Pointer)(&reflect.SliceHeader{
+		Data: uintptr(p),
 		Len:  int(uint16(l)),
 		Cap:  int(uint16(l)),
 	}))
-	dec := decoders[codepage]
-	if dec == nil {
-		log.Panicf("code page %d not defined", codepage)
-	} else {
-		return dec(b)
-	}
-	return "", nil
 }
 
 func tobytes(p *C.uchar, l C.ushort) []byte {
@@ -259,6 +470,7 @@ func (x *XStreamConn) getLcrRecords(ocip *C.struct_oci, lcr unsafe.Pointer, csid
 	var ltagl, lposl, oldCount, newCount C.ub2
 	var dummy C.oraub8
 	var t C.OCIDate
+	start := x.metrics.start()
 	ret = C.OCILCRHeaderGet(ocip.svcp, ocip.errp,
 		src_db_name, src_db_name_l, &cmd_type, &cmd_type_len,
 		&owner, &ownerl, &oname, &onamel, &ltag, &ltagl, &txid, &txidl,
@@ -266,41 +478,101 @@ func (x *XStreamConn) getLcrRecords(ocip *C.struct_oci, lcr unsafe.Pointer, csid
 		&lpos, &lposl, &dummy, lcr,
 		C.OCI_DEFAULT)
 	if ret != C.OCI_SUCCESS {
-		C.ocierror(ocip, C.CString("OCILCRHeaderGet failed"))
+		return nil, ociError("OCILCRHeaderGet", ocip.errp)
 	} else {
 		cmd := tostring(cmd_type, cmd_type_len)
-		s := x.pos2SCN(ocip, lpos, lposl)
+		s, err := x.pos2SCN(ocip, lpos, lposl)
+		if err != nil {
+			return nil, err
+		}
+		src := x.sourceTime(&t)
+		if x.keys != nil && ocip.lcrtype == C.OCI_LCR_XDDL {
+			table, err := x.decodeString(oname, onamel, csid)
+			if err != nil {
+				return nil, err
+			}
+			x.keys.invalidate(tostring(owner, ownerl), table)
+		}
+		x.metrics.stage(stageHeader, start)
 		switch cmd {
 		case "COMMIT":
-			m := Commit{SCN: s}
+			m := Commit{SCN: s, SourceTime: src, Position: tobytes(lpos, lposl)}
 			return &m, nil
 		case "DELETE":
-			stringEnc, err := toStringEnc(oname, onamel, csid)
+			stringEnc, err := x.decodeString(oname, onamel, csid)
+			if err != nil {
+				return nil, err
+			}
+			m := Delete{SCN: s, SourceTime: src, Table: stringEnc, Owner: tostring(owner, ownerl)}
+			defer x.labelTable(m.Owner, m.Table)()
+			key, err := x.rowKey(m.Owner, m.Table)
 			if err != nil {
 				return nil, err
 			}
-			m := Delete{SCN: s, Table: stringEnc, Owner: tostring(owner, ownerl)}
-			m.OldColumn, m.OldRow, err = getLcrRowData(ocip, lcr, valueTypeOld, csid, ncsid, m.Owner+"."+m.Table)
+			x.json.begin(jsonenc.Delete, s, m.Owner, m.Table)
+			x.avro.begin(avro.Delete, s, m.Owner, m.Table)
+			m.OldColumn, m.OldRow, err = x.getLcrRowData(ocip, lcr, valueTypeOld, csid, ncsid, m.Owner+"."+m.Table, key)
+			if key != nil {
+				m.Key = x.keys.key()
+			}
+			m.JSON = x.json.end()
+			if err == nil {
+				m.Avro, m.AvroSchema, err = x.avroEvent()
+			}
 			return &m, err
 		case "INSERT":
-			stringEnc, err := toStringEnc(oname, onamel, csid)
+			stringEnc, err := x.decodeString(oname, onamel, csid)
+			if err != nil {
+				return nil, err
+			}
+			m := Insert{SCN: s, SourceTime: src, Table: stringEnc, Owner: tostring(owner, ownerl)}
+			defer x.labelTable(m.Owner, m.Table)()
+			key, err := x.rowKey(m.Owner, m.Table)
 			if err != nil {
 				return nil, err
 			}
-			m := Insert{SCN: s, Table: stringEnc, Owner: tostring(owner, ownerl)}
-			m.NewColumn, m.NewRow, err = getLcrRowData(ocip, lcr, valueTypeNew, csid, ncsid, m.Owner+"."+m.Table)
+			x.json.begin(jsonenc.Insert, s, m.Owner, m.Table)
+			x.avro.begin(avro.Insert, s, m.Owner, m.Table)
+			m.NewColumn, m.NewRow, err = x.getLcrRowData(ocip, lcr, valueTypeNew, csid, ncsid, m.Owner+"."+m.Table, key)
+			if key != nil {
+				m.Key = x.keys.key()
+			}
+			m.JSON = x.json.end()
+			if err == nil {
+				m.Avro, m.AvroSchema, err = x.avroEvent()
+			}
 			return &m, err
 		case "UPDATE":
-			stringEnc, err := toStringEnc(oname, onamel, csid)
+			stringEnc, err := x.decodeString(oname, onamel, csid)
 			if err != nil {
 				return nil, err
 			}
-			m := Update{SCN: s, Table: stringEnc, Owner: tostring(owner, ownerl)}
-			m.OldColumn, m.OldRow, err = getLcrRowData(ocip, lcr, valueTypeOld, csid, ncsid, m.Owner+"."+m.Table)
+			m := Update{SCN: s, SourceTime: src, Table: stringEnc, Owner: tostring(owner, ownerl)}
+			defer x.labelTable(m.Owner, m.Table)()
+			key, err := x.rowKey(m.Owner, m.Table)
 			if err != nil {
 				return nil, err
 			}
-			m.NewColumn, m.NewRow, err = getLcrRowData(ocip, lcr, valueTypeNew, csid, ncsid, m.Owner+"."+m.Table)
+			x.json.begin(jsonenc.Update, s, m.Owner, m.Table)
+			x.avro.begin(avro.Update, s, m.Owner, m.Table)
+			m.OldColumn, m.OldRow, err = x.getLcrRowData(ocip, lcr, valueTypeOld, csid, ncsid, m.Owner+"."+m.Table, key)
+			if err != nil {
+				return nil, err
+			}
+			if key != nil {
+				m.Key = x.keys.key()
+			}
+			// new values of key columns replace the old ones
+			m.NewColumn, m.NewRow, err = x.getLcrRowData(ocip, lcr, valueTypeNew, csid, ncsid, m.Owner+"."+m.Table, key)
+			if key != nil && err == nil {
+				if k := x.keys.key(); !bytes.Equal(k, m.Key) {
+					m.NewKey = k
+				}
+			}
+			m.JSON = x.json.end()
+			if err == nil {
+				m.Avro, m.AvroSchema, err = x.avroEvent()
+			}
 			return &m, err
 		}
 	}
@@ -323,17 +595,24 @@ type columnInfo struct {
 	flags     *C.oraub8
 }
 
-func getLcrRowData(ocip *C.struct_oci, lcrp unsafe.Pointer, valueType valueType, csid, ncsid int, owner string) ([]string, []interface{}, error) {
+func (x *XStreamConn) getLcrRowData(ocip *C.struct_oci, lcrp unsafe.Pointer, valueType valueType, csid, ncsid int, owner string, key *keyDef) ([]string, []interface{}, error) {
 	var row *C.oci_lcr_row_t
 	var column_length C.ub2
+	t := x.metrics.start()
 	status := C.get_lcr_row_data(ocip, lcrp, C.ub2(valueType), &row, &column_length)
+	t = x.metrics.stage(stageColumns, t)
 	if status != C.OCI_SUCCESS {
-		errstr, errcode := getError(ocip.errp)
-		return nil, nil, fmt.Errorf("get_lcr_row_data failed, code:%d, %s", errcode, errstr)
+		return nil, nil, ociError("get_lcr_row_data", ocip.errp)
 	} else {
+		if x.json != nil || x.avro != nil {
+			err := x.encodeRow(ocip, row, column_length, valueType, csid, key)
+			x.metrics.stage(stageDecode, t)
+			return nil, nil, err
+		}
 		if status == C.OCI_SUCCESS {
 			columnNames := make([]string, 0)
 			columnValues := make([]interface{}, 0)
+			var raw []byte
 
 			for i := 0; i < int(column_length); i++ {
 				var column_name *C.char
@@ -344,47 +623,54 @@ func getLcrRowData(ocip *C.struct_oci, lcrp unsafe.Pointer, valueType valueType,
 				var column_data_type C.ub2
 				status = C.iterate_row_data(ocip, row, C.ub2(i), &column_name, &column_name_len, &column_value, &column_value_len, &column_csid, &column_data_type)
 				if status != C.OCI_SUCCESS {
-					errstr, errcode := getError(ocip.errp)
-					return nil, nil, fmt.Errorf("iterate_row_data failed, code:%d, %s", errcode, errstr)
+					return nil, nil, ociError("iterate_row_data", ocip.errp)
 				}
 
 				columnNames = append(columnNames, tostring((*C.uchar)(unsafe.Pointer(column_name)), column_name_len))
+				if key != nil {
+					if k, ok := key.index[columnNames[i]]; ok {
+						if err := x.keys.set(k, column_value, column_value_len, column_data_type); err != nil {
+							return nil, nil, err
+						}
+					}
+				}
+				x.metrics.addRowBytes(int(column_value_len))
 
 				csid_l := int(column_csid)
 				if csid_l == 0 {
 					csid_l = csid
 				}
-				colValue := value2interface(ocip.errp, (*C.void)(column_value), column_value_len, csid_l, column_data_type)
+				colValue, err := x.value2interface(ocip.errp, (*C.void)(column_value), column_value_len, csid_l, column_data_type, &raw)
+				if err != nil {
+					return nil, nil, err
+				}
 				columnValues = append(columnValues, colValue)
 			}
+			x.metrics.stage(stageDecode, t)
 
-			C.free_lcr_row_data(row)
 			return columnNames, columnValues, nil
 		} else {
-			errstr, errcode := getError(ocip.errp)
-			return nil, nil, fmt.Errorf("get_lcr_row_data failed, code:%d, %s", errcode, errstr)
+			return nil, nil, ociError("get_lcr_row_data", ocip.errp)
 		}
 	}
 }
 
-func value2interface(errp *C.OCIError, valuep *C.void, valuelen C.ub2, csid int, dtype C.ub2) interface{} {
+// value2interface converts one column value. RAW values are copied into
+// *raw, a slab shared by the row, and returned as views into it.
+func (x *XStreamConn) value2interface(errp *C.OCIError, valuep *C.void, valuelen C.ub2, csid int, dtype C.ub2, raw *[]byte) (interface{}, error) {
 	if valuelen == 0 {
-		return nil
+		return nil, nil
 	}
 	switch dtype {
 	//todo support more types
 	case C.SQLT_CHR, C.SQLT_AFC:
-		val, err := toStringEnc((*C.uchar)(unsafe.Pointer(valuep)), valuelen, int(csid))
-		if err != nil {
-			panic(err)
-		}
-		return val
+		return x.decodeString((*C.uchar)(unsafe.Pointer(valuep)), valuelen, csid)
 	case C.SQLT_VNU:
 		v := (*C.OCINumber)(unsafe.Pointer(valuep))
 		if v == nil {
-			return nil
+			return nil, nil
 		}
-		return ociNumberToInt(errp, v)
+		return ociNumberToInt(errp, v), nil
 	case C.SQLT_ODT:
 		v := (*C.OCIDate)(unsafe.Pointer(valuep))
 		yy := int16(v.OCIDateYYYY)
@@ -394,9 +680,47 @@ func value2interface(errp *C.OCIError, valuep *C.void, valuelen C.ub2, csid int,
 		hh := uint8(dt.OCITimeHH)
 		min := uint8(dt.OCITimeMI)
 		ss := uint8(dt.OCITimeSS)
-		return time.Date(int(yy), time.Month(mm), int(dd), int(hh), int(min), int(ss), 0, time.Local)
+		if x.opts.epochMicros {
+			return oraTime.DateMicros(int(yy), int(mm), int(dd), int(hh), int(min), int(ss)), nil
+		}
+		return time.Date(int(yy), time.Month(mm), int(dd), int(hh), int(min), int(ss), 0, x.opts.location), nil
+	case C.SQLT_TIMESTAMP, C.SQLT_TIMESTAMP_TZ, C.SQLT_TIMESTAMP_LTZ:
+		ts, err := oraTime.ParseTimestamp(byteView(unsafe.Pointer(valuep), valuelen))
+		if err != nil {
+			return nil, err
+		}
+		if x.opts.epochMicros {
+			return ts.UnixMicros(), nil
+		}
+		if dtype == C.SQLT_TIMESTAMP {
+			return time.Date(ts.Year, time.Month(ts.Month), ts.Day, ts.Hour, ts.Minute, ts.Second, ts.Nanos, x.opts.location), nil
+		}
+		return ts.Time(), nil
+	case C.SQLT_INTERVAL_YM:
+		return oraTime.DecodeIntervalYM(byteView(unsafe.Pointer(valuep), valuelen))
+	case C.SQLT_INTERVAL_DS:
+		return oraTime.DecodeIntervalDS(byteView(unsafe.Pointer(valuep), valuelen))
+	case C.SQLT_BIN:
+		start := len(*raw)
+		*raw = append(*raw, byteView(unsafe.Pointer(valuep), valuelen)...)
+		return (*raw)[start:len(*raw):len(*raw)], nil
+	case C.SQLT_BFLOAT:
+		return *(*float32)(unsafe.Pointer(valuep)), nil
+	case C.SQLT_BDOUBLE:
+		return *(*float64)(unsafe.Pointer(valuep)), nil
+	case C.SQLT_IBFLOAT:
+		return oraBinary.Float32(byteView(unsafe.Pointer(valuep), valuelen))
+	case C.SQLT_IBDOUBLE:
+		return oraBinary.Float64(byteView(unsafe.Pointer(valuep), valuelen))
+	case C.SQLT_RDD:
+		b := byteView(unsafe.Pointer(valuep), valuelen)
+		if r, err := oraBinary.ParseRowid(b); err == nil {
+			return r, nil
+		}
+		// logical and foreign UROWIDs have no fixed structure
+		return tostring((*C.uchar)(unsafe.Pointer(valuep)), valuelen), nil
 	}
-	return nil
+	return nil, nil
 }
 
 func getError(oci_err *C.OCIError) (string, int32) {
@@ -423,40 +747,22 @@ func getErrorEnc(oci_err *C.OCIError, csid int) (string, int32, error) {
 	return val, int32(errCode), err
 }
 
-func (x *XStreamConn) pos2SCN(ocip *C.struct_oci, pos *C.ub1, pos_len C.ub2) scn.SCN {
+func (x *XStreamConn) pos2SCN(ocip *C.struct_oci, pos *C.ub1, pos_len C.ub2) (scn.SCN, error) {
 	if pos_len == 0 {
-		return 0
-	}
-	var s C.struct_OCINumber
-	var commit_scn C.struct_OCINumber
-	var result C.sword
-	result = C.OCILCRSCNsFromPosition(ocip.svcp, ocip.errp, pos, pos_len, &s, &commit_scn, C.OCI_DEFAULT)
-	if result != C.OCI_SUCCESS {
-		// todo
-		C.ocierror(ocip, C.CString("OCILCRHeaderGet failed"))
-		return 0
-	} else {
-		return scn.SCN(ociNumberToInt(ocip.errp, &s))
+		return 0, nil
 	}
+	if C.position_to_scn(ocip, pos, pos_len) != C.OCI_SUCCESS {
+		return 0, ociError("OCILCRSCNsFromPosition", ocip.errp)
+	}
+	return scn.SCN(ocip.scn), nil
 }
 
-func (x *XStreamConn) scn2pos(ocip *C.struct_oci, s scn.SCN) (*cgo.UInt8, C.ub2) {
-	var status C.int
-	var number *C.OCINumber = ociNumberFromInt(ocip.errp, int64(s))
-	var buf = cgo.NewUInt8N(C.OCI_LCR_MAX_POSITION_LEN)
-	var posl C.ub2
-	//if x.lcridVer == V1 {
-	//	status = C.OCILCRSCNToPosition(ocip.svcp, ocip.errp, pos, &posl, number, C.OCI_DEFAULT)
-	//} else {
-	//	status = C.OCILCRSCNToPosition2(ocip.svcp, ocip.errp, pos, &posl, number, C.OCI_LCRID_V2, C.OCI_DEFAULT)
-	//}
-	status = C.OCILCRSCNToPosition(ocip.svcp, ocip.errp, (*C.ub1)(buf), &posl, number, C.OCI_DEFAULT)
-
-	if status != C.OCI_SUCCESS {
-		// todo
-		C.ocierror(ocip, C.CString("OCILCRHeaderGet failed"))
-		return nil, 0
-	} else {
-		return buf, posl
+// scn2pos converts s into ocip's position buffer, which is valid until the
+// next call.
+func (x *XStreamConn) scn2pos(ocip *C.struct_oci, s scn.SCN) (*C.ub1, C.ub2, error) {
+	// only version 1 positions are used on windows
+	if C.scn_to_position(ocip, C.oraub8(s), C.OCI_LCRID_V1) != C.OCI_SUCCESS {
+		return nil, 0, ociError("OCILCRSCNToPosition", ocip.errp)
 	}
+	return &ocip.pos[0], ocip.pos_len, nil
 }
@@ -1,122 +1,31 @@
-#ifndef OCI_ORACLE
-#include <oci.h>
-#endif
-
-#ifndef _STDIO_H
-#include <stdio.h>
-#endif
-
-#ifndef _STDLIB_H
-#include <stdlib.h>
-#endif
-
-#ifndef _STRING_H
-#include <string.h>
-#endif
-
-//#ifndef _MALLOC_H
-//#include <malloc.h>
-//#endif
-
-/*----------------------------------------------------------------------
- *           Internal structures
- *----------------------------------------------------------------------*/
-
-#define M_DBNAME_LEN    (128)
-
-typedef struct conn_info                                     /* connect info */
-{
-  oratext * user;
-  ub4       userlen;
-  oratext * passw;
-  ub4       passwlen;
-  oratext * dbname;
-  ub4       dbnamelen;
-  oratext * svrnm;
-  ub4       svrnmlen;
-} conn_info_t;
-
-typedef struct params
-{
-  conn_info_t  xout;                                        /* outbound info */
-  conn_info_t  xin;                                          /* inbound info */
-} params_t;
-
-typedef struct oci                                            /* OCI handles */
-{
-  OCIEnv      *envp;                                   /* Environment handle */
-  OCIError    *errp;                                         /* Error handle */
-  OCIServer   *srvp;                                        /* Server handle */
-  OCISvcCtx   *svcp;                                       /* Service handle */
-  OCISession  *authp;
-  OCIStmt    *stmtp;
-  boolean     attached;
-  boolean     outbound;
-} oci_t;
-
-typedef struct oci_lcr_column_item {
-  void *column_value;
-  ub2 column_value_len;
-
-  OCIInd column_indicator;
-  ub1 column_character_set_form;
-  oraub8 column_flag;
-
-  ub2 column_csid;
+#include "xstrm.h"
 
-  ub1 *column_name;
-  ub2 column_name_len;
-
-  ub2 column_data_type;
-} oci_lcr_column_item_t;
-
-typedef struct oci_lcr_row {
-  oci_lcr_column_item_t **columns;
-  ub2 length;
-} oci_lcr_row_t;
-
-static sword get_lcr_row_data(const oci_t *ocip, void *lcrp,
-                              ub2 column_value_type, oci_lcr_row_t **row,
-                              ub2 *column_length);
-
-static sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
-                              ub2 index, char **column_name,
-                              ub2 *column_name_len, void **column_value,
-                              ub2 *column_value_len, ub2 *column_csid, ub2 *column_data_type);
-
-static void free_lcr_row_data(const oci_lcr_row_t *data);
-static void free_lcr_row_item(const oci_lcr_column_item_t *item);
-
-static oci_lcr_row_t *create_lcr_row_data(ub2 length);
-
-static void connect_db(conn_info_t *opt_params_p, oci_t ** ocip, ub2 char_csid,
-                       ub2 nchar_csid);
-static void disconnect_db(oci_t * ocip);
+static void *lcr_arena_alloc(lcr_arena_t *arena, size_t size);
+static void lcr_arena_free(lcr_arena_t *arena);
+static oci_lcr_row_t *create_lcr_row_data(oci_t *ocip, ub2 length);
 static void ocierror(oci_t * ocip, char * msg);
 static void ocierror0(oci_t * ocip, char * msg);
 static void attach(oci_t * ocip, conn_info_t *conn, boolean outbound);
-static int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound);
-static void detach(oci_t *ocip);
+static int compare_position(const ub1 *a, ub2 al, const ub1 *b, ub2 bl);
 static void get_lcrs(oci_t *xin_ocip, oci_t *xout_ocip);
 static void get_chunks(oci_t *xin_ocip, oci_t *xout_ocip);
-static void travel_chunks( oci_t *xout_ocip);
 static void print_lcr(oci_t *ocip, void *lcrp, ub1 lcrtype,
                       oratext **src_db_name, ub2  *src_db_namel);
 static void print_chunk (ub1 *chunk_ptr, ub4 chunk_len, ub2 dty);
 static void get_inputs(conn_info_t *xout_params, conn_info_t *xin_params,
                        int argc, char ** argv);
 static void get_db_charsets(conn_info_t *params_p, ub2 *char_csid,
-                            ub2 *nchar_csid);
+                            ub2 *nchar_csid, OCIEnv *shared_envp);
 static void set_client_charset(oci_t *outbound_ocip);
 
 #define OCICALL(ocip, function) do {\
 sword status=function;\
 if (OCI_SUCCESS==status) break;\
-else if (OCI_ERROR==status) \
-{ocierror(ocip, (char *)"OCI_ERROR");\
-exit(1);}\
-else {printf("Error encountered %d\n", status);\
-exit(1);}\
+(ocip)->status=status;\
+if (OCI_ERROR==status) \
+ocierror(ocip, (char *)"OCI_ERROR");\
+else printf("Error encountered %d\n", status);\
+return;\
 } while(0)
 
 #define OCICALL0(ocip, function) do {\
@@ -131,42 +40,273 @@ r=2;\
 break;}\
 } while(0)
 
-static void free_lcr_row_item(const oci_lcr_column_item_t *item) {
-  // free(item->value);
-  free(item->column_name);
-  free((void *)item);
+/*---------------------------------------------------------------------
+ * prof_now - Monotonic clock in nanoseconds for the OCI_PROF timers.
+ *---------------------------------------------------------------------*/
+static oraub8 prof_now(void)
+{
+#ifdef _WIN32
+  LARGE_INTEGER count, freq;
+
+  QueryPerformanceCounter(&count);
+  QueryPerformanceFrequency(&freq);
+  return (oraub8)(count.QuadPart / freq.QuadPart) * 1000000000 +
+         (oraub8)(count.QuadPart % freq.QuadPart) * 1000000000 /
+         freq.QuadPart;
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (oraub8)ts.tv_sec * 1000000000 + (oraub8)ts.tv_nsec;
+#endif
 }
 
-static void free_lcr_row_data(const oci_lcr_row_t *data) {
-  if (data == 0) {
-    return;
+#define PROF_START(ocip) \
+  ((ocip)->prof.enabled ? prof_now() : 0)
+
+#define PROF_STOP(ocip, which, start) do {\
+if ((ocip)->prof.enabled) {\
+(ocip)->prof.calls[which]++;\
+(ocip)->prof.nanos[which] += prof_now() - (start);}\
+} while(0)
+
+#define LCR_ARENA_INIT_SIZE  (64 * 1024)
+#define LCR_ARENA_ALIGN(n)   (((n) + 15) & ~(size_t)15)
+
+/*---------------------------------------------------------------------
+ * lcr_arena_alloc - Bump-allocate size bytes from the arena. Requests
+ * that do not fit the primary block are served from overflow chunks;
+ * the next reset grows the primary block so that the steady state does
+ * not touch the allocator at all.
+ *---------------------------------------------------------------------*/
+static void *lcr_arena_alloc(lcr_arena_t *arena, size_t size)
+{
+  lcr_arena_chunk_t *chunk;
+
+  size = LCR_ARENA_ALIGN(size);
+  if (arena->base == NULL)
+  {
+    arena->cap = LCR_ARENA_INIT_SIZE;
+    while (arena->cap < size)
+      arena->cap <<= 1;
+    arena->base = (ub1 *)malloc(arena->cap);
+    if (arena->base == NULL)
+      return NULL;
+    arena->used = 0;
   }
-  for (ub2 i = 0; i < data->length; i++) {
-    free_lcr_row_item(data->columns[i]);
-    data->columns[i] = NULL;
+
+  if (arena->cap - arena->used >= size)
+  {
+    void *p = arena->base + arena->used;
+    arena->used += size;
+    return p;
+  }
+
+  chunk = (lcr_arena_chunk_t *)malloc(
+      LCR_ARENA_ALIGN(sizeof(lcr_arena_chunk_t)) + size);
+  if (chunk == NULL)
+    return NULL;
+  chunk->size = size;
+  chunk->next = arena->chunks;
+  arena->chunks = chunk;
+  arena->spill += size;
+  return (ub1 *)chunk + LCR_ARENA_ALIGN(sizeof(lcr_arena_chunk_t));
+}
+
+/*---------------------------------------------------------------------
+ * lcr_arena_reset - Release everything allocated since the last reset.
+ *---------------------------------------------------------------------*/
+void lcr_arena_reset(lcr_arena_t *arena)
+{
+  size_t total = arena->used + arena->spill;
+
+  if (total > arena->hwm)
+    arena->hwm = total;
+
+  if (arena->chunks != NULL)
+  {
+    lcr_arena_chunk_t *chunk = arena->chunks;
+    size_t             cap = arena->cap;
+
+    while (chunk != NULL)
+    {
+      lcr_arena_chunk_t *next = chunk->next;
+      free(chunk);
+      chunk = next;
+    }
+    arena->chunks = NULL;
+
+    /* grow the primary block so this LCR would have fit */
+    while (cap < total)
+      cap <<= 1;
+    free(arena->base);
+    arena->base = (ub1 *)malloc(cap);
+    arena->cap = arena->base ? cap : 0;
+    arena->grows++;
   }
-  free(data->columns);
-  free((void *)data);
+
+  arena->used = 0;
+  arena->spill = 0;
+}
+
+/*---------------------------------------------------------------------
+ * lcr_arena_free - Return all arena memory to the system.
+ *---------------------------------------------------------------------*/
+static void lcr_arena_free(lcr_arena_t *arena)
+{
+  lcr_arena_reset(arena);
+  free(arena->base);
+  arena->base = NULL;
+  arena->cap = 0;
 }
 
-static oci_lcr_row_t *create_lcr_row_data(ub2 length) {
-  oci_lcr_row_t *row = malloc(sizeof(oci_lcr_row_t));
+static oci_lcr_row_t *create_lcr_row_data(oci_t *ocip, ub2 length) {
+  oci_lcr_row_t *row = lcr_arena_alloc(&ocip->arena, sizeof(oci_lcr_row_t));
+  if (row == NULL) {
+    return NULL;
+  }
   row->length = length;
-  row->columns = malloc(sizeof(oci_lcr_column_item_t *) * length);
-  for (ub2 i = 0; i < length; i++) {
-    row->columns[i] =
-        (oci_lcr_column_item_t *)malloc(sizeof(oci_lcr_column_item_t));
+  row->columns = lcr_arena_alloc(&ocip->arena,
+                                 sizeof(oci_lcr_column_item_t) * length);
+  if (row->columns == NULL && length > 0) {
+    return NULL;
   }
   return row;
 }
 
-static oratext *create_oci_text_copy(const oratext *str) {
-  oratext *copy = (oratext *)malloc(strlen((const char *)str) + 1);
-  strcpy((char *)copy, (const char *)str);
-  return copy;
+/*---------------------------------------------------------------------
+ * stage_column_value - Replace datetime, interval and rowid descriptors
+ * with byte images in the arena, so the Go side can decode them without
+ * calling back into OCI. See packages oraTime and oraBinary.
+ *---------------------------------------------------------------------*/
+static sword stage_column_value(oci_t *ocip, oci_lcr_column_item_t *item)
+{
+  ub1 *b;
+
+  if (item->column_indicator == OCI_IND_NULL || item->column_value == NULL)
+  {
+    item->column_value_len = 0;
+    return OCI_SUCCESS;
+  }
+
+  switch (item->column_data_type)
+  {
+  case SQLT_TIMESTAMP:
+  case SQLT_TIMESTAMP_TZ:
+  case SQLT_TIMESTAMP_LTZ:
+  {
+    OCIDateTime *dt = (OCIDateTime *)item->column_value;
+    boolean      tz = item->column_data_type != SQLT_TIMESTAMP;
+    sb2 yr;
+    ub1 mo, dy, hh, mi, ss;
+    ub4 fsec;
+    sb1 tzh = 0, tzm = 0;
+
+    if (OCIDateTimeGetDate(ocip->envp, ocip->errp, dt, &yr, &mo, &dy) ||
+        OCIDateTimeGetTime(ocip->envp, ocip->errp, dt, &hh, &mi, &ss, &fsec))
+      return OCI_ERROR;
+    if (tz &&
+        OCIDateTimeGetTimeZoneOffset(ocip->envp, ocip->errp, dt, &tzh, &tzm))
+      return OCI_ERROR;
+
+    b = lcr_arena_alloc(&ocip->arena, tz ? 13 : 11);
+    if (b == NULL)
+      return OCI_ERROR;
+    b[0] = (ub1)(yr / 100 + 100);
+    b[1] = (ub1)(yr % 100 + 100);
+    b[2] = mo;
+    b[3] = dy;
+    b[4] = hh + 1;
+    b[5] = mi + 1;
+    b[6] = ss + 1;
+    b[7] = (ub1)(fsec >> 24);
+    b[8] = (ub1)(fsec >> 16);
+    b[9] = (ub1)(fsec >> 8);
+    b[10] = (ub1)fsec;
+    if (tz)
+    {
+      b[11] = (ub1)(tzh + 20);
+      b[12] = (ub1)(tzm + 60);
+    }
+    item->column_value = b;
+    item->column_value_len = tz ? 13 : 11;
+    break;
+  }
+  case SQLT_INTERVAL_YM:
+  {
+    sb4 yr, mnth;
+    ub4 y;
+
+    if (OCIIntervalGetYearMonth(ocip->envp, ocip->errp, &yr, &mnth,
+                                (OCIInterval *)item->column_value))
+      return OCI_ERROR;
+
+    b = lcr_arena_alloc(&ocip->arena, 5);
+    if (b == NULL)
+      return OCI_ERROR;
+    y = (ub4)yr + 0x80000000u;
+    b[0] = (ub1)(y >> 24);
+    b[1] = (ub1)(y >> 16);
+    b[2] = (ub1)(y >> 8);
+    b[3] = (ub1)y;
+    b[4] = (ub1)(mnth + 60);
+    item->column_value = b;
+    item->column_value_len = 5;
+    break;
+  }
+  case SQLT_INTERVAL_DS:
+  {
+    sb4 dy, hr, mm, ss, fsec;
+    ub4 d, f;
+
+    if (OCIIntervalGetDaySecond(ocip->envp, ocip->errp, &dy, &hr, &mm, &ss,
+                                &fsec, (OCIInterval *)item->column_value))
+      return OCI_ERROR;
+
+    b = lcr_arena_alloc(&ocip->arena, 11);
+    if (b == NULL)
+      return OCI_ERROR;
+    d = (ub4)dy + 0x80000000u;
+    f = (ub4)fsec + 0x80000000u;
+    b[0] = (ub1)(d >> 24);
+    b[1] = (ub1)(d >> 16);
+    b[2] = (ub1)(d >> 8);
+    b[3] = (ub1)d;
+    b[4] = (ub1)(hr + 60);
+    b[5] = (ub1)(mm + 60);
+    b[6] = (ub1)(ss + 60);
+    b[7] = (ub1)(f >> 24);
+    b[8] = (ub1)(f >> 16);
+    b[9] = (ub1)(f >> 8);
+    b[10] = (ub1)f;
+    item->column_value = b;
+    item->column_value_len = 11;
+    break;
+  }
+  case SQLT_RDD:
+  {
+    ub2 len = 32;
+
+    b = lcr_arena_alloc(&ocip->arena, len);
+    if (b == NULL)
+      return OCI_ERROR;
+    if (OCIRowidToChar((OCIRowid *)item->column_value, b, &len, ocip->errp))
+    {
+      /* UROWIDs may not fit, len now holds the required size */
+      b = lcr_arena_alloc(&ocip->arena, len);
+      if (b == NULL ||
+          OCIRowidToChar((OCIRowid *)item->column_value, b, &len, ocip->errp))
+        return OCI_ERROR;
+    }
+    item->column_value = b;
+    item->column_value_len = len;
+    break;
+  }
+  }
+  return OCI_SUCCESS;
 }
 
-static sword get_lcr_row_data(const oci_t *ocip, void *lcrp,
+sword get_lcr_row_data(oci_t *ocip, void *lcrp,
                               ub2 column_value_type, oci_lcr_row_t **row,
                               ub2 *column_length) {
   *row = 0;
@@ -191,23 +331,34 @@ static sword get_lcr_row_data(const oci_t *ocip, void *lcrp,
   ub1 column_csetfp[array_size];
   oraub8 column_flags[array_size];
   ub2 column_csid[array_size];
+  oraub8 prof_start = PROF_START(ocip);
 
   result = OCILCRRowColumnInfoGet(
       ocip->svcp, ocip->errp, column_value_type, &num_cols, column_names,
       column_name_lens, column_dtyp, column_valuesp, column_indp, column_alensp,
       column_csetfp, column_flags, column_csid, lcrp, array_size, OCI_DEFAULT);
+  PROF_STOP(ocip, OCI_PROF_COLUMN_INFO, prof_start);
 
   if (result != OCI_SUCCESS) {
     return result;
   }
 
-  *row = create_lcr_row_data(num_cols);
+  *row = create_lcr_row_data(ocip, num_cols);
+  if (*row == NULL) {
+    return OCI_ERROR;
+  }
   *column_length = num_cols;
 
+  prof_start = PROF_START(ocip);
   for (ub2 i = 0; i < num_cols; i++) {
-    oci_lcr_column_item_t *item = (*row)->columns[i];
+    oci_lcr_column_item_t *item = &(*row)->columns[i];
     item->column_data_type = column_dtyp[i];
-    item->column_name = create_oci_text_copy(column_names[i]);
+    item->column_name = lcr_arena_alloc(&ocip->arena, column_name_lens[i] + 1);
+    if (item->column_name == NULL) {
+      return OCI_ERROR;
+    }
+    memcpy(item->column_name, column_names[i], column_name_lens[i]);
+    item->column_name[column_name_lens[i]] = '\0';
     item->column_name_len = column_name_lens[i];
     item->column_value = column_valuesp[i];
     item->column_value_len = column_alensp[i];
@@ -215,12 +366,16 @@ static sword get_lcr_row_data(const oci_t *ocip, void *lcrp,
     item->column_csid = column_csid[i];
     item->column_indicator = column_indp[i];
     item->column_flag = column_flags[i];
+    if (stage_column_value(ocip, item) != OCI_SUCCESS) {
+      return OCI_ERROR;
+    }
   }
+  PROF_STOP(ocip, OCI_PROF_COPY, prof_start);
 
   return result;
 }
 
-static sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
+sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
                               ub2 index, char **column_name,
                               ub2 *column_name_len, void **column_value,
                               ub2 *column_value_len,ub2 *column_csid, ub2 *column_data_type) {
@@ -230,7 +385,7 @@ static sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
     return OCI_ERROR;
   }
 
-  oci_lcr_column_item_t *item = row->columns[index];
+  oci_lcr_column_item_t *item = &row->columns[index];
   *column_name = (char *)item->column_name;
   *column_name_len = item->column_name_len;
   *column_value = item->column_value;
@@ -241,12 +396,236 @@ static sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
   return OCI_SUCCESS;
 }
 
+/* Every pooled block is preceded by a header recording its class and
+ * requested size, so free and realloc need no lookup. */
+typedef struct oci_mem_hdr
+{
+  size_t size;
+  size_t cls;
+} oci_mem_hdr_t;
+
+#define OCI_MEM_HDR_SIZE  ((sizeof(oci_mem_hdr_t) + 15) & ~(size_t)15)
+
+static void oci_mem_lock(oci_mem_pool_t *pool)
+{
+  while (__sync_lock_test_and_set(&pool->lock, 1))
+    ;
+}
+
+static void oci_mem_unlock(oci_mem_pool_t *pool)
+{
+  __sync_lock_release(&pool->lock);
+}
+
+static size_t oci_mem_class(size_t size)
+{
+  size_t cls = 0;
+  size_t cap = (size_t)1 << OCI_MEM_MIN_SHIFT;
+
+  while (cap < size + OCI_MEM_HDR_SIZE)
+  {
+    if (++cls == OCI_MEM_NCLASSES)
+      return OCI_MEM_LARGE;
+    cap <<= 1;
+  }
+  return cls;
+}
+
+/*---------------------------------------------------------------------
+ * oci_pool_malloc - OCI malloc callback, served from the size classes.
+ *---------------------------------------------------------------------*/
+static void *oci_pool_malloc(void *ctxp, size_t size)
+{
+  oci_mem_pool_t *pool = (oci_mem_pool_t *)ctxp;
+  size_t          cls = oci_mem_class(size);
+  oci_mem_hdr_t  *hdr = NULL;
+
+  oci_mem_lock(pool);
+  pool->allocs++;
+  pool->bytes += size;
+  pool->in_use += size;
+  if (cls != OCI_MEM_LARGE && pool->free_list[cls] != NULL)
+  {
+    hdr = (oci_mem_hdr_t *)pool->free_list[cls];
+    pool->free_list[cls] = pool->free_list[cls]->next;
+    pool->cached[cls] -= (size_t)1 << (cls + OCI_MEM_MIN_SHIFT);
+    pool->hits++;
+  }
+  oci_mem_unlock(pool);
+
+  if (hdr == NULL)
+  {
+    size_t n = cls == OCI_MEM_LARGE ? size + OCI_MEM_HDR_SIZE
+                                    : (size_t)1 << (cls + OCI_MEM_MIN_SHIFT);
+    hdr = (oci_mem_hdr_t *)malloc(n);
+    if (hdr == NULL)
+      return NULL;
+  }
+  hdr->size = size;
+  hdr->cls = cls;
+  return (ub1 *)hdr + OCI_MEM_HDR_SIZE;
+}
+
+/*---------------------------------------------------------------------
+ * oci_pool_free - OCI free callback, keeps blocks for reuse up to
+ * OCI_MEM_CACHE_BYTES per class.
+ *---------------------------------------------------------------------*/
+static void oci_pool_free(void *ctxp, void *memptr)
+{
+  oci_mem_pool_t *pool = (oci_mem_pool_t *)ctxp;
+  oci_mem_hdr_t  *hdr;
+  size_t          cls;
+
+  if (memptr == NULL)
+    return;
+
+  hdr = (oci_mem_hdr_t *)((ub1 *)memptr - OCI_MEM_HDR_SIZE);
+  cls = hdr->cls;
+
+  oci_mem_lock(pool);
+  pool->frees++;
+  pool->in_use -= hdr->size;
+  if (cls != OCI_MEM_LARGE &&
+      pool->cached[cls] < OCI_MEM_CACHE_BYTES)
+  {
+    oci_mem_block_t *blk = (oci_mem_block_t *)hdr;
+    blk->next = pool->free_list[cls];
+    pool->free_list[cls] = blk;
+    pool->cached[cls] += (size_t)1 << (cls + OCI_MEM_MIN_SHIFT);
+    hdr = NULL;
+  }
+  oci_mem_unlock(pool);
+
+  if (hdr != NULL)
+    free(hdr);
+}
+
+/*---------------------------------------------------------------------
+ * oci_pool_realloc - OCI realloc callback. Stays in place while the new
+ * size still fits the block's class.
+ *---------------------------------------------------------------------*/
+static void *oci_pool_realloc(void *ctxp, void *memptr, size_t newsize)
+{
+  oci_mem_pool_t *pool = (oci_mem_pool_t *)ctxp;
+  oci_mem_hdr_t  *hdr;
+  void           *p;
+
+  if (memptr == NULL)
+    return oci_pool_malloc(ctxp, newsize);
+
+  hdr = (oci_mem_hdr_t *)((ub1 *)memptr - OCI_MEM_HDR_SIZE);
+  if (hdr->cls != OCI_MEM_LARGE && oci_mem_class(newsize) <= hdr->cls)
+  {
+    oci_mem_lock(pool);
+    pool->allocs++;
+    pool->bytes += newsize;
+    pool->in_use += newsize;
+    pool->in_use -= hdr->size;
+    oci_mem_unlock(pool);
+    hdr->size = newsize;
+    return memptr;
+  }
+
+  p = oci_pool_malloc(ctxp, newsize);
+  if (p == NULL)
+    return NULL;
+  memcpy(p, memptr, hdr->size < newsize ? hdr->size : newsize);
+  oci_pool_free(ctxp, memptr);
+  return p;
+}
+
+/*---------------------------------------------------------------------
+ * oci_pool_destroy - Release the cached blocks and the pool itself. Must
+ * be called after the environment using the pool has been freed.
+ *---------------------------------------------------------------------*/
+void oci_pool_destroy(oci_mem_pool_t *pool)
+{
+  if (pool == NULL)
+    return;
+  for (int i = 0; i < OCI_MEM_NCLASSES; i++)
+  {
+    oci_mem_block_t *blk = pool->free_list[i];
+    while (blk != NULL)
+    {
+      oci_mem_block_t *next = blk->next;
+      free(blk);
+      blk = next;
+    }
+  }
+  free(pool);
+}
+
+/*---------------------------------------------------------------------
+ * create_pool - Allocate an empty pool for the OCI memory callbacks.
+ *---------------------------------------------------------------------*/
+oci_mem_pool_t *create_pool(void)
+{
+  oci_mem_pool_t *pool = (oci_mem_pool_t *)malloc(sizeof(oci_mem_pool_t));
+
+  if (pool != NULL)
+    memset(pool, 0, sizeof(oci_mem_pool_t));
+  return pool;
+}
+
+/*---------------------------------------------------------------------
+ * create_env - Create an environment in the given mode and char and nchar
+ * character set ids. Memory is allocated through pool when it is set.
+ *---------------------------------------------------------------------*/
+sword create_env(OCIEnv **envp, ub4 mode, ub2 char_csid,
+                        ub2 nchar_csid, oci_mem_pool_t *pool)
+{
+  return OCIEnvNlsCreate(envp, mode, (dvoid *)pool,
+                         pool ? oci_pool_malloc :
+                           (dvoid * (*)(dvoid *, size_t)) 0,
+                         pool ? oci_pool_realloc :
+                           (dvoid * (*)(dvoid *, dvoid *, size_t))0,
+                         pool ? oci_pool_free :
+                           (void (*)(dvoid *, dvoid *)) 0,
+                         (size_t) 0, (dvoid **) 0, char_csid, nchar_csid);
+}
+
+/*---------------------------------------------------------------------
+ * logon_db - Allocate the error handle and log on in ocip->envp.
+ *---------------------------------------------------------------------*/
+static sword logon_db(oci_t *ocip, conn_info_t *params_p)
+{
+  sword status;
+
+  status = OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->errp,
+                          (ub4) OCI_HTYPE_ERROR, (size_t) 0, (dvoid **) 0);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  status = OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->brkerrp,
+                          (ub4) OCI_HTYPE_ERROR, (size_t) 0, (dvoid **) 0);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  /* Logon to database */
+  status = OCILogon(ocip->envp, ocip->errp, &ocip->svcp,
+                    params_p->user, params_p->userlen,
+                    params_p->passw, params_p->passwlen,
+                    params_p->dbname, params_p->dbnamelen);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  /* allocate the server handle */
+  status = OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->srvp,
+                          OCI_HTYPE_SERVER, (size_t) 0, (dvoid **) 0);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  return OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->stmtp,
+                        (ub4) OCI_HTYPE_STMT, (size_t) 0, (dvoid **) 0);
+}
+
 /*---------------------------------------------------------------------
  * connect_db - Connect to the database and set the env to the given
- * char and nchar character set ids.
+ * char and nchar character set ids. *ociptr is set even on failure so
+ * that the caller can get the error and disconnect.
  *---------------------------------------------------------------------*/
-static void connect_db(conn_info_t *params_p, oci_t **ociptr, ub2 char_csid,
-                ub2 nchar_csid)
+sword connect_db(conn_info_t *params_p, oci_t **ociptr, ub2 char_csid,
+                ub2 nchar_csid, boolean pooled)
 {
   oci_t        *ocip;
 
@@ -260,42 +639,45 @@ static void connect_db(conn_info_t *params_p, oci_t **ociptr, ub2 char_csid,
   printf("\n");
 
   ocip = (oci_t *)malloc(sizeof(oci_t));
+  memset(ocip, 0, sizeof(oci_t));
+  ocip->owns_env = TRUE;
+  *ociptr = ocip;
 
-  if (OCIEnvNlsCreate(&ocip->envp, OCI_OBJECT, (dvoid *)0,
-                     (dvoid * (*)(dvoid *, size_t)) 0,
-                     (dvoid * (*)(dvoid *, dvoid *, size_t))0,
-                     (void (*)(dvoid *, dvoid *)) 0,
-                     (size_t) 0, (dvoid **) 0, char_csid, nchar_csid))
+  if (pooled)
+    ocip->pool = create_pool();
+
+  ocip->status = create_env(&ocip->envp, OCI_OBJECT, char_csid, nchar_csid,
+                            ocip->pool);
+  if (ocip->status != OCI_SUCCESS)
   {
     ocierror(ocip, (char *)"OCIEnvCreate() failed");
+    return ocip->status;
   }
 
-  if (OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->errp,
-                     (ub4) OCI_HTYPE_ERROR, (size_t) 0, (dvoid **) 0))
-  {
-    ocierror(ocip, (char *)"OCIHandleAlloc(OCI_HTYPE_ERROR) failed");
-  }
+  ocip->status = logon_db(ocip, params_p);
+  if (ocip->status != OCI_SUCCESS)
+    ocierror(ocip, (char *)"OCILogon() failed");
 
-  /* Logon to database */
-  OCICALL(ocip,
-          OCILogon(ocip->envp, ocip->errp, &ocip->svcp,
-                   params_p->user, params_p->userlen,
-                   params_p->passw, params_p->passwlen,
-                   params_p->dbname, params_p->dbnamelen));
+  return ocip->status;
+}
 
-  /* allocate the server handle */
-  OCICALL(ocip,
-          OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->srvp,
-                         OCI_HTYPE_SERVER, (size_t) 0, (dvoid **) 0));
+/*---------------------------------------------------------------------
+ * connect_db_env - Connect to the database in an environment shared with
+ * other connections. The environment and its pool are not owned by the
+ * connection and survive disconnect_db.
+ *---------------------------------------------------------------------*/
+sword connect_db_env(conn_info_t *params_p, oci_t **ociptr,
+                            OCIEnv *envp, oci_mem_pool_t *pool)
+{
+  oci_t *ocip = (oci_t *)malloc(sizeof(oci_t));
 
-  OCICALL(ocip,
-          OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->stmtp,
-                     (ub4) OCI_HTYPE_STMT, (size_t) 0, (dvoid **) 0));
+  memset(ocip, 0, sizeof(oci_t));
+  ocip->envp = envp;
+  ocip->pool = pool;
+  ocip->owns_env = FALSE;
+  *ociptr = ocip;
 
-  if (*ociptr == (oci_t *)NULL)
-  {
-    *ociptr = ocip;
-  }
+  return logon_db(ocip, params_p);
 }
 
 /*---------------------------------------------------------------------
@@ -308,14 +690,8 @@ static const oratext GET_DB_CHARSETS[] =  \
 #define PARM_BUFLEN      (30)
 
 static void get_db_charsets(conn_info_t *params_p, ub2 *char_csid,
-                            ub2 *nchar_csid)
+                            ub2 *nchar_csid, OCIEnv *shared_envp)
 {
-  OCIDefine  *defnp1 = (OCIDefine *) NULL;
-  OCIDefine  *defnp2 = (OCIDefine *) NULL;
-  oratext     parm[PARM_BUFLEN];
-  oratext     value[OCI_NLS_MAXBUFSZ];
-  ub2         parm_len = 0;
-  ub2         value_len = 0;
   oci_t       ocistruct;
   oci_t      *ocip = &ocistruct;
 
@@ -323,55 +699,78 @@ static void get_db_charsets(conn_info_t *params_p, ub2 *char_csid,
   *nchar_csid = 0;
   memset (ocip, 0, sizeof(ocistruct));
 
-  if (OCIEnvCreate(&ocip->envp, OCI_OBJECT, (dvoid *)0,
-                     (dvoid * (*)(dvoid *, size_t)) 0,
-                     (dvoid * (*)(dvoid *, dvoid *, size_t))0,
-                     (void (*)(dvoid *, dvoid *)) 0,
-                     (size_t) 0, (dvoid **) 0))
+  if (shared_envp)
   {
-    ocierror(ocip, (char *)"OCIEnvCreate() failed");
+    ocip->envp = shared_envp;
+  }
+  else
+  {
+    ocip->owns_env = TRUE;
+    if (OCIEnvCreate(&ocip->envp, OCI_OBJECT, (dvoid *)0,
+                       (dvoid * (*)(dvoid *, size_t)) 0,
+                       (dvoid * (*)(dvoid *, dvoid *, size_t))0,
+                       (void (*)(dvoid *, dvoid *)) 0,
+                       (size_t) 0, (dvoid **) 0))
+    {
+      ocierror(ocip, (char *)"OCIEnvCreate() failed");
+      return;
+    }
   }
 
-  if (OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->errp,
-                     (ub4) OCI_HTYPE_ERROR, (size_t) 0, (dvoid **) 0))
+  if (logon_db(ocip, params_p) != OCI_SUCCESS ||
+      query_db_charsets(ocip, char_csid, nchar_csid) != OCI_SUCCESS)
   {
-    ocierror(ocip, (char *)"OCIHandleAlloc(OCI_HTYPE_ERROR) failed");
+    ocierror(ocip, (char *)"get_db_charsets() failed");
   }
 
-  OCICALL(ocip,
-          OCILogon(ocip->envp, ocip->errp, &ocip->svcp,
-                   params_p->user, params_p->userlen,
-                   params_p->passw, params_p->passwlen,
-                   params_p->dbname, params_p->dbnamelen));
+  disconnect_db(ocip);
+}
 
-  OCICALL(ocip,
-          OCIHandleAlloc((dvoid *) ocip->envp, (dvoid **) &ocip->stmtp,
-                     (ub4) OCI_HTYPE_STMT, (size_t) 0, (dvoid **) 0));
+/*---------------------------------------------------------------------
+ * query_db_charsets - Get the database CHAR and NCHAR character set ids
+ * over an existing session, e.g. the one later attached to XStream.
+ *---------------------------------------------------------------------*/
+sword query_db_charsets(oci_t *ocip, ub2 *char_csid, ub2 *nchar_csid)
+{
+  OCIDefine  *defnp1 = (OCIDefine *) NULL;
+  OCIDefine  *defnp2 = (OCIDefine *) NULL;
+  oratext     parm[PARM_BUFLEN];
+  oratext     value[OCI_NLS_MAXBUFSZ];
+  ub2         parm_len = 0;
+  ub2         value_len = 0;
+  sword       status;
+
+  *char_csid = 0;
+  *nchar_csid = 0;
 
   /* Execute stmt to select the db nls char and nchar character set */
-  OCICALL(ocip,
-          OCIStmtPrepare(ocip->stmtp, ocip->errp,
-                         (CONST text *)GET_DB_CHARSETS,
-                         (ub4)strlen((char *)GET_DB_CHARSETS),
-                         (ub4)OCI_NTV_SYNTAX, (ub4)OCI_DEFAULT));
-
-  OCICALL(ocip,
-          OCIDefineByPos(ocip->stmtp, &defnp1,
-                         ocip->errp, (ub4) 1, parm,
-                         PARM_BUFLEN, SQLT_CHR, (void*) 0,
-                         &parm_len, (ub2 *)0, OCI_DEFAULT));
-
-  OCICALL(ocip,
-          OCIDefineByPos(ocip->stmtp, &defnp2,
-                         ocip->errp, (ub4) 2, value,
-                         OCI_NLS_MAXBUFSZ, SQLT_CHR, (void*) 0,
-                         &value_len, (ub2 *)0, OCI_DEFAULT));
-
-  OCICALL(ocip,
-          OCIStmtExecute(ocip->svcp, ocip->stmtp,
-                         ocip->errp, (ub4)0, (ub4)0,
-                         (const OCISnapshot *)0,
-                         (OCISnapshot *)0, (ub4)OCI_DEFAULT));
+  status = OCIStmtPrepare(ocip->stmtp, ocip->errp,
+                          (CONST text *)GET_DB_CHARSETS,
+                          (ub4)strlen((char *)GET_DB_CHARSETS),
+                          (ub4)OCI_NTV_SYNTAX, (ub4)OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  status = OCIDefineByPos(ocip->stmtp, &defnp1,
+                          ocip->errp, (ub4) 1, parm,
+                          PARM_BUFLEN, SQLT_CHR, (void*) 0,
+                          &parm_len, (ub2 *)0, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  status = OCIDefineByPos(ocip->stmtp, &defnp2,
+                          ocip->errp, (ub4) 2, value,
+                          OCI_NLS_MAXBUFSZ, SQLT_CHR, (void*) 0,
+                          &value_len, (ub2 *)0, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  status = OCIStmtExecute(ocip->svcp, ocip->stmtp,
+                          ocip->errp, (ub4)0, (ub4)0,
+                          (const OCISnapshot *)0,
+                          (OCISnapshot *)0, (ub4)OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
 
   while (OCIStmtFetch(ocip->stmtp, ocip->errp, 1,
                       OCI_FETCH_NEXT, OCI_DEFAULT) == OCI_SUCCESS)
@@ -393,7 +792,110 @@ static void get_db_charsets(conn_info_t *params_p, ub2 *char_csid,
     }
   }
 
-  disconnect_db(ocip);
+  return OCI_SUCCESS;
+}
+
+/*---------------------------------------------------------------------
+ * Key metadata: the enabled primary key, or else unique keys, of one
+ * table (:1 owner, :2 table), or of every table in the DML rules of an
+ * outbound server (:1 server name).
+ *---------------------------------------------------------------------*/
+#define KEY_QUERY_SELECT \
+ "select c.owner, c.table_name, c.constraint_name, cc.column_name \
+ from all_constraints c, all_cons_columns cc \
+ where c.constraint_type in ('P', 'U') and c.status = 'ENABLED' \
+ and cc.owner = c.owner and cc.constraint_name = c.constraint_name "
+#define KEY_QUERY_ORDER \
+ " order by c.owner, c.table_name, decode(c.constraint_type, 'P', 0, 1), \
+ c.constraint_name, cc.position"
+
+static const oratext GET_TABLE_KEYS[] = KEY_QUERY_SELECT
+ "and c.owner = :1 and c.table_name = :2" KEY_QUERY_ORDER;
+
+static const oratext GET_SERVER_KEYS[] = KEY_QUERY_SELECT
+ "and exists (select 1 from dba_xstream_rules r \
+ where r.streams_name = :1 and r.rule_type = 'DML' \
+ and r.schema_name = c.owner \
+ and (r.object_name is null or r.object_name = c.table_name))"
+ KEY_QUERY_ORDER;
+
+/*---------------------------------------------------------------------
+ * start_key_query - Execute one of the key queries on ocip's statement.
+ * The rows are then read one at a time into q by fetch_key_row.
+ *---------------------------------------------------------------------*/
+sword start_key_query(oci_t *ocip, key_query_t *q, boolean by_server,
+                             oratext *a, ub2 al, oratext *b, ub2 bl)
+{
+  const oratext *sql = by_server ? GET_SERVER_KEYS : GET_TABLE_KEYS;
+  sword          status;
+
+  memset(q, 0, sizeof(*q));
+  status = OCIStmtPrepare(ocip->stmtp, ocip->errp, (CONST text *)sql,
+                          (ub4)strlen((char *)sql),
+                          (ub4)OCI_NTV_SYNTAX, (ub4)OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  status = OCIBindByPos(ocip->stmtp, &q->binds[0], ocip->errp, 1,
+                        a, al, SQLT_CHR, (void *)0, (ub2 *)0, (ub2 *)0,
+                        0, (ub4 *)0, OCI_DEFAULT);
+  if (status == OCI_SUCCESS && !by_server)
+    status = OCIBindByPos(ocip->stmtp, &q->binds[1], ocip->errp, 2,
+                          b, bl, SQLT_CHR, (void *)0, (ub2 *)0, (ub2 *)0,
+                          0, (ub4 *)0, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  if ((status = OCIDefineByPos(ocip->stmtp, &q->defs[0], ocip->errp, 1,
+                               q->owner, KEY_NAME_LEN, SQLT_CHR, (void *)0,
+                               &q->owner_len, (ub2 *)0,
+                               OCI_DEFAULT)) != OCI_SUCCESS ||
+      (status = OCIDefineByPos(ocip->stmtp, &q->defs[1], ocip->errp, 2,
+                               q->table, KEY_NAME_LEN, SQLT_CHR, (void *)0,
+                               &q->table_len, (ub2 *)0,
+                               OCI_DEFAULT)) != OCI_SUCCESS ||
+      (status = OCIDefineByPos(ocip->stmtp, &q->defs[2], ocip->errp, 3,
+                               q->constraint, KEY_NAME_LEN, SQLT_CHR,
+                               (void *)0, &q->constraint_len, (ub2 *)0,
+                               OCI_DEFAULT)) != OCI_SUCCESS ||
+      (status = OCIDefineByPos(ocip->stmtp, &q->defs[3], ocip->errp, 4,
+                               q->column, KEY_NAME_LEN, SQLT_CHR, (void *)0,
+                               &q->column_len, (ub2 *)0,
+                               OCI_DEFAULT)) != OCI_SUCCESS)
+    return status;
+
+  return OCIStmtExecute(ocip->svcp, ocip->stmtp, ocip->errp, (ub4)0, (ub4)0,
+                        (const OCISnapshot *)0, (OCISnapshot *)0,
+                        (ub4)OCI_DEFAULT);
+}
+
+/*---------------------------------------------------------------------
+ * fetch_key_row - Fetch the next key column into the key_query_t that
+ * start_key_query defined. Returns OCI_NO_DATA after the last one.
+ *---------------------------------------------------------------------*/
+sword fetch_key_row(oci_t *ocip)
+{
+  return OCIStmtFetch(ocip->stmtp, ocip->errp, 1, OCI_FETCH_NEXT,
+                      OCI_DEFAULT);
+}
+
+/*---------------------------------------------------------------------
+ * env_charsets - Get the char and nchar character set ids the session's
+ * environment converts to.
+ *---------------------------------------------------------------------*/
+sword env_charsets(oci_t *ocip, ub2 *char_csid, ub2 *nchar_csid)
+{
+  sword status;
+
+  status = OCIAttrGet((dvoid *)ocip->envp, (ub4)OCI_HTYPE_ENV,
+                      (dvoid *)char_csid, (ub4 *)0,
+                      (ub4)OCI_ATTR_ENV_CHARSET_ID, ocip->errp);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  return OCIAttrGet((dvoid *)ocip->envp, (ub4)OCI_HTYPE_ENV,
+                    (dvoid *)nchar_csid, (ub4 *)0,
+                    (ub4)OCI_ATTR_ENV_NCHARSET_ID, ocip->errp);
 }
 
 /*---------------------------------------------------------------------
@@ -429,7 +931,7 @@ static void attach(oci_t * ocip, conn_info_t *conn, boolean outbound)
 /*---------------------------------------------------------------------
  * attach - Attach to XStream server specified in connection info
  *---------------------------------------------------------------------*/
-static int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound)
+int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound)
 {
   sword       err;
 
@@ -442,18 +944,25 @@ static int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound)
     int r=0;
     OCICALL0(ocip,
             OCIXStreamOutAttach(ocip->svcp, ocip->errp, conn->svrnm,
-                              (ub2)conn->svrnmlen, (ub1 *)0, 0, OCIXSTREAM_OUT_ATTACH_APP_FREE_LCR));
+                              (ub2)conn->svrnmlen,
+                              ocip->resume_pos_len ? ocip->resume_pos : (ub1 *)0,
+                              ocip->resume_pos_len,
+                              OCIXSTREAM_OUT_ATTACH_APP_FREE_LCR));
     if (r != 0) {
         return r;
     }
   }
   else
   {
-    OCICALL(ocip,
+    int r=0;
+    OCICALL0(ocip,
             OCIXStreamInAttach(ocip->svcp, ocip->errp, conn->svrnm,
                                (ub2)conn->svrnmlen,
                                (oratext *)"From_XOUT", 9,
                                (ub1 *)0, 0, OCI_DEFAULT));
+    if (r != 0) {
+        return r;
+    }
   }
 
   ocip->attached = TRUE;
@@ -461,6 +970,429 @@ static int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound)
   return 0;
 }
 
+/*---------------------------------------------------------------------
+ * break_call - Interrupt the call in progress on the service context.
+ * Meant to be called from another thread, so it has its own error handle.
+ *---------------------------------------------------------------------*/
+sword break_call(oci_t *ocip)
+{
+  return OCIBreak((dvoid *)ocip->svcp, ocip->brkerrp);
+}
+
+/*---------------------------------------------------------------------
+ * reset_call - Reset the protocol after break_call, whether or not the
+ * break actually interrupted a call.
+ *---------------------------------------------------------------------*/
+sword reset_call(oci_t *ocip)
+{
+  return OCIReset((dvoid *)ocip->svcp, ocip->errp);
+}
+
+/*---------------------------------------------------------------------
+ * compare_position - Order two LCR positions. Positions compare bytewise,
+ * a proper prefix sorting first.
+ *---------------------------------------------------------------------*/
+static int compare_position(const ub1 *a, ub2 al, const ub1 *b, ub2 bl)
+{
+  int c = memcmp(a, b, al < bl ? al : bl);
+
+  if (c != 0)
+    return c;
+  return (int)al - (int)bl;
+}
+
+/*---------------------------------------------------------------------
+ * receive_lcr - OCIXStreamOutLCRReceive into ocip->lcrp, lcrtype, lcr_flag
+ * and fetchlwm, dropping LCRs at or before the resume position (together
+ * with their chunks) without handing them to the caller. Positions only
+ * increase, so the check is switched off by the first LCR past it.
+ *---------------------------------------------------------------------*/
+sword receive_lcr(oci_t *ocip)
+{
+  void   **lcrpp = &ocip->lcrp;
+  ub1     *lcrtype = &ocip->lcrtype;
+  oraub8  *flag = &ocip->lcr_flag;
+  ub1     *fetchlwm = ocip->fetchlwm;
+  ub2     *fetchlwm_len = &ocip->fetchlwm_len;
+  sword    status;
+  ub1     *pos;
+  ub2      posl;
+  oratext *colname;
+  ub2      colname_len;
+  ub2      coldty;
+  oraub8   col_flags;
+  ub2      col_csid;
+  ub4      chunk_len;
+  ub1     *chunk_ptr;
+  oraub8   row_flag;
+  oraub8   prof_start;
+
+  for (;;)
+  {
+    prof_start = PROF_START(ocip);
+    status = OCIXStreamOutLCRReceive(ocip->svcp, ocip->errp, lcrpp, lcrtype,
+                                     flag, fetchlwm, fetchlwm_len,
+                                     OCI_DEFAULT);
+    PROF_STOP(ocip, OCI_PROF_RECEIVE, prof_start);
+    if (status != OCI_STILL_EXECUTING || ocip->resume_pos_len == 0)
+      return status;
+
+    pos = (ub1 *)0;
+    posl = 0;
+    status = OCILCRHeaderGet(ocip->svcp, ocip->errp,
+                             (oratext **)0, (ub2 *)0,
+                             (oratext **)0, (ub2 *)0,
+                             (oratext **)0, (ub2 *)0,
+                             (oratext **)0, (ub2 *)0,
+                             (ub1 **)0, (ub2 *)0,
+                             (oratext **)0, (ub2 *)0, (OCIDate *)0,
+                             (ub2 *)0, (ub2 *)0,
+                             &pos, &posl,
+                             (oraub8 *)0, *lcrpp, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      return status;
+
+    if (compare_position(pos, posl, ocip->resume_pos,
+                         ocip->resume_pos_len) > 0)
+    {
+      ocip->resume_pos_len = 0;
+      return OCI_STILL_EXECUTING;
+    }
+
+    if (*flag & OCI_XSTREAM_MORE_ROW_DATA)
+    {
+      do
+      {
+        status = OCIXStreamOutChunkReceive(ocip->svcp, ocip->errp,
+                                           &colname, &colname_len, &coldty,
+                                           &col_flags, &col_csid, &chunk_len,
+                                           &chunk_ptr, &row_flag,
+                                           OCI_DEFAULT);
+        if (status != OCI_SUCCESS)
+          return status;
+      } while (row_flag & OCI_XSTREAM_MORE_ROW_DATA);
+    }
+
+    OCILCRFree(ocip->svcp, ocip->errp, *lcrpp, OCI_DEFAULT);
+    *lcrpp = (void *)0;
+    ocip->resume_skipped++;
+  }
+}
+
+/*---------------------------------------------------------------------
+ * position_to_scn - Set ocip->scn to the SCN of an LCR position.
+ *---------------------------------------------------------------------*/
+sword position_to_scn(oci_t *ocip, ub1 *pos, ub2 pos_len)
+{
+  sword status;
+
+  status = OCILCRSCNsFromPosition(ocip->svcp, ocip->errp, pos, pos_len,
+                                  &ocip->scn_num, &ocip->commit_scn_num,
+                                  OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  return OCINumberToInt(ocip->errp, &ocip->scn_num, sizeof(ocip->scn),
+                        OCI_NUMBER_UNSIGNED, &ocip->scn);
+}
+
+/*---------------------------------------------------------------------
+ * scn_to_position - Set ocip->pos to the position of an SCN, in LCRID
+ * version 1 or 2 format.
+ *---------------------------------------------------------------------*/
+sword scn_to_position(oci_t *ocip, oraub8 scn, ub1 lcrid_version)
+{
+  sword status;
+
+  status = OCINumberFromInt(ocip->errp, &scn, sizeof(scn),
+                            OCI_NUMBER_UNSIGNED, &ocip->scn_num);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  if (lcrid_version == OCI_LCRID_V1)
+    return OCILCRSCNToPosition(ocip->svcp, ocip->errp, ocip->pos,
+                               &ocip->pos_len, &ocip->scn_num, OCI_DEFAULT);
+  return OCILCRSCNToPosition2(ocip->svcp, ocip->errp, ocip->pos,
+                              &ocip->pos_len, &ocip->scn_num,
+                              OCI_LCRID_V2, OCI_DEFAULT);
+}
+
+/*---------------------------------------------------------------------
+ * attach_in - Attach to the inbound server of conn as source. The last
+ * position the server received from this source is left in ocip->pos.
+ *---------------------------------------------------------------------*/
+sword attach_in(oci_t *ocip, conn_info_t *conn, oratext *source,
+                       ub2 source_len)
+{
+  sword status;
+
+  printf ("Attach to XStream inbound server '%.*s' as '%.*s'\n",
+          conn->svrnmlen, conn->svrnm, source_len, source);
+
+  ocip->pos_len = 0;
+  status = OCIXStreamInAttach(ocip->svcp, ocip->errp, conn->svrnm,
+                              (ub2)conn->svrnmlen, source, source_len,
+                              ocip->pos, &ocip->pos_len, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  ocip->attached = TRUE;
+  ocip->outbound = FALSE;
+  return OCI_SUCCESS;
+}
+
+/*
+ * Readers for the batch serialised by XStreamInConn (inbound.go). Integers
+ * are little endian, text and byte strings are prefixed by a ub2 length.
+ * The buffer is built by the Go side and is not validated again here.
+ */
+static ub2 batch_ub2(ub1 **p)
+{
+  ub2 v = (ub2)((*p)[0] | ((*p)[1] << 8));
+
+  *p += 2;
+  return v;
+}
+
+static oraub8 batch_ub8(ub1 **p)
+{
+  oraub8 v = 0;
+  int    i;
+
+  for (i = 7; i >= 0; i--)
+    v = (v << 8) | (*p)[i];
+  *p += 8;
+  return v;
+}
+
+static ub1 *batch_bytes(ub1 **p, ub2 *len)
+{
+  ub1 *b;
+
+  *len = batch_ub2(p);
+  b = *p;
+  *p += *len;
+  return b;
+}
+
+/*---------------------------------------------------------------------
+ * batch_columns - Set the OLD or NEW column list of lcrp from the next
+ * column block of a batch. SQLT_INT and SQLT_UIN values (8 bytes) become
+ * OCINumbers, SQLT_BDOUBLE values doubles and SQLT_ODT values (year, month,
+ * day, hour, minute, second) OCIDates, all staged in the arena.
+ *---------------------------------------------------------------------*/
+static sword batch_columns(oci_t *ocip, ub1 **p, ub2 value_type, void *lcrp)
+{
+  ub2        num = batch_ub2(p);
+  size_t     n = num ? num : 1;
+  oratext  **names;
+  ub2       *name_lens;
+  ub2       *dtys;
+  void     **values;
+  OCIInd    *inds;
+  ub2       *lens;
+  ub1       *csetfs;
+  oraub8    *flags;
+  ub2       *csids;
+  ub2        i;
+  sword      status;
+
+  names = lcr_arena_alloc(&ocip->arena, n * sizeof(oratext *));
+  name_lens = lcr_arena_alloc(&ocip->arena, n * sizeof(ub2));
+  dtys = lcr_arena_alloc(&ocip->arena, n * sizeof(ub2));
+  values = lcr_arena_alloc(&ocip->arena, n * sizeof(void *));
+  inds = lcr_arena_alloc(&ocip->arena, n * sizeof(OCIInd));
+  lens = lcr_arena_alloc(&ocip->arena, n * sizeof(ub2));
+  csetfs = lcr_arena_alloc(&ocip->arena, n * sizeof(ub1));
+  flags = lcr_arena_alloc(&ocip->arena, n * sizeof(oraub8));
+  csids = lcr_arena_alloc(&ocip->arena, n * sizeof(ub2));
+  if (!names || !name_lens || !dtys || !values || !inds || !lens ||
+      !csetfs || !flags || !csids)
+    return OCI_ERROR;
+
+  for (i = 0; i < num; i++)
+  {
+    ub1 *v;
+    ub1  null;
+
+    names[i] = (oratext *)batch_bytes(p, &name_lens[i]);
+    dtys[i] = batch_ub2(p);
+    null = *(*p)++;
+    v = batch_bytes(p, &lens[i]);
+    csetfs[i] = 0;
+    flags[i] = 0;
+    csids[i] = 0;
+    if (null)
+    {
+      inds[i] = OCI_IND_NULL;
+      values[i] = (void *)0;
+      lens[i] = 0;
+      continue;
+    }
+    inds[i] = OCI_IND_NOTNULL;
+    values[i] = v;
+
+    switch (dtys[i])
+    {
+    case SQLT_INT:
+    case SQLT_UIN:
+    {
+      OCINumber *num_val = lcr_arena_alloc(&ocip->arena, sizeof(OCINumber));
+      oraub8     u = batch_ub8(&v);
+
+      if (num_val == NULL)
+        return OCI_ERROR;
+      status = OCINumberFromInt(ocip->errp, &u, sizeof(u),
+                                dtys[i] == SQLT_INT ? OCI_NUMBER_SIGNED
+                                                    : OCI_NUMBER_UNSIGNED,
+                                num_val);
+      if (status != OCI_SUCCESS)
+        return status;
+      values[i] = num_val;
+      lens[i] = sizeof(OCINumber);
+      dtys[i] = SQLT_VNU;
+      break;
+    }
+    case SQLT_BDOUBLE:
+    {
+      double *d = lcr_arena_alloc(&ocip->arena, sizeof(double));
+      oraub8  u = batch_ub8(&v);
+
+      if (d == NULL)
+        return OCI_ERROR;
+      memcpy(d, &u, sizeof(double));
+      values[i] = d;
+      lens[i] = sizeof(double);
+      break;
+    }
+    case SQLT_ODT:
+    {
+      OCIDate *d = lcr_arena_alloc(&ocip->arena, sizeof(OCIDate));
+      sb2      yyyy = (sb2)batch_ub2(&v);
+
+      if (d == NULL)
+        return OCI_ERROR;
+      OCIDateSetDate(d, yyyy, v[0], v[1]);
+      OCIDateSetTime(d, v[2], v[3], v[4]);
+      values[i] = d;
+      lens[i] = sizeof(OCIDate);
+      break;
+    }
+    case SQLT_CHR:
+    case SQLT_AFC:
+      csetfs[i] = SQLCS_IMPLICIT;
+      break;
+    }
+  }
+
+  return OCILCRRowColumnInfoSet(ocip->svcp, ocip->errp, value_type, num,
+                                names, name_lens, dtys, values, inds, lens,
+                                csetfs, flags, csids, lcrp, OCI_DEFAULT);
+}
+
+/*---------------------------------------------------------------------
+ * send_lcr_batch - Build the LCRs serialised in buf and send them to the
+ * inbound server, reusing one row LCR and one commit LCR per session.
+ * Each record is: kind (0 row, 1 commit), command, position, txid, a flag
+ * and 7 bytes of source time, owner, object, OLD columns, NEW columns.
+ * ocip->in_sent counts the LCRs sent before a failure.
+ *---------------------------------------------------------------------*/
+sword send_lcr_batch(oci_t *ocip, oratext *source, ub2 source_len,
+                            ub1 *buf, ub4 len)
+{
+  ub1   *p = buf;
+  ub1   *end = buf + len;
+  sword  status = OCI_SUCCESS;
+
+  ocip->in_sent = 0;
+  if (ocip->in_row_lcr == NULL)
+  {
+    status = OCILCRNew(ocip->svcp, ocip->errp, OCI_DURATION_SESSION,
+                       OCI_LCR_XROW, &ocip->in_row_lcr, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      return status;
+  }
+  if (ocip->in_commit_lcr == NULL)
+  {
+    status = OCILCRNew(ocip->svcp, ocip->errp, OCI_DURATION_SESSION,
+                       OCI_LCR_XROW, &ocip->in_commit_lcr, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      return status;
+  }
+
+  while (p < end)
+  {
+    ub1      commit = *p++;
+    void    *lcrp = commit ? ocip->in_commit_lcr : ocip->in_row_lcr;
+    oratext *cmd, *txid, *owner, *oname;
+    ub2      cmd_len, txid_len, owner_len, oname_len;
+    ub1     *pos;
+    ub2      pos_len;
+    OCIDate  src_time;
+    ub1      has_time;
+
+    cmd = (oratext *)batch_bytes(&p, &cmd_len);
+    pos = batch_bytes(&p, &pos_len);
+    txid = (oratext *)batch_bytes(&p, &txid_len);
+    has_time = *p++;
+    OCIDateSetDate(&src_time, (sb2)batch_ub2(&p), p[0], p[1]);
+    OCIDateSetTime(&src_time, p[2], p[3], p[4]);
+    p += 5;
+    owner = (oratext *)batch_bytes(&p, &owner_len);
+    oname = (oratext *)batch_bytes(&p, &oname_len);
+
+    if (!has_time &&
+        (status = OCIDateSysDate(ocip->errp, &src_time)) != OCI_SUCCESS)
+      break;
+
+    status = OCILCRHeaderSet(ocip->svcp, ocip->errp, source, source_len,
+                             cmd, cmd_len,
+                             owner_len ? owner : (oratext *)0, owner_len,
+                             oname_len ? oname : (oratext *)0, oname_len,
+                             (ub1 *)0, 0,                        /* no tag */
+                             txid, txid_len, &src_time, pos, pos_len,
+                             0, lcrp, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      break;
+
+    if ((status = batch_columns(ocip, &p, OCI_LCR_ROW_COLVAL_OLD,
+                                lcrp)) != OCI_SUCCESS ||
+        (status = batch_columns(ocip, &p, OCI_LCR_ROW_COLVAL_NEW,
+                                lcrp)) != OCI_SUCCESS)
+      break;
+
+    status = OCIXStreamInLCRSend(ocip->svcp, ocip->errp, lcrp, OCI_LCR_XROW,
+                                 0, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      break;
+    ocip->in_sent++;
+    lcr_arena_reset(&ocip->arena);
+  }
+
+  lcr_arena_reset(&ocip->arena);
+  return status;
+}
+
+/*---------------------------------------------------------------------
+ * flush_in - Flush the LCRs sent so far to the inbound server, waiting
+ * for them to be applied if wait is set, and leave the processed low
+ * watermark in ocip->pos.
+ *---------------------------------------------------------------------*/
+sword flush_in(oci_t *ocip, boolean wait)
+{
+  sword status;
+
+  status = OCIXStreamInFlush(ocip->svcp, ocip->errp,
+                             wait ? OCIXSTREAM_IN_FLUSH_WAIT_FOR_COMPLETE
+                                  : OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  ocip->pos_len = 0;
+  return OCIXStreamInProcessedLWMGet(ocip->svcp, ocip->errp, ocip->pos,
+                                     &ocip->pos_len, OCI_DEFAULT);
+}
+
 /*---------------------------------------------------------------------
  * ping_svr - Ping inbound server by sending a commit LCR.
  *---------------------------------------------------------------------*/
@@ -494,6 +1426,7 @@ static void ping_svr(oci_t *xin_ocip, void *commit_lcr,
   if (OCIXStreamInLCRSend(xin_ocip->svcp, xin_ocip->errp, commit_lcr,
                           OCI_LCR_XROW, 0, OCI_DEFAULT) == OCI_ERROR)
   {
+    xin_ocip->status = OCI_ERROR;
     ocierror(xin_ocip, (char *)"OCIXStreamInLCRSend failed in ping_svr()");
   }
 }
@@ -619,6 +1552,267 @@ static void get_lcrs(oci_t *xin_ocip, oci_t *xout_ocip)
     ocierror(xout_ocip, (char *)"get_lcrs() encounters error");
 }
 
+/*---------------------------------------------------------------------
+ * relay_chunks - Forward the chunks of the current LCR from xout to xin.
+ *---------------------------------------------------------------------*/
+static sword relay_chunks(oci_t *xin_ocip, oci_t *xout_ocip, relay_t *r,
+                          oraub8 *chunks, oraub8 *chunk_bytes)
+{
+  oratext *colname;
+  ub2      colname_len;
+  ub2      coldty;
+  oraub8   col_flags;
+  ub2      col_csid;
+  ub4      chunk_len;
+  ub1     *chunk_ptr;
+  oraub8   row_flag;
+  sword    status;
+
+  do
+  {
+    status = OCIXStreamOutChunkReceive(xout_ocip->svcp, xout_ocip->errp,
+                                       &colname, &colname_len, &coldty,
+                                       &col_flags, &col_csid, &chunk_len,
+                                       &chunk_ptr, &row_flag, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+    {
+      r->xout_failed = TRUE;
+      return status;
+    }
+
+    status = OCIXStreamInChunkSend(xin_ocip->svcp, xin_ocip->errp, colname,
+                                   colname_len, coldty, col_flags,
+                                   col_csid, chunk_len, chunk_ptr,
+                                   row_flag, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      return status;
+
+    (*chunks)++;
+    *chunk_bytes += chunk_len;
+  } while (row_flag & OCI_XSTREAM_MORE_ROW_DATA);
+
+  return OCI_SUCCESS;
+}
+
+static void relay_lock(relay_t *r)
+{
+  while (__sync_lock_test_and_set(&r->lock, 1))
+    ;
+}
+
+static void relay_unlock(relay_t *r)
+{
+  __sync_lock_release(&r->lock);
+}
+
+/*---------------------------------------------------------------------
+ * relay_snapshot - Copy the counters of a running relay.
+ *---------------------------------------------------------------------*/
+void relay_snapshot(relay_t *r, relay_t *dst)
+{
+  relay_lock(r);
+  *dst = *r;
+  relay_unlock(r);
+  dst->lock = 0;
+}
+
+/*---------------------------------------------------------------------
+ * relay_stop - end relay_lcrs within the batch. With brk, also break the
+ * receive call waiting on xout; OCIBreak is only safe from another thread
+ * in an OCI_THREADED environment, so without it the batch ends after the
+ * LCR in progress.
+ *---------------------------------------------------------------------*/
+void relay_stop(oci_t *xout_ocip, relay_t *r, int brk)
+{
+  relay_lock(r);
+  r->stop = 1;
+  if (brk && r->receiving && !r->broken)
+  {
+    break_call(xout_ocip);
+    r->broken = 1;
+  }
+  relay_unlock(r);
+}
+
+/*---------------------------------------------------------------------
+ * relay_lcrs - get_lcrs without printing: forward LCRs and their chunks
+ * from xout to xin undecoded, ping xin with the fetch LWM while idle and
+ * pass xin's processed LWM back to xout. Relays one receive batch per
+ * call, cut short by relay_stop; r->xout_failed tells which connection
+ * holds the error of a failed call. xout must be attached in
+ * OCIXSTREAM_OUT_ATTACH_APP_FREE_LCR mode (attach0), so every LCR is freed
+ * here once it has been sent.
+ *---------------------------------------------------------------------*/
+sword relay_lcrs(oci_t *xin_ocip, oci_t *xout_ocip, relay_t *r)
+{
+  sword    status = OCI_SUCCESS;
+  ub1      proclwm[OCI_LCR_MAX_POSITION_LEN];
+  ub2      proclwm_len = 0;
+  oraub8   lcrs, chunks, chunk_bytes, pings;
+  int      broken;
+
+  r->xout_failed = FALSE;
+  if (xin_ocip->in_commit_lcr == NULL)
+  {
+    status = OCILCRNew(xin_ocip->svcp, xin_ocip->errp, OCI_DURATION_SESSION,
+                       OCI_LCR_XROW, &xin_ocip->in_commit_lcr, OCI_DEFAULT);
+    if (status != OCI_SUCCESS)
+      return status;
+  }
+
+  lcrs = chunks = chunk_bytes = pings = 0;
+
+  for (;;)
+  {
+    relay_lock(r);
+    r->receiving = !r->stop;
+    relay_unlock(r);
+    if (!r->receiving)
+    {
+      status = OCI_SUCCESS;                  /* stopped within the batch */
+      break;
+    }
+    status = receive_lcr(xout_ocip);
+    relay_lock(r);
+    r->receiving = 0;
+    broken = r->broken;
+    relay_unlock(r);
+
+    /* relay_stop sets stop before it breaks, so this is the last receive.
+     * The break may arrive after the call returned: reset either way, and
+     * still forward an LCR that was received. */
+    if (broken)
+    {
+      sword rstatus = reset_call(xout_ocip);
+
+      if (rstatus != OCI_SUCCESS)
+      {
+        if (xout_ocip->lcrp)
+        {
+          OCILCRFree(xout_ocip->svcp, xout_ocip->errp, xout_ocip->lcrp,
+                     OCI_DEFAULT);
+          xout_ocip->lcrp = (void *)0;
+        }
+        r->xout_failed = TRUE;
+        return rstatus;
+      }
+      if (status != OCI_STILL_EXECUTING)
+        status = OCI_SUCCESS;
+    }
+    if (status != OCI_STILL_EXECUTING)
+      break;
+
+    lcrs++;
+
+    /* save the source db to construct ping lcrs later */
+    if (!r->source_db_len)
+    {
+      oratext *srcdb = (oratext *)0;
+      ub2      srcdb_len = 0;
+
+      if (OCILCRHeaderGet(xout_ocip->svcp, xout_ocip->errp,
+                          &srcdb, &srcdb_len,
+                          (oratext **)0, (ub2 *)0,
+                          (oratext **)0, (ub2 *)0,
+                          (oratext **)0, (ub2 *)0,
+                          (ub1 **)0, (ub2 *)0,
+                          (oratext **)0, (ub2 *)0, (OCIDate *)0,
+                          (ub2 *)0, (ub2 *)0, (ub1 **)0, (ub2 *)0,
+                          (oraub8 *)0, xout_ocip->lcrp,
+                          OCI_DEFAULT) == OCI_SUCCESS &&
+          srcdb_len <= M_DBNAME_LEN)
+      {
+        memcpy(r->source_db, srcdb, srcdb_len);
+        r->source_db_len = srcdb_len;
+      }
+    }
+
+    status = OCIXStreamInLCRSend(xin_ocip->svcp, xin_ocip->errp,
+                                 xout_ocip->lcrp, xout_ocip->lcrtype,
+                                 xout_ocip->lcr_flag, OCI_DEFAULT);
+    if (status == OCI_SUCCESS &&
+        (xout_ocip->lcr_flag & OCI_XSTREAM_MORE_ROW_DATA))
+      status = relay_chunks(xin_ocip, xout_ocip, r, &chunks, &chunk_bytes);
+
+    OCILCRFree(xout_ocip->svcp, xout_ocip->errp, xout_ocip->lcrp,
+               OCI_DEFAULT);
+    xout_ocip->lcrp = (void *)0;
+    if (status != OCI_SUCCESS)
+      return status;
+  }
+
+  if (status != OCI_SUCCESS)
+  {
+    r->xout_failed = TRUE;
+    return status;
+  }
+  if (xout_ocip->lcrp)
+  {
+    OCILCRFree(xout_ocip->svcp, xout_ocip->errp, xout_ocip->lcrp,
+               OCI_DEFAULT);
+    xout_ocip->lcrp = (void *)0;
+  }
+
+  /* clear the saved ping position if we just received some new lcrs,
+   * otherwise ping with a new fetch LWM as get_lcrs does */
+  if (lcrs)
+  {
+    r->pingpos_len = 0;
+  }
+  else if (xout_ocip->fetchlwm_len > 0 && r->source_db_len > 0 &&
+           (xout_ocip->fetchlwm_len != r->pingpos_len ||
+            memcmp(r->pingpos, xout_ocip->fetchlwm,
+                   xout_ocip->fetchlwm_len)))
+  {
+    if (r->pingpos_len > 0)
+    {
+      xin_ocip->status = OCI_SUCCESS;
+      ping_svr(xin_ocip, xin_ocip->in_commit_lcr, xout_ocip->fetchlwm,
+               xout_ocip->fetchlwm_len, r->source_db, r->source_db_len);
+      if (xin_ocip->status != OCI_SUCCESS)
+        return xin_ocip->status;
+      pings++;
+    }
+    memcpy(r->pingpos, xout_ocip->fetchlwm, xout_ocip->fetchlwm_len);
+    r->pingpos_len = xout_ocip->fetchlwm_len;
+  }
+
+  status = OCIXStreamInFlush(xin_ocip->svcp, xin_ocip->errp, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  proclwm_len = 0;
+  status = OCIXStreamInProcessedLWMGet(xin_ocip->svcp, xin_ocip->errp,
+                                       proclwm, &proclwm_len, OCI_DEFAULT);
+  if (status != OCI_SUCCESS)
+    return status;
+
+  if (proclwm_len > 0)
+  {
+    r->xout_failed = TRUE;
+    status = OCIXStreamOutProcessedLWMSet(xout_ocip->svcp, xout_ocip->errp,
+                                          proclwm, proclwm_len,
+                                          OCI_DEFAULT);
+    if (status == OCI_SUCCESS)
+      status = position_to_scn(xout_ocip, proclwm, proclwm_len);
+    if (status != OCI_SUCCESS)
+      return status;
+    r->xout_failed = FALSE;
+  }
+
+  relay_lock(r);
+  r->lcrs += lcrs;
+  r->chunks += chunks;
+  r->chunk_bytes += chunk_bytes;
+  r->pings += pings;
+  r->batches++;
+  if (proclwm_len > 0)
+    r->lwm_scn = xout_ocip->scn;
+  relay_unlock(r);
+
+  return OCI_SUCCESS;
+}
+
 /*---------------------------------------------------------------------
  * get_chunks - Get each chunk for the current LCR and send it to
  *              the inbound server.
@@ -666,7 +1860,7 @@ static void get_chunks(oci_t *xin_ocip, oci_t *xout_ocip)
 /*---------------------------------------------------------------------
  * travel_chunks - travel each chunk for the current LCR and do nothing
  *---------------------------------------------------------------------*/
-static void travel_chunks(oci_t *xout_ocip)
+void travel_chunks(oci_t *xout_ocip)
 {
   oratext *colname;
   ub2      colname_len;
@@ -679,16 +1873,22 @@ static void travel_chunks(oci_t *xout_ocip)
   sword    err;
   sb4      rtncode;
 
+  oraub8   prof_start;
+
   int chunk_cnt = 0;
   do
   {
     chunk_cnt++;
+    prof_start = PROF_START(xout_ocip);
     /* Get a chunk from outbound server */
     OCICALL(xout_ocip,
             OCIXStreamOutChunkReceive(xout_ocip->svcp, xout_ocip->errp,
                                       &colname, &colname_len, &coldty,
                                       &col_flags, &col_csid, &chunk_len,
                                       &chunk_ptr, &row_flag, OCI_DEFAULT));
+    PROF_STOP(xout_ocip, OCI_PROF_CHUNK, prof_start);
+    xout_ocip->chunks++;
+    xout_ocip->chunk_bytes += chunk_len;
 
     /* print chunk data */
     /* print_chunk(chunk_ptr, chunk_len, coldty); */
@@ -773,7 +1973,7 @@ static void print_lcr(oci_t *ocip, void *lcrp, ub1 lcrtype,
 /*---------------------------------------------------------------------
  * detach - Detach from XStream server
  *---------------------------------------------------------------------*/
-static void detach(oci_t * ocip)
+void detach(oci_t * ocip)
 {
   sword  err = OCI_SUCCESS;
 
@@ -795,22 +1995,43 @@ static void detach(oci_t * ocip)
 /*---------------------------------------------------------------------
  * disconnect_db  - Logoff from the database
  *---------------------------------------------------------------------*/
-static void disconnect_db(oci_t * ocip)
+void disconnect_db(oci_t * ocip)
 {
-  if (OCILogoff(ocip->svcp, ocip->errp))
+  if (ocip->in_row_lcr)
+    OCILCRFree(ocip->svcp, ocip->errp, ocip->in_row_lcr, OCI_DEFAULT);
+  if (ocip->in_commit_lcr)
+    OCILCRFree(ocip->svcp, ocip->errp, ocip->in_commit_lcr, OCI_DEFAULT);
+
+  /* with a shared environment, freeing it no longer reclaims these */
+  if (ocip->stmtp)
+    OCIHandleFree((dvoid *) ocip->stmtp, (ub4) OCI_HTYPE_STMT);
+
+  if (ocip->svcp && OCILogoff(ocip->svcp, ocip->errp))
   {
     ocierror(ocip, (char *)"OCILogoff() failed");
   }
 
+  if (ocip->srvp)
+    OCIHandleFree((dvoid *) ocip->srvp, (ub4) OCI_HTYPE_SERVER);
+
   if (ocip->errp)
     OCIHandleFree((dvoid *) ocip->errp, (ub4) OCI_HTYPE_ERROR);
 
-  if (ocip->envp)
+  if (ocip->brkerrp)
+    OCIHandleFree((dvoid *) ocip->brkerrp, (ub4) OCI_HTYPE_ERROR);
+
+  if (ocip->envp && ocip->owns_env)
     OCIHandleFree((dvoid *) ocip->envp, (ub4) OCI_HTYPE_ENV);
+
+  lcr_arena_free(&ocip->arena);
+
+  if (ocip->owns_env)
+    oci_pool_destroy(ocip->pool);
+  ocip->pool = NULL;
 }
 
 /*---------------------------------------------------------------------
- * ocierror - Print error status and exit program
+ * ocierror - Print error status. The status itself is left to the caller.
  *---------------------------------------------------------------------*/
 static void ocierror(oci_t * ocip, char * msg)
 {
@@ -827,7 +2048,6 @@ static void ocierror(oci_t * ocip, char * msg)
     puts(msg);
 
   printf ("\n");
-  exit(1);
 }
 static void ocierror2(OCIError * oci_err  , char * msg)
 {
@@ -839,7 +2059,6 @@ static void ocierror2(OCIError * oci_err  , char * msg)
     printf("%s\n%s", msg, bufp);
 
   printf ("\n");
-  exit(1);
 }
 
 /*---------------------------------------------------------------------
@@ -0,0 +1,255 @@
+#ifndef XSTRM_H
+#define XSTRM_H
+
+#ifndef OCI_ORACLE
+#include <oci.h>
+#endif
+
+#ifndef _STDIO_H
+#include <stdio.h>
+#endif
+
+#ifndef _STDLIB_H
+#include <stdlib.h>
+#endif
+
+#ifndef _STRING_H
+#include <string.h>
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+//#ifndef _MALLOC_H
+//#include <malloc.h>
+//#endif
+
+/*----------------------------------------------------------------------
+ *           Internal structures
+ *----------------------------------------------------------------------*/
+
+#define M_DBNAME_LEN    (128)
+
+typedef struct conn_info                                     /* connect info */
+{
+  oratext * user;
+  ub4       userlen;
+  oratext * passw;
+  ub4       passwlen;
+  oratext * dbname;
+  ub4       dbnamelen;
+  oratext * svrnm;
+  ub4       svrnmlen;
+} conn_info_t;
+
+typedef struct params
+{
+  conn_info_t  xout;                                        /* outbound info */
+  conn_info_t  xin;                                          /* inbound info */
+} params_t;
+
+/* Bump-pointer arena for per-LCR scratch memory (row descriptors, column
+ * name copies, staging buffers). Everything allocated from it is released
+ * at once by lcr_arena_reset() after the LCR has been consumed. */
+typedef struct lcr_arena_chunk
+{
+  struct lcr_arena_chunk *next;
+  size_t                  size;
+} lcr_arena_chunk_t;
+
+typedef struct lcr_arena
+{
+  ub1               *base;                             /* primary block */
+  size_t             cap;                      /* size of primary block */
+  size_t             used;             /* bytes used in the primary block */
+  size_t             spill;            /* bytes served from overflow chunks */
+  lcr_arena_chunk_t *chunks;                     /* overflow chunk chain */
+  size_t             hwm;        /* high-water mark of a single LCR cycle */
+  ub4                grows;           /* times the primary block was grown */
+} lcr_arena_t;
+
+/* Size-class pool plugged into OCIEnvNlsCreate as the environment's
+ * malloc/realloc/free callbacks, so the memory OCI allocates for every
+ * LCR is recycled instead of going through the C library allocator. */
+#define OCI_MEM_MIN_SHIFT     (5)                         /* 32 byte class */
+#define OCI_MEM_NCLASSES      (12)                       /* up to 64K bytes */
+#define OCI_MEM_LARGE         (0xff)           /* not pooled, plain malloc */
+#define OCI_MEM_CACHE_BYTES   (4 * 1024 * 1024)  /* max cached per class */
+
+typedef struct oci_mem_block
+{
+  struct oci_mem_block *next;
+} oci_mem_block_t;
+
+typedef struct oci_mem_pool
+{
+  volatile int     lock;             /* OCI may call back from any thread */
+  oci_mem_block_t *free_list[OCI_MEM_NCLASSES];
+  size_t           cached[OCI_MEM_NCLASSES];
+  oraub8           allocs;                        /* malloc/realloc calls */
+  oraub8           frees;                                   /* free calls */
+  oraub8           hits;                  /* allocations served from pool */
+  oraub8           bytes;                        /* total bytes requested */
+  oraub8           in_use;                 /* bytes currently handed out */
+} oci_mem_pool_t;
+
+/* Optional hot-path timers, accumulated per connection while enabled. */
+#define OCI_PROF_RECEIVE      (0)                  /* OCIXStreamOutLCRReceive */
+#define OCI_PROF_COLUMN_INFO  (1)                  /* OCILCRRowColumnInfoGet */
+#define OCI_PROF_COPY         (2)        /* copying and staging column values */
+#define OCI_PROF_CHUNK        (3)                /* OCIXStreamOutChunkReceive */
+#define OCI_PROF_COUNT        (4)
+
+typedef struct oci_prof
+{
+  boolean     enabled;
+  oraub8      calls[OCI_PROF_COUNT];
+  oraub8      nanos[OCI_PROF_COUNT];
+} oci_prof_t;
+
+typedef struct oci                                            /* OCI handles */
+{
+  OCIEnv      *envp;                                   /* Environment handle */
+  OCIError    *errp;                                         /* Error handle */
+  OCIError    *brkerrp;                   /* Error handle for break_call */
+  OCIServer   *srvp;                                        /* Server handle */
+  OCISvcCtx   *svcp;                                       /* Service handle */
+  OCISession  *authp;
+  OCIStmt    *stmtp;
+  boolean     attached;
+  boolean     outbound;
+  lcr_arena_t arena;                            /* per-LCR scratch memory */
+  oci_mem_pool_t *pool;              /* OCI memory callbacks, may be NULL */
+  boolean     owns_env;          /* envp and pool are freed on disconnect */
+  ub1         resume_pos[OCI_LCR_MAX_POSITION_LEN];  /* attach position; */
+  ub2         resume_pos_len;    /* LCRs at or before it are dropped */
+  ub4         resume_skipped;                 /* number of LCRs dropped */
+  sword       status;                   /* status of the last failed call */
+  oraub8      chunks;             /* LOB/LONG chunks drained by travel_chunks */
+  oraub8      chunk_bytes;
+  oci_prof_t  prof;
+  void       *lcrp;              /* receive_lcr results, reused every call */
+  ub1         lcrtype;
+  oraub8      lcr_flag;
+  ub1         fetchlwm[OCI_LCR_MAX_POSITION_LEN];
+  ub2         fetchlwm_len;
+  ub1         pos[OCI_LCR_MAX_POSITION_LEN];   /* scn_to_position result */
+  ub2         pos_len;
+  oraub8      scn;                             /* position_to_scn result */
+  OCINumber   scn_num;                 /* scratch for SCN conversions */
+  OCINumber   commit_scn_num;
+  void       *in_row_lcr;      /* inbound LCRs, reused by send_lcr_batch */
+  void       *in_commit_lcr;
+  ub4         in_sent;                  /* LCRs sent by the last batch */
+} oci_t;
+
+/* Progress of relay_lcrs, published once per batch under lock and read
+ * from another thread through relay_snapshot; stop, receiving and broken
+ * are also taken under lock. */
+typedef struct relay
+{
+  volatile int lock;
+  volatile int stop;          /* ends the batch after the LCR in progress */
+  int          receiving;          /* in receive_lcr, which relay_stop may
+                                    * break */
+  int          broken;
+  oraub8       lcrs;                                     /* LCRs forwarded */
+  oraub8       chunks;                                 /* chunks forwarded */
+  oraub8       chunk_bytes;
+  oraub8       batches;                  /* receive batches, one flush each */
+  oraub8       pings;                 /* commit LCRs carrying the fetch LWM */
+  oraub8       lwm_scn;           /* processed LWM passed back to outbound */
+  boolean      xout_failed;         /* the failed call was on the outbound */
+  ub1          pingpos[OCI_LCR_MAX_POSITION_LEN];  /* fetch LWM last pinged */
+  ub2          pingpos_len;
+  oratext      source_db[M_DBNAME_LEN];         /* for building ping LCRs */
+  ub2          source_db_len;
+} relay_t;
+
+#define KEY_NAME_LEN    (4 * 128)           /* 128 characters, 4 bytes each */
+
+/* One row of a key_query: a column of a table's primary or unique key.
+ * Rows come per table, primary key first, in column order. */
+typedef struct key_query
+{
+  OCIDefine *defs[4];
+  OCIBind   *binds[2];
+  oratext    owner[KEY_NAME_LEN];
+  ub2        owner_len;
+  oratext    table[KEY_NAME_LEN];
+  ub2        table_len;
+  oratext    constraint[KEY_NAME_LEN];
+  ub2        constraint_len;
+  oratext    column[KEY_NAME_LEN];
+  ub2        column_len;
+} key_query_t;
+
+typedef struct oci_lcr_column_item {
+  void *column_value;
+  ub2 column_value_len;
+
+  OCIInd column_indicator;
+  ub1 column_character_set_form;
+  oraub8 column_flag;
+
+  ub2 column_csid;
+
+  ub1 *column_name;
+  ub2 column_name_len;
+
+  ub2 column_data_type;
+} oci_lcr_column_item_t;
+
+typedef struct oci_lcr_row {
+  oci_lcr_column_item_t *columns;
+  ub2 length;
+} oci_lcr_row_t;
+
+/*----------------------------------------------------------------------
+ *           Functions called from Go
+ *----------------------------------------------------------------------*/
+
+void lcr_arena_reset(lcr_arena_t *arena);
+sword get_lcr_row_data(oci_t *ocip, void *lcrp,
+                       ub2 column_value_type, oci_lcr_row_t **row,
+                       ub2 *column_length);
+sword iterate_row_data(const oci_t *ocip, const oci_lcr_row_t *row,
+                       ub2 index, char **column_name,
+                       ub2 *column_name_len, void **column_value,
+                       ub2 *column_value_len, ub2 *column_csid, ub2 *column_data_type);
+sword create_env(OCIEnv **envp, ub4 mode, ub2 char_csid,
+                 ub2 nchar_csid, oci_mem_pool_t *pool);
+oci_mem_pool_t *create_pool(void);
+sword connect_db(conn_info_t *opt_params_p, oci_t ** ocip, ub2 char_csid,
+                ub2 nchar_csid, boolean pooled);
+sword connect_db_env(conn_info_t *params_p, oci_t **ociptr,
+                     OCIEnv *envp, oci_mem_pool_t *pool);
+void disconnect_db(oci_t * ocip);
+int attach0(oci_t * ocip, conn_info_t *conn, boolean outbound);
+void detach(oci_t *ocip);
+sword break_call(oci_t *ocip);
+sword reset_call(oci_t *ocip);
+sword receive_lcr(oci_t *ocip);
+sword position_to_scn(oci_t *ocip, ub1 *pos, ub2 pos_len);
+sword scn_to_position(oci_t *ocip, oraub8 scn, ub1 lcrid_version);
+sword attach_in(oci_t *ocip, conn_info_t *conn, oratext *source,
+                ub2 source_len);
+sword send_lcr_batch(oci_t *ocip, oratext *source, ub2 source_len,
+                     ub1 *buf, ub4 len);
+sword flush_in(oci_t *ocip, boolean wait);
+sword relay_lcrs(oci_t *xin_ocip, oci_t *xout_ocip, relay_t *r);
+void relay_snapshot(relay_t *r, relay_t *dst);
+void relay_stop(oci_t *xout_ocip, relay_t *r, int brk);
+void travel_chunks( oci_t *xout_ocip);
+sword query_db_charsets(oci_t *ocip, ub2 *char_csid,
+                       ub2 *nchar_csid);
+sword env_charsets(oci_t *ocip, ub2 *char_csid, ub2 *nchar_csid);
+sword start_key_query(oci_t *ocip, key_query_t *q, boolean by_server,
+                      oratext *a, ub2 al, oratext *b, ub2 bl);
+sword fetch_key_row(oci_t *ocip);
+void oci_pool_destroy(oci_mem_pool_t *pool);
+
+#endif /* XSTRM_H */